@@ -0,0 +1,105 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef COLLISION_CACHE_H_
+#define COLLISION_CACHE_H_
+
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/collision/link_sphere_model.h>
+#include <itomp_ca_planner/util/arena.h>
+#include <kdl/frames.hpp>
+
+namespace itomp_ca_planner
+{
+
+// Collision-free results of the waypoints, with the link frames and the clearance they
+// were computed for. A link geometry bounded by a sphere of radius r around c moves at most
+// |dc| + r * angle, so a waypoint is still free if twice the largest motion of its links
+// is below the clearance (two links of a self collision pair may approach each other).
+class CollisionCache
+{
+public:
+	CollisionCache();
+	virtual ~CollisionCache();
+
+	void init(int num_points, const std::vector<CollisionLink>& links);
+	void clear();
+
+	bool isCollisionFree(int point, const ArenaArray<KDL::Frame>& segment_frames) const;
+	void setCollisionFree(int point, const ArenaArray<KDL::Frame>& segment_frames, double clearance);
+	void invalidate(int point);
+
+	// shared by the copies of the cache
+	unsigned long getNumQueries() const;
+	unsigned long getNumHits() const;
+
+private:
+	struct Counters
+	{
+		unsigned long num_queries_;
+		unsigned long num_hits_;
+	};
+
+	std::vector<CollisionLink> links_;
+	int num_links_;
+	std::vector<KDL::Frame> frames_; /**< [point][link] */
+	std::vector<double> clearances_; /**< 0 for waypoints without a result */
+
+	boost::shared_ptr<Counters> counters_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline void CollisionCache::invalidate(int point)
+{
+	if (point < clearances_.size())
+		clearances_[point] = 0.0;
+}
+
+inline unsigned long CollisionCache::getNumQueries() const
+{
+	return counters_->num_queries_;
+}
+
+inline unsigned long CollisionCache::getNumHits() const
+{
+	return counters_->num_hits_;
+}
+
+}
+
+#endif /* COLLISION_CACHE_H_ */
@@ -0,0 +1,139 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef COLLISION_COST_QUERY_H_
+#define COLLISION_COST_QUERY_H_
+
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/util/arena.h>
+#include <kdl/frames.hpp>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/collision_detection_fcl/collision_common.h>
+#include <fcl/collision_object.h>
+#include <fcl/collision_data.h>
+
+namespace itomp_ca_planner
+{
+class ItompRobotModel;
+class ItompPlanningGroup;
+
+// Per-thread buffers of CollisionCostQuery. Allocated once, so a query does not allocate.
+struct CollisionCostWorkspace
+{
+	std::vector<fcl::CollisionObject> robot_objects_;
+	fcl::CollisionResult result_;
+	fcl::DistanceResult distance_result_;
+	std::vector<double> pair_depths_; /**< penetration depth of each pair in the last query */
+	int num_colliding_pairs_;
+};
+
+// Sums the penetration depths of the robot collision shapes with the world objects and with
+// each other, querying FCL directly instead of the planning scene. The shape pairs are
+// filtered by the allowed collision matrix once, and no contact maps are built.
+// With a planning group, the pairs which cannot move relative to each other while planning
+// the group are static: they give the same result in every iteration and are queried
+// separately, once per waypoint.
+class CollisionCostQuery
+{
+public:
+	CollisionCostQuery();
+	virtual ~CollisionCostQuery();
+
+	// planning_group may be NULL, then all pairs are moving. With self_collision_only,
+	// the world objects are left out
+	void init(const ItompRobotModel* robot_model, const ItompPlanningGroup* planning_group,
+			const planning_scene::PlanningSceneConstPtr& planning_scene, bool self_collision_only = false);
+	void initWorkspace(CollisionCostWorkspace& workspace) const;
+
+	// returns the depth sum of the moving pairs of the state with the FK result segment_frames
+	double computeDepthSum(const ArenaArray<KDL::Frame>& segment_frames, CollisionCostWorkspace& workspace) const;
+	// same for the static pairs
+	double computeStaticDepthSum(const ArenaArray<KDL::Frame>& segment_frames, CollisionCostWorkspace& workspace) const;
+	// smallest distance between the moving pairs placed by the last computeDepthSum, up to max_distance.
+	// Pairs whose bounding boxes are farther apart than the current minimum are skipped
+	double computeMinDistance(CollisionCostWorkspace& workspace, double max_distance) const;
+
+	int getNumPairs() const;
+	int getNumMovingPairs() const;
+
+private:
+	struct RobotShape
+	{
+		int segment_index_;
+		KDL::Frame origin_; /**< collision origin in the segment frame */
+		collision_detection::FCLGeometryConstPtr geometry_;
+	};
+
+	std::vector<RobotShape> robot_shapes_;
+	std::vector<collision_detection::FCLGeometryConstPtr> world_geometries_;
+	std::vector<fcl::CollisionObject> world_objects_;
+
+	struct ShapePair
+	{
+		int robot_shape_;
+		int other_shape_; /**< robot shape index for self collision pairs, world shape index otherwise */
+		bool is_self_collision_;
+	};
+	// the moving pairs, then the static pairs
+	std::vector<ShapePair> pairs_;
+	int num_moving_pairs_;
+
+	void placeRobotShapes(const ArenaArray<KDL::Frame>& segment_frames, CollisionCostWorkspace& workspace) const;
+	double computeDepthSum(int pair_begin, int pair_end, CollisionCostWorkspace& workspace) const;
+	void getPair(int pair, CollisionCostWorkspace& workspace, const fcl::CollisionObject*& object1,
+			const fcl::CollisionObject*& object2) const;
+
+	fcl::CollisionRequest request_;
+	fcl::DistanceRequest distance_request_;
+};
+typedef boost::shared_ptr<const CollisionCostQuery> CollisionCostQueryConstPtr;
+
+/////////////////////// inline functions follow ////////////////////////
+inline int CollisionCostQuery::getNumPairs() const
+{
+	return pairs_.size();
+}
+
+inline int CollisionCostQuery::getNumMovingPairs() const
+{
+	return num_moving_pairs_;
+}
+
+}
+
+#endif /* COLLISION_COST_QUERY_H_ */
@@ -0,0 +1,139 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef COLLISION_PREFILTER_H_
+#define COLLISION_PREFILTER_H_
+
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/collision/link_sphere_model.h>
+#include <itomp_ca_planner/util/arena.h>
+#include <kdl/frames.hpp>
+#include <moveit/planning_scene/planning_scene.h>
+
+namespace itomp_ca_planner
+{
+class ItompPlanningGroup;
+
+// Conservative broad phase before the planning scene collision checks. The links are
+// bounded by spheres, the world objects by a bounding volume hierarchy of boxes. A state
+// can only collide if a link sphere overlaps a world object box or the sphere of another
+// link it is not allowed to collide with.
+// With a planning group, only the link pairs which can move relative to each other while
+// planning the group are tested (see CollisionCostQuery).
+class CollisionPrefilter
+{
+public:
+	CollisionPrefilter();
+	virtual ~CollisionPrefilter();
+
+	// planning_group may be NULL, then all pairs are tested
+	void init(const LinkSphereModel& link_sphere_model, const ItompPlanningGroup* planning_group,
+			const planning_scene::PlanningSceneConstPtr& planning_scene);
+
+	// false if the state with the FK result segment_frames is collision-free. If clearance
+	// is given, it is set to a lower bound of the distance between the link geometries and
+	// the world objects or the other links for collision-free states
+	bool isCollisionPossible(const ArenaArray<KDL::Frame>& segment_frames, double* clearance = NULL) const;
+
+	const std::vector<CollisionLink>& getLinks() const;
+
+	// number of states tested / found collision-free by isCollisionPossible
+	unsigned long getNumQueries() const;
+	unsigned long getNumSkippedQueries() const;
+	void resetCounters();
+
+private:
+	struct BoundingBox
+	{
+		KDL::Vector min_;
+		KDL::Vector max_;
+	};
+	struct Node
+	{
+		BoundingBox box_;
+		int left_; /**< child node indices, -1 for leaves */
+		int right_;
+		int object_; /**< world object index of leaves */
+	};
+
+	int buildNode(std::vector<Node>& leaves, int begin, int end);
+	bool overlaps(int node, const KDL::Vector& center, double radius, int link) const;
+	// distance from center to the nearest box not allowed to collide with link, up to max_distance
+	double getDistance(int node, const KDL::Vector& center, int link, double max_distance) const;
+	static double getSquaredDistance(const BoundingBox& box, const KDL::Vector& point);
+
+	std::vector<CollisionLink> links_;
+	std::vector<char> is_link_moving_;
+	std::vector<Node> nodes_;
+	int root_;
+
+	// [link][world object], true if the ACM allows the collision
+	std::vector<std::vector<char> > allowed_object_collisions_;
+	// link pairs the ACM does not allow to collide
+	std::vector<std::pair<int, int> > self_collision_pairs_;
+
+	mutable unsigned long num_queries_;
+	mutable unsigned long num_skipped_queries_;
+};
+typedef boost::shared_ptr<CollisionPrefilter> CollisionPrefilterPtr;
+
+/////////////////////// inline functions follow ////////////////////////
+inline const std::vector<CollisionLink>& CollisionPrefilter::getLinks() const
+{
+	return links_;
+}
+
+inline unsigned long CollisionPrefilter::getNumQueries() const
+{
+	return num_queries_;
+}
+
+inline unsigned long CollisionPrefilter::getNumSkippedQueries() const
+{
+	return num_skipped_queries_;
+}
+
+inline void CollisionPrefilter::resetCounters()
+{
+	num_queries_ = 0;
+	num_skipped_queries_ = 0;
+}
+
+}
+
+#endif /* COLLISION_PREFILTER_H_ */
@@ -0,0 +1,106 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef LINK_SPHERE_MODEL_H_
+#define LINK_SPHERE_MODEL_H_
+
+#include <itomp_ca_planner/common.h>
+#include <kdl/frames.hpp>
+
+namespace itomp_ca_planner
+{
+class ItompRobotModel;
+
+struct CollisionSphere
+{
+	int segment_index_; /**< index into the FK segment frames */
+	KDL::Vector center_; /**< center in the segment frame */
+	double radius_;
+};
+
+// bounding sphere of all collision spheres of a link. The radius is infinite if the
+// collision geometry of the link could not be covered by spheres.
+struct CollisionLink
+{
+	std::string name_;
+	int segment_index_;
+	KDL::Vector center_;
+	double radius_;
+};
+
+// Approximates the collision geometry of the robot links by spheres. Each shape is
+// covered by a row of spheres along the longest axis of its bounding box.
+class LinkSphereModel
+{
+public:
+	LinkSphereModel();
+	virtual ~LinkSphereModel();
+
+	void init(const ItompRobotModel* robot_model);
+
+	int getNumSpheres() const;
+	const std::vector<CollisionSphere>& getSpheres() const;
+	const std::vector<CollisionLink>& getLinks() const;
+
+private:
+	// links which are not bounded get an infinite radius
+	void addLink(const std::string& name, int segment_index, int first_sphere, bool bounded);
+
+	std::vector<CollisionSphere> spheres_;
+	std::vector<CollisionLink> links_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline int LinkSphereModel::getNumSpheres() const
+{
+	return spheres_.size();
+}
+
+inline const std::vector<CollisionSphere>& LinkSphereModel::getSpheres() const
+{
+	return spheres_;
+}
+
+inline const std::vector<CollisionLink>& LinkSphereModel::getLinks() const
+{
+	return links_;
+}
+
+}
+
+#endif /* LINK_SPHERE_MODEL_H_ */
@@ -0,0 +1,133 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef SIGNED_DISTANCE_FIELD_H_
+#define SIGNED_DISTANCE_FIELD_H_
+
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/util/singleton.h>
+#include <kdl/frames.hpp>
+#include <moveit/planning_scene/planning_scene.h>
+#include <boost/thread/mutex.hpp>
+
+namespace itomp_ca_planner
+{
+
+// Voxel grid of the signed distance to the static world objects of a planning scene.
+// Negative inside the objects. Queries interpolate trilinearly between the voxel centers.
+class SignedDistanceField
+{
+public:
+	SignedDistanceField();
+	virtual ~SignedDistanceField();
+
+	// voxelizes the world objects and computes the distance transform. The grid covers
+	// the bounding spheres of the objects, enlarged by padding
+	void build(const collision_detection::World& world, double resolution, double padding);
+
+	double getDistance(const KDL::Vector& position) const;
+	// also returns the gradient of the distance at position
+	double getDistance(const KDL::Vector& position, KDL::Vector& gradient) const;
+
+	bool isEmpty() const;
+	double getResolution() const;
+
+private:
+	int getCellIndex(int x, int y, int z) const;
+	double getCellDistance(int x, int y, int z) const;
+
+	// squared euclidean distance transform (Felzenszwalb and Huttenlocher) of the
+	// cells where is_site is set, in voxel units
+	void computeSquaredDistances(const std::vector<char>& is_site, std::vector<double>& squared_distances) const;
+	static void distanceTransform1D(const double* f, int n, double* d, int* v, double* z);
+
+	KDL::Vector origin_; /**< center of the cell (0, 0, 0) */
+	double resolution_;
+	int size_[3];
+	std::vector<float> distances_;
+};
+typedef boost::shared_ptr<const SignedDistanceField> SignedDistanceFieldConstPtr;
+
+// Keeps the field of the last planning scene world, so the trajectories planned in the
+// same scene share one field. The world is identified by its objects, shapes and poses.
+class SignedDistanceFieldCache: public Singleton<SignedDistanceFieldCache>
+{
+public:
+	SignedDistanceFieldCache();
+	virtual ~SignedDistanceFieldCache();
+
+	SignedDistanceFieldConstPtr getSignedDistanceField(const planning_scene::PlanningSceneConstPtr& planning_scene,
+			double resolution, double padding);
+
+	static std::size_t computeWorldHash(const collision_detection::World& world);
+
+private:
+
+	boost::mutex mutex_;
+	SignedDistanceFieldConstPtr field_;
+	std::size_t world_hash_;
+	double resolution_;
+	double padding_;
+
+	friend class Singleton<SignedDistanceFieldCache> ;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline bool SignedDistanceField::isEmpty() const
+{
+	return distances_.empty();
+}
+
+inline double SignedDistanceField::getResolution() const
+{
+	return resolution_;
+}
+
+inline int SignedDistanceField::getCellIndex(int x, int y, int z) const
+{
+	return (x * size_[1] + y) * size_[2] + z;
+}
+
+inline double SignedDistanceField::getCellDistance(int x, int y, int z) const
+{
+	return distances_[getCellIndex(x, y, z)];
+}
+
+}
+
+#endif /* SIGNED_DISTANCE_FIELD_H_ */
@@ -59,10 +59,4 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 #include <itomp_ca_planner/util/itomp_debug.h>
 
-inline int getNumParallelThreads()
-{
-	//return omp_get_max_threads();
-	return 1;
-}
-
 #endif
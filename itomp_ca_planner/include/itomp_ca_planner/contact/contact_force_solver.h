@@ -40,6 +40,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #define CONTACTFORCESOLVER_H_
 
 #include <kdl/frames.hpp>
+#include <itomp_ca_planner/util/arena.h>
 
 namespace itomp_ca_planner
 {
@@ -49,14 +50,32 @@ public:
   ContactForceSolver();
   virtual ~ContactForceSolver();
 
-  void operator()(double friction_coeff, std::vector<KDL::Vector>& contact_forces,
-      std::vector<KDL::Vector>& contact_positions, const KDL::Wrench& wrench, const std::vector<double>& contact_values,
-      const std::vector<KDL::Frame> contact_parent_frames);
+  // Solves the contact forces and centers of pressure of num_points consecutive
+  // waypoints in one call. Per-contact arrays are laid out as
+  // [point * num_contacts + contact].
+  void operator()(double friction_coeff, int num_points, int num_contacts, const KDL::Wrench* wrenches,
+      const KDL::Frame* contact_parent_frames, const double* contact_values, KDL::Vector* contact_forces,
+      KDL::Vector* contact_positions);
 
 protected:
+  // friction cone and center of pressure constrained solve with levmar, started
+  // from the linear solution of each waypoint
+  void solveConstrained(double friction_coeff, int num_points, int num_contacts, const KDL::Wrench* wrenches,
+      const KDL::Frame* contact_parent_frames, const double* contact_values, KDL::Vector* contact_forces,
+      KDL::Vector* contact_positions);
+
   std::vector<KDL::Vector> diffs_;
   std::vector<KDL::Rotation> rotations_;
   std::vector<KDL::Vector> forces_;
+
+  // levmar buffers, reused across waypoints
+  std::vector<double> parameters_;
+  std::vector<double> measurements_;
+  std::vector<double> lower_bounds_;
+  std::vector<double> upper_bounds_;
+  std::vector<double> constraints_;
+  std::vector<double> constraint_bounds_;
+  std::vector<double> work_;
 };
 }
 
@@ -0,0 +1,127 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef GROUND_HEIGHTMAP_H_
+#define GROUND_HEIGHTMAP_H_
+
+#include <itomp_ca_planner/common.h>
+#include <kdl/frames.hpp>
+#include <moveit/collision_detection/world.h>
+#include <geometric_shapes/shapes.h>
+
+namespace itomp_ca_planner
+{
+
+// 2.5D index of the world meshes for nearest ground queries. Each cell of an xy grid
+// stores the plane of the highest upward facing triangle above its center, so the ground
+// below a point is found in constant time. Cells where an upward facing surface lies under
+// another object with free space in between (overhangs), cells without any surface and
+// points outside of the grid fall back to a nearest triangle search in a BVH.
+class GroundHeightmap
+{
+public:
+	GroundHeightmap();
+	virtual ~GroundHeightmap();
+
+	void build(const collision_detection::World& world, double resolution);
+
+	// out is the nearest ground position of in and normal the ground normal there.
+	// false if the world has no triangles
+	bool getNearestGroundPosition(const KDL::Vector& in, KDL::Vector& out, KDL::Vector& normal) const;
+
+	bool isEmpty() const;
+	int getNumOverhangCells() const;
+
+private:
+	enum CellType
+	{
+		CELL_EMPTY = 0, CELL_GROUND, CELL_OVERHANG
+	};
+	// ground plane n.p = offset_ of a cell
+	struct Cell
+	{
+		float normal_[3];
+		float offset_;
+		char type_;
+	};
+	struct Triangle
+	{
+		Eigen::Vector3d vertices_[3];
+		Eigen::Vector3d normal_;
+	};
+	struct Node
+	{
+		Eigen::Vector3d min_;
+		Eigen::Vector3d max_;
+		int left_; /**< child node indices, -1 for leaves */
+		int right_;
+		int triangle_; /**< triangle index of leaves */
+	};
+
+	void addTriangles(const shapes::Mesh& mesh, const Eigen::Affine3d& pose);
+	void rasterize(double min_overhang_clearance);
+	int buildNode(std::vector<Node>& leaves, int begin, int end);
+	void findNearestTriangle(int node, const Eigen::Vector3d& point, double& best_squared_distance,
+			Eigen::Vector3d& best_position, int& best_triangle) const;
+	static double getSquaredDistance(const Node& node, const Eigen::Vector3d& point);
+
+	double resolution_;
+	double origin_[2]; /**< center of the cell (0, 0) */
+	int size_[2];
+	std::vector<Cell> cells_;
+	int num_overhang_cells_;
+
+	std::vector<Triangle> triangles_;
+	std::vector<Node> nodes_;
+	int root_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline bool GroundHeightmap::isEmpty() const
+{
+	return triangles_.empty();
+}
+
+inline int GroundHeightmap::getNumOverhangCells() const
+{
+	return num_overhang_cells_;
+}
+
+}
+
+#endif /* GROUND_HEIGHTMAP_H_ */
@@ -41,6 +41,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 #include <kdl/frames.hpp>
 #include <moveit/planning_scene/planning_scene.h>
+#include <itomp_ca_planner/contact/ground_heightmap.h>
 
 namespace itomp_ca_planner
 {
@@ -48,7 +49,8 @@ class GroundManager
 {
 public:
 	virtual ~GroundManager();
-	void init();
+	// builds the ground heightmap of the planning scene world if it has changed
+	void init(const planning_scene::PlanningSceneConstPtr& planning_scene);
 
 	static GroundManager& getInstance() { return instance_; }
     void getNearestGroundPosition(const KDL::Vector& in, KDL::Vector& out, KDL::Vector& normal, const planning_scene::PlanningSceneConstPtr& planning_scene) const;
@@ -58,6 +60,11 @@ private:
 	GroundManager();
 
 	static GroundManager instance_;
+
+	bool use_heightmap_;
+	GroundHeightmap heightmap_;
+	std::size_t world_hash_;
+	double heightmap_resolution_;
 };
 
 };
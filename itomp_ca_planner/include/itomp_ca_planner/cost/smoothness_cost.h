@@ -41,10 +41,13 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 #include <itomp_ca_planner/common.h>
 #include <itomp_ca_planner/trajectory/itomp_cio_trajectory.h>
+#include <itomp_ca_planner/util/differentiation_rules.h>
 
 namespace itomp_ca_planner
 {
 
+// x^T Q x with Q = sum_i w_i * D_i^T * D_i + ridge * I, evaluated with the
+// stencil kernels of the differentiation rules instead of a dense Q
 class SmoothnessCost
 {
 public:
@@ -52,43 +55,52 @@ public:
       double ridge_factor = 0.0);
   virtual ~SmoothnessCost();
 
-  const Eigen::MatrixXd& getQuadraticCostInverse() const;
-  const Eigen::MatrixXd& getQuadraticCost() const;
-
   double getCost(Eigen::MatrixXd::ColXpr joint_trajectory) const;
   double getCost(Eigen::MatrixXd::ConstColXpr joint_trajectory) const;
 
+  // gradient of getCost for all points of the joint trajectory
+  void computeGradient(const Eigen::VectorXd& joint_trajectory, Eigen::VectorXd& gradient) const;
+
   double getMaxQuadCostInvValue() const;
 
   void scale(double scale);
 
 private:
-  Eigen::MatrixXd quad_cost_full_;
-  Eigen::MatrixXd quad_cost_;
-  Eigen::MatrixXd quad_cost_inv_;
+  template<typename Derived>
+  double computeCost(const Eigen::MatrixBase<Derived>& joint_trajectory) const;
 
-  Eigen::MatrixXd getDiffMatrix(int size, const double* diff_rule) const;
+  std::vector<double> diff_rule_weights_; /**< w_i of each differentiation rule */
+  double ridge_factor_;
+  double scale_;
+  double max_quad_cost_inv_value_; /**< max. element of the inverse of the free block of Q */
 
 };
 
-inline const Eigen::MatrixXd& SmoothnessCost::getQuadraticCostInverse() const
+inline double SmoothnessCost::getCost(Eigen::MatrixXd::ColXpr joint_trajectory) const
 {
-  return quad_cost_inv_;
+  return computeCost(joint_trajectory);
 }
 
-inline const Eigen::MatrixXd& SmoothnessCost::getQuadraticCost() const
+inline double SmoothnessCost::getCost(Eigen::MatrixXd::ConstColXpr joint_trajectory) const
 {
-  return quad_cost_;
+  return computeCost(joint_trajectory);
 }
 
-inline double SmoothnessCost::getCost(Eigen::MatrixXd::ColXpr joint_trajectory) const
+inline double SmoothnessCost::getMaxQuadCostInvValue() const
 {
-  return joint_trajectory.dot(quad_cost_full_ * joint_trajectory);
+  return max_quad_cost_inv_value_;
 }
 
-inline double SmoothnessCost::getCost(Eigen::MatrixXd::ConstColXpr joint_trajectory) const
+template<typename Derived>
+double SmoothnessCost::computeCost(const Eigen::MatrixBase<Derived>& joint_trajectory) const
 {
-  return joint_trajectory.dot(quad_cost_full_ * joint_trajectory);
+  double cost = ridge_factor_ * joint_trajectory.squaredNorm();
+  for (unsigned int i = 0; i < diff_rule_weights_.size(); ++i)
+  {
+    if (diff_rule_weights_[i] != 0.0)
+      cost += diff_rule_weights_[i] * computeDiffRuleSquaredNorm(DIFF_RULES[i], joint_trajectory);
+  }
+  return scale_ * cost;
 }
 
 }
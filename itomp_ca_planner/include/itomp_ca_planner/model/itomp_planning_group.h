@@ -43,6 +43,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <kdl/tree.hpp>
 #include <itomp_ca_planner/model/itomp_robot_joint.h>
 #include <itomp_ca_planner/model/treefksolverjointposaxis_partial.hpp>
+#include <itomp_ca_planner/model/treefksolverjointposaxis_batch.hpp>
 #include <itomp_ca_planner/contact/contact_point.h>
 
 namespace itomp_ca_planner
@@ -57,11 +58,20 @@ public:
 	std::vector<std::string> link_names_; /**< Links used in planning */
 	std::vector<std::string> collision_link_names_; /**< Links used in collision checking */
 	boost::shared_ptr<KDL::TreeFkSolverJointPosAxisPartial> fk_solver_; /**< Forward kinematics solver for the group */
+	boost::shared_ptr<KDL::TreeFkSolverJointPosAxisBatch> batch_fk_solver_; /**< Forward kinematics solver for many waypoints at once */
 	std::vector<ContactPoint> contactPoints_;
 	std::map<int, int> kdl_to_group_joint_;
 
 	std::vector<std::string> getJointNames() const;
 	int getNumContacts() const;
+
+	/**
+	 * \brief Gets the rigid body of a KDL segment while planning this group
+	 *
+	 * Segments with the same index do not move relative to each other,
+	 * and the segments of index -1 do not move at all.
+	 */
+	int getRigidBodyIndex(int segment_index) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
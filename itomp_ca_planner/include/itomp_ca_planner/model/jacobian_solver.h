@@ -0,0 +1,134 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef JACOBIAN_SOLVER_H_
+#define JACOBIAN_SOLVER_H_
+
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/util/arena.h>
+#include <kdl/frames.hpp>
+
+namespace itomp_ca_planner
+{
+class ItompRobotModel;
+
+// Geometric Jacobians of the tip links of MoveIt joint model groups, assembled from the
+// joint positions and axes computed by the FK solver instead of updating a RobotState.
+// Like RobotState::getJacobian, the columns follow the variables of the group and the
+// rows are the linear then the angular velocity of the tip link origin.
+// The Jacobians of all groups of a waypoint are stored in one row of an arena array,
+// each as a column-major 6 x columns block.
+class JacobianSolver
+{
+public:
+	typedef Eigen::Map<const Eigen::Matrix<double, 6, Eigen::Dynamic> > ConstJacobian;
+	typedef Eigen::Matrix<double, 6, 6> EigenBasis;
+
+	JacobianSolver();
+	virtual ~JacobianSolver();
+
+	void clear();
+	// adds the tip link Jacobian of the group, returns its index or -1 if the robot
+	// model has no such group
+	int addGroup(const ItompRobotModel* robot_model, const std::string& group_name);
+	int getGroupIndex(const std::string& group_name) const;
+	int getNumGroups() const;
+	int getNumColumns(int group) const;
+	// size of one waypoint of the Jacobian buffer
+	int getNumEntries() const;
+
+	// Jacobians of all groups for the waypoints [begin, end)
+	void computeJacobians(int begin, int end, const ArenaArray2D<KDL::Vector>& joint_pos,
+			const ArenaArray2D<KDL::Vector>& joint_axis, const ArenaArray2D<KDL::Frame>& segment_frames,
+			ArenaArray2D<double>& jacobians) const;
+
+	ConstJacobian getJacobian(const ArenaArray2D<double>& jacobians, int point, int group) const;
+
+	// Smallest singular value of a Jacobian, from the eigenvalues of J J^T (or J^T J if
+	// J has less than 6 columns) computed with cyclic Jacobi rotations. basis holds the
+	// eigenvectors of the last call for the same waypoint; they nearly diagonalize the
+	// new matrix, so one sweep is usually enough. A zero basis starts from the identity.
+	static double computeMinSingularValue(const ConstJacobian& jacobian, EigenBasis& basis);
+
+private:
+	// a KDL joint moving the tip link, and the Jacobian column of its variable
+	struct JacobianJoint
+	{
+		int kdl_joint_;
+		int column_;
+		bool is_prismatic_;
+	};
+	struct JacobianGroup
+	{
+		std::string name_;
+		int tip_segment_;
+		int num_columns_;
+		int offset_; /**< of the block in a waypoint row */
+		std::vector<JacobianJoint> joints_;
+	};
+
+	std::vector<JacobianGroup> groups_;
+	int num_entries_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline int JacobianSolver::getNumGroups() const
+{
+	return groups_.size();
+}
+
+inline int JacobianSolver::getNumColumns(int group) const
+{
+	return groups_[group].num_columns_;
+}
+
+inline int JacobianSolver::getNumEntries() const
+{
+	return num_entries_;
+}
+
+inline JacobianSolver::ConstJacobian JacobianSolver::getJacobian(const ArenaArray2D<double>& jacobians, int point,
+		int group) const
+{
+	const JacobianGroup& jacobian_group = groups_[group];
+	return ConstJacobian(jacobians[point].data() + jacobian_group.offset_, 6, jacobian_group.num_columns_);
+}
+
+}
+
+#endif /* JACOBIAN_SOLVER_H_ */
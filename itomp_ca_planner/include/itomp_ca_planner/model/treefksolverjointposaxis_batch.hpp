@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Willow Garage nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef KDLTREEFKSOLVERJOINTPOSAXIS_BATCH_HPP
+#define KDLTREEFKSOLVERJOINTPOSAXIS_BATCH_HPP
+
+#include <kdl/tree.hpp>
+#include <kdl/frames.hpp>
+#include <Eigen/Core>
+#include <vector>
+
+namespace KDL
+{
+
+/**
+ * \brief Forward kinematics for many waypoints at once
+ * The tree is flattened into a parent index table at construction. Frames of
+ * all waypoints are stored as structure-of-arrays (one array per rotation /
+ * translation component) so the per-segment loops vectorize over waypoints.
+ * Returns the same joint positions, joint axes and segment frames as
+ * TreeFkSolverJointPosAxisPartial::JntToCartFull.
+ */
+class TreeFkSolverJointPosAxisBatch
+{
+public:
+	TreeFkSolverJointPosAxisBatch() : num_joints_(0), num_segments_(0), reference_frame_index_(0), capacity_(0) {}
+	TreeFkSolverJointPosAxisBatch(const Tree& tree,
+			const std::string& reference_frame);
+	~TreeFkSolverJointPosAxisBatch();
+
+	/**
+	 * \brief Computes FK for the rows of q listed in rows.
+	 * The outputs are row-major arrays: the result of rows[i] starts at
+	 * element i * getNrOfJoints() of joint_pos / joint_axis and at
+	 * element i * getNumSegments() of segment_frames.
+	 */
+	int JntToCartBatch(const Eigen::MatrixXd& q, const std::vector<int>& rows,
+			Vector* joint_pos, Vector* joint_axis, Frame* segment_frames);
+
+	/**
+	 * \brief Batched counterpart of TreeFkSolverJointPosAxisPartial::JntToCartPartial.
+	 * Only the segments of the partial evaluation order are recomputed; the
+	 * outputs must hold a previous JntToCartBatch result for the same rows.
+	 */
+	int JntToCartBatchPartial(const Eigen::MatrixXd& q,
+			const std::vector<int>& rows, Vector* joint_pos, Vector* joint_axis,
+			Frame* segment_frames);
+
+	/** \brief Segments recomputed by JntToCartBatchPartial, parents first */
+	void setPartialEvaluationOrder(const std::vector<int>& segment_order);
+
+	int getNrOfJoints() const { return num_joints_; }
+	int getNumSegments() const { return num_segments_; }
+
+private:
+	enum JOINT_KIND
+	{
+		JOINT_KIND_FIXED = 0,
+		JOINT_KIND_ROTATIONAL,
+		JOINT_KIND_TRANSLATIONAL
+	};
+
+	int flattenTree(const SegmentMap::const_iterator this_segment,
+			int segment_nr, int parent_segment_nr);
+	void reserve(int num_points);
+	void gatherJointValues(const Eigen::MatrixXd& q, const std::vector<int>& rows);
+	void computeSegment(int s, int num_points, Vector* joint_pos,
+			Vector* joint_axis);
+
+	int num_joints_;
+	int num_segments_;
+	std::string reference_frame_;
+	int reference_frame_index_;
+
+	// flattened tree, indexed by segment number (parents precede children)
+	std::vector<int> segment_parent_;
+	std::vector<int> segment_q_nr_;
+	std::vector<int> segment_joint_kind_;
+	std::vector<double> segment_joint_scale_;
+	std::vector<double> segment_joint_axis_; /**< 3 per segment, in the parent frame */
+	std::vector<double> segment_joint_origin_; /**< 3 per segment, in the parent frame */
+	std::vector<double> segment_pose_zero_; /**< 12 per segment (row-major rotation, translation) at q = 0 */
+	std::vector<int> partial_segment_order_;
+	std::vector<int> partial_seed_segments_; /**< parents of partial_segment_order_ which are not recomputed */
+
+	// per-call buffers, component-major: [(segment * 12 + component) * capacity_ + point]
+	int capacity_;
+	std::vector<double> q_;
+	std::vector<double> frames_;
+};
+
+} // namespace KDL
+
+#endif
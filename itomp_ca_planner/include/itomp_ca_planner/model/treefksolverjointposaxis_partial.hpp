@@ -61,12 +61,36 @@ public:
 	int
 			JntToCartFull(const JntArray& q_in, std::vector<Vector>& joint_pos,
 					std::vector<Vector>& joint_axis,
-					std::vector<Frame>& segment_frames);
+					std::vector<Frame>& segment_frames) const;
+	/** \brief Writes into preallocated arrays of getNrOfJoints() / getNumSegments() elements */
+	int
+			JntToCartFull(const JntArray& q_in, Vector* joint_pos,
+					Vector* joint_axis, Frame* segment_frames) const;
+
+	/**
+	 * \brief Updates only the segments downstream of the active joints.
+	 * The other segment frames, joint positions and axes are read from the
+	 * arguments, which must hold the result of a previous JntToCartFull call
+	 * with the same values for the inactive joints.
+	 */
 	int
 			JntToCartPartial(const JntArray& q_in,
 					std::vector<Vector>& joint_pos,
 					std::vector<Vector>& joint_axis,
 					std::vector<Frame>& segment_frames) const;
+	int
+			JntToCartPartial(const JntArray& q_in, Vector* joint_pos,
+					Vector* joint_axis, Frame* segment_frames) const;
+
+	/** false if the reference frame moves with the active joints */
+	bool isPartialFKAvailable() const { return partial_fk_available_; }
+	const std::vector<int>& getSegmentEvaluationOrder() const { return segment_evaluation_order_; }
+
+	/**
+	 * \brief Segments with the same index do not move relative to each other when only
+	 * the active joints change. -1 for the segments which do not move.
+	 */
+	int getRigidBodyIndex(int segment_nr) const { return segment_rigid_body_[segment_nr]; }
 
 	const std::vector<std::string> getSegmentNames() const;
 	const std::map<std::string, int> getSegmentNameToIndex() const;
@@ -75,11 +99,12 @@ public:
 	int getNumSegments() const { return num_segments_; }
 
 private:
-	int treeRecursiveFK(const JntArray& q_in, std::vector<Vector>& joint_pos,
-			std::vector<Vector>& joint_axis,
-			std::vector<Frame>& segment_frames, const Frame& previous_frame,
-			const SegmentMap::const_iterator this_segment, int segment_nr,
-			int parent_segment_nr, bool active);
+	int treeRecursiveFK(const JntArray& q_in, Vector* joint_pos,
+			Vector* joint_axis, Frame* segment_frames,
+			const Frame& previous_frame,
+			const SegmentMap::const_iterator this_segment, int segment_nr) const;
+	int buildEvaluationOrder(const SegmentMap::const_iterator this_segment,
+			int segment_nr, int parent_segment_nr, bool active, int rigid_body);
 
 	std::vector<std::string> segment_names_;
 	std::map<std::string, int> segment_name_to_index_;
@@ -89,10 +114,11 @@ private:
 	int num_joints_;
 	int num_segments_;
 
-	std::vector<Frame> segment_frames_; /**< local cache of all segment frames needed for partial FK */
+	bool partial_fk_available_;
 	std::vector<int> segment_evaluation_order_; /**< what order should we evaluate segments in */
 	std::vector<int> segment_parent_frame_nr_; /**< the parent frame number for each segment */
 	std::vector<const TreeElement*> segment_parent_; /**< the parent segment for each segment */
+	std::vector<int> segment_rigid_body_; /**< the segment after the nearest upstream active joint */
 	std::vector<int> joint_parent_frame_nr_; /**< the parent frame number for each joint */
 	std::vector<const TreeElement*> joint_parent_; /**< the parent segment for each joint */
 	std::vector<bool> active_joints_; /**< which are the joints that will change in calls to partial FK */
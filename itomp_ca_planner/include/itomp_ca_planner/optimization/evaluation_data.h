@@ -40,21 +40,105 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 #include <itomp_ca_planner/common.h>
 #include <itomp_ca_planner/model/itomp_robot_model.h>
+#include <itomp_ca_planner/model/jacobian_solver.h>
 #include <itomp_ca_planner/trajectory/itomp_cio_trajectory.h>
 #include <itomp_ca_planner/cost/smoothness_cost.h>
 #include <itomp_ca_planner/cost/trajectory_cost_accumulator.h>
 #include <itomp_ca_planner/util/vector_util.h>
+#include <itomp_ca_planner/util/arena.h>
 #include <kdl/frames.hpp>
 #include <kdl/jntarray.hpp>
 #include <Eigen/StdVector>
 #include <moveit/planning_scene/planning_scene.h>
 #include <itomp_ca_planner/contact/contact_force_solver.h>
+#include <itomp_ca_planner/collision/collision_cost_query.h>
+#include <itomp_ca_planner/collision/collision_cache.h>
 
 namespace itomp_ca_planner
 {
 class EvaluationManager;
 class ItompPlanningGroup;
-class EvaluationData
+
+// Per-waypoint buffers of EvaluationData. All arrays live in one arena, in the order the
+// evaluation stages use them, so copying or cloning the data is a single bulk copy.
+// Arrays indexed by waypoint first are [point][...], the finite difference inputs are
+// [segment or contact][point] so each one is contiguous over the trajectory.
+class EvaluationBuffers
+{
+public:
+  EvaluationBuffers();
+  EvaluationBuffers(const EvaluationBuffers& buffers);
+  EvaluationBuffers& operator=(const EvaluationBuffers& buffers);
+
+  void allocateBuffers(int num_points, int num_kdl_joints, int num_segments, int num_mass_segments, int num_contacts,
+      int num_collision_spheres, int num_jacobian_entries);
+
+  // Snapshot of the waypoints [begin, end) of every buffer, for evaluations which
+  // change a small window of the trajectory and have to be undone afterwards.
+  // A shadow arena mirrors the buffers, so beginning a transaction copies only the
+  // window and rolling back swaps the two arenas.
+  void beginTransaction(int begin, int end);
+  void commitTransaction();
+  void rollbackTransaction();
+  // has to be called for writes to the buffers outside of a transaction
+  void markShadowStale(int begin, int end);
+  // same for a stage window [begin, end) of the free waypoints [free_begin, free_end).
+  // A window reaching either end also rewrites the fixed waypoints beyond it.
+  void markWindowStale(int begin, int end, int free_begin, int free_end);
+
+  // forward kinematics
+  ArenaArray2D<KDL::Vector> joint_axis_;
+  ArenaArray2D<KDL::Vector> joint_pos_;
+  ArenaArray2D<KDL::Frame> segment_frames_;
+  // 1 if segment_frames_ of the waypoint hold a full FK result which partial FK can update
+  ArenaArray<int> segment_frames_initialized_;
+  // tip link Jacobians of the JacobianSolver groups
+  ArenaArray2D<double> jacobians_;
+
+  ArenaArray<int> state_is_in_collision_;
+  // gradients of the collision cost w.r.t. the collision sphere centers, for the sdf backend
+  ArenaArray2D<KDL::Vector> collision_sphere_gradients_;
+  ArenaArray<int> state_validity_;
+
+  // physics
+  ArenaArray2D<KDL::Vector> linkPositions_;
+  ArenaArray2D<KDL::Vector> linkVelocities_;
+  ArenaArray2D<KDL::Vector> linkAngularVelocities_;
+  ArenaArray<KDL::Vector> CoMPositions_;
+  ArenaArray<KDL::Vector> CoMVelocities_;
+  ArenaArray<KDL::Vector> CoMAccelerations_;
+  ArenaArray<KDL::Vector> AngularMomentums_;
+  ArenaArray<KDL::Vector> Torques_;
+  ArenaArray<KDL::Wrench> wrenchSum_;
+  ArenaArray2D<Vector4d> contactViolationVector_;
+  ArenaArray2D<KDL::Vector> contactPointVelVector_;
+  ArenaArray2D<KDL::Vector> contact_forces_;
+
+  ArenaArray<double> stateContactInvariantCost_;
+  ArenaArray<double> statePhysicsViolationCost_;
+  ArenaArray<double> stateCollisionCost_;
+  ArenaArray<double> stateFTRCost_;
+  ArenaArray<double> stateCartesianTrajectoryCost_;
+  ArenaArray<double> stateSingularityCost_;
+  // eigenvectors of J J^T of the last singularity cost evaluation, to warm start the next
+  ArenaArray<JacobianSolver::EigenBasis> singularity_bases_;
+
+protected:
+  void bindBuffers();
+  void copyWindow(Arena& dst, const Arena& src, int begin, int end) const;
+
+  Arena arena_;
+
+  Arena shadow_arena_;
+  bool is_shadow_valid_;
+  // the waypoints where the shadow differs from arena_
+  int shadow_stale_begin_;
+  int shadow_stale_end_;
+  int transaction_begin_;
+  int transaction_end_;
+};
+
+class EvaluationData : public EvaluationBuffers
 {
 public:
   EvaluationData();
@@ -62,8 +146,8 @@ public:
 
   void initialize(ItompCIOTrajectory *full_trajectory, ItompCIOTrajectory *group_trajectory,
       ItompRobotModel *robot_model, const ItompPlanningGroup *planning_group,
-      const EvaluationManager* evaluation_manager, int num_mass_segments,
-      const moveit_msgs::Constraints& path_constraints,
+      const EvaluationManager* evaluation_manager, int num_mass_segments, int num_collision_spheres,
+      int num_jacobian_entries, const moveit_msgs::Constraints& path_constraints,
       const planning_scene::PlanningSceneConstPtr& planning_scene);
 
   double getNumPoints() const;
@@ -81,50 +165,37 @@ public:
 
   std::vector<itomp_ca_planner::SmoothnessCost> joint_costs_;
 
-  std::vector<std::vector<KDL::Vector> > joint_axis_;
-  std::vector<std::vector<KDL::Vector> > joint_pos_;
-  std::vector<std::vector<KDL::Frame> > segment_frames_;
-
-  std::vector<int> state_is_in_collision_;
-  std::vector<int> state_validity_;
-
   Eigen::VectorXd dynamic_obstacle_cost_;
 
-  // physics
-  std::vector<KDL::Wrench> wrenchSum_;
-  std::vector<std::vector<KDL::Vector> > linkPositions_;
-  std::vector<std::vector<KDL::Vector> > linkVelocities_;
-  std::vector<std::vector<KDL::Vector> > linkAngularVelocities_;
-  std::vector<KDL::Vector> CoMPositions_;
-  std::vector<KDL::Vector> CoMVelocities_;
-  std::vector<KDL::Vector> CoMAccelerations_;
-  std::vector<KDL::Vector> AngularMomentums_;
-  std::vector<KDL::Vector> Torques_;
-  std::vector<std::vector<Vector4d> > contactViolationVector_;
-  std::vector<std::vector<KDL::Vector> > contactPointVelVector_;
-
-  std::vector<double> stateContactInvariantCost_;
-  std::vector<double> statePhysicsViolationCost_;
-  std::vector<double> stateCollisionCost_;
-  std::vector<double> stateFTRCost_;
-  std::vector<double> stateCartesianTrajectoryCost_;
-  std::vector<double> stateSingularityCost_;
-
-  std::vector<std::vector<KDL::Vector> > contact_forces_;
-
   TrajectoryCostAccumulator costAccumulator_;
 
   KDL::TreeFkSolverJointPosAxisPartial fk_solver_;
+  KDL::TreeFkSolverJointPosAxisBatch batch_fk_solver_;
+  std::vector<int> batch_fk_rows_;
   ContactForceSolver contact_force_solver_;
 
   planning_scene::PlanningSceneConstPtr planning_scene_;
   std::vector<robot_state::RobotStatePtr> kinematic_state_;
 
+  // per waypoint-thread collision checking buffers
+  std::vector<collision_detection::CollisionResult> collision_results_;
+  std::vector<std::vector<double> > collision_positions_;
+  std::vector<CollisionCostWorkspace> collision_workspaces_;
+  // depth sums of the collision pairs the planning group cannot move, -1 until computed
+  std::vector<double> static_collision_depths_;
+  CollisionCache collision_cache_;
+
   std::vector<KDL::Frame> cartesian_waypoints_;
 
   EvaluationData* clone() const;
   void deepCopy(const EvaluationData& data);
 
+  // Dirty-range tracking: [begin, end) covers every waypoint whose joint or contact values
+  // differ from the last evaluated trajectories, or all waypoints if there is none.
+  void getDirtyRange(int& begin, int& end) const;
+  void updateEvaluatedTrajectory();
+  void invalidateEvaluatedTrajectory();
+
   void compare(const EvaluationData& ref) const;
 
 protected:
@@ -134,6 +205,13 @@ protected:
 
   ItompCIOTrajectory* group_trajectory_;
   ItompCIOTrajectory* full_trajectory_;
+
+  // true for the instances created by clone(), which allocate their own trajectories
+  bool owns_trajectories_;
+
+  Eigen::MatrixXd evaluated_trajectory_;
+  Eigen::MatrixXd evaluated_contact_trajectory_;
+  bool is_evaluated_trajectory_valid_;
 };
 typedef boost::shared_ptr<EvaluationData> EvaluationDataPtr;
 
@@ -173,6 +251,13 @@ inline void EvaluationData::setTrajectories(ItompCIOTrajectory* group_trajectory
 {
   group_trajectory_ = group_trajectory;
   full_trajectory_ = full_trajectory;
+  is_evaluated_trajectory_valid_ = false;
+  segment_frames_initialized_.fill(0);
+}
+
+inline void EvaluationData::invalidateEvaluatedTrajectory()
+{
+  is_evaluated_trajectory_valid_ = false;
 }
 
 }
@@ -41,11 +41,18 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/common.h>
 #include <itomp_ca_planner/optimization/evaluation_data.h>
 #include <itomp_ca_planner/model/itomp_robot_model.h>
+#include <itomp_ca_planner/model/jacobian_solver.h>
 #include <itomp_ca_planner/trajectory/itomp_cio_trajectory.h>
 #include <itomp_ca_planner/cost/smoothness_cost.h>
 #include <itomp_ca_planner/cost/trajectory_cost_accumulator.h>
+#include <itomp_ca_planner/collision/signed_distance_field.h>
+#include <itomp_ca_planner/collision/link_sphere_model.h>
+#include <itomp_ca_planner/collision/collision_prefilter.h>
+#include <itomp_ca_planner/collision/collision_cost_query.h>
+#include <itomp_ca_planner/util/differentiation_rules.h>
 #include <kdl/frames.hpp>
 #include <kdl/jntarray.hpp>
+#include <kdl/rotationalinertia.hpp>
 #include <ros/publisher.h>
 #include <moveit/planning_scene/planning_scene.h>
 
@@ -54,31 +61,6 @@ namespace itomp_ca_planner
 class ItompPlanningGroup;
 class EvaluationManager
 {
-  class BackupData
-  {
-  public:
-    double trajectory_value_;
-
-    std::vector<std::vector<KDL::Frame> > segment_frames_;
-
-    std::vector<KDL::Wrench> wrenchSum_;
-    std::vector<std::vector<KDL::Vector> > linkPositions_;
-    std::vector<std::vector<KDL::Vector> > linkVelocities_;
-    std::vector<std::vector<KDL::Vector> > linkAngularVelocities_;
-    std::vector<KDL::Vector> CoMPositions_;
-    std::vector<KDL::Vector> CoMVelocities_;
-    std::vector<KDL::Vector> CoMAccelerations_;
-    std::vector<KDL::Vector> AngularMomentums_;
-    std::vector<KDL::Vector> Torques_;
-    std::vector<std::vector<Vector4d> > contactViolationVector_;
-    std::vector<std::vector<KDL::Vector> > contactPointVelVector_;
-
-    std::vector<double> state_collision_cost_;
-    std::vector<double> state_contact_invariant_cost_;
-    std::vector<double> state_physics_violation_cost_;
-    std::vector<double> state_ftr_cost_;
-  };
-
 public:
   enum DERIVATIVE_VARIABLE_TYPE
   {
@@ -106,6 +88,14 @@ public:
 
   bool isLastTrajectoryFeasible() const;
 
+  // collision_backend "sdf" only: gradient of the collision costs of the last evaluation
+  // with respect to the group joints, num_points x num_joints. Not available if the
+  // group has self collision pairs, their FCL depths are not differentiated
+  bool hasCollisionCostGradient() const;
+  // a waypoint cost depends on the joint values of the waypoints within this radius
+  static int getCostDependencyRadius();
+  void computeCollisionCostGradient(Eigen::MatrixXd& gradient) const;
+
   void handleJointLimits();
   void updateFullTrajectory();
   void render(int trajectory_index, bool is_best);
@@ -113,6 +103,7 @@ public:
   const ItompCIOTrajectory* getGroupTrajectoryConst() const;
   const ItompCIOTrajectory* getFullTrajectoryConst() const;
   const ItompPlanningGroup* getPlanningGroup() const;
+  const CollisionPrefilter* getCollisionPrefilter() const;
 
   double getTrajectoryCost(bool verbose = false);
 
@@ -139,11 +130,19 @@ private:
 
   void updateFullTrajectory(int point_index, int joint_index);
   bool performForwardKinematics(int begin, int end);
+  void computeForwardKinematics(int point);
+  void getDerivativeWindow(int free_point_index, int& begin, int& end);
   void computeWrenchSum(int begin, int end);
   void computeStabilityCosts(int begin, int end);
   void computeCollisionCosts(int begin, int end);
+  void computeSignedDistanceCollisionCosts(int begin, int end);
+  void computeJacobians(int begin, int end);
+  // force transmission ratio costs of the limbs. Reads contact_forces_, so it runs
+  // after computeStabilityCosts
   void computeFTRs(int begin, int end);
+  double computeFTR(int point, int contact_point_index, int jacobian_group) const;
   void computeSingularityCosts(int begin, int end);
+  void initializeCollisionGradientChains();
 
   void backupAndSetVariables(double new_value, DERIVATIVE_VARIABLE_TYPE variable_type, int free_point_index,
       int joint_index);
@@ -185,16 +184,43 @@ private:
 
   bool trajectory_validity_;
 
+  LinkSphereModel link_sphere_model_;
+  // collision_backend "sdf", with collision_cost_query_ for the self collision pairs
+  SignedDistanceFieldConstPtr signed_distance_field_;
+  // broad phase of the planning scene collision checks, shared by the copies for rollouts
+  CollisionPrefilterPtr collision_prefilter_;
+  CollisionCostQueryConstPtr collision_cost_query_;
+  // group joints moving each collision sphere segment, for the SDF collision cost gradient
+  struct ChainJoint
+  {
+    int kdl_joint_;
+    int group_joint_;
+    bool is_prismatic_;
+  };
+  std::vector<std::vector<ChainJoint> > segment_chains_; /**< [segment index] */
+
+  // Jacobians of the FTR limbs and of the planning group, from the FK results
+  JacobianSolver jacobian_solver_;
+
   // physics
+  // segments with mass, in KDL::SegmentMap order (the order of linkPositions_ etc.)
+  struct MassSegment
+  {
+    int segment_index_; /**< index into segment_frames_ */
+    double mass_; /**< normalized mass */
+    double kdl_mass_; /**< mass of the KDL inertia, used for the rotational term */
+    KDL::Vector cog_; /**< center of gravity in the segment frame */
+    KDL::RotationalInertia cog_inertia_; /**< rotational inertia about the COG in the segment frame */
+  };
   double total_mass_;
-  std::vector<double> masses_;
+  std::vector<MassSegment> mass_segments_;
   int num_mass_segments_;
   KDL::Vector gravity_force_;
 
   ros::Publisher vis_marker_array_pub_;
   ros::Publisher vis_marker_pub_;
 
-  BackupData backup_data_;
+  double backup_trajectory_value_;
 
   // TODO: refactoring
   int getSegmentIndex(int link, bool isLeft) const;
@@ -215,6 +241,18 @@ inline bool EvaluationManager::isLastTrajectoryFeasible() const
   return last_trajectory_collision_free_;
 }
 
+inline bool EvaluationManager::hasCollisionCostGradient() const
+{
+  return signed_distance_field_.get() != NULL && collision_cost_query_.get() == NULL;
+}
+
+inline int EvaluationManager::getCostDependencyRadius()
+{
+  // the torques differentiate the angular momentums, which hold the differentiated link
+  // positions and the backward differences of the link rotations
+  return 2 * getDiffRuleRadius() + 1;
+}
+
 inline const KDL::Vector& EvaluationManager::getSegmentPosition(int point, const std::string& segmentName) const
 {
   int sn = robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(segmentName);
@@ -246,6 +284,11 @@ inline const ItompPlanningGroup* EvaluationManager::getPlanningGroup() const
   return planning_group_;
 }
 
+inline const CollisionPrefilter* EvaluationManager::getCollisionPrefilter() const
+{
+  return collision_prefilter_.get();
+}
+
 inline ItompCIOTrajectory* EvaluationManager::getGroupTrajectory()
 {
   return data_->getGroupTrajectory();
@@ -40,6 +40,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 #include <itomp_ca_planner/common.h>
 #include <itomp_ca_planner/optimization/evaluation_manager.h>
+#include <itomp_ca_planner/util/worker_pool.h>
 
 namespace itomp_ca_planner
 {
@@ -50,15 +51,33 @@ public:
   ImprovementManager();
   virtual ~ImprovementManager();
 
-  virtual void initialize(EvaluationManager *evaluation_manager);
+  virtual void initialize(EvaluationManager *evaluation_manager, WorkerPool *worker_pool = NULL);
   virtual bool updatePlanningParameters();
   virtual void runSingleIteration(int iteration) = 0;
 
+  // rollouts evaluated, and rollouts whose known state costs were reused instead
+  unsigned long getNumRolloutEvaluations() const;
+  unsigned long getNumSkippedRolloutEvaluations() const;
+
 protected:
   EvaluationManager *evaluation_manager_;
+  WorkerPool *worker_pool_;
   int last_planning_parameter_index_;
+
+  unsigned long num_rollout_evaluations_;
+  unsigned long num_skipped_rollout_evaluations_;
 };
 
+inline unsigned long ImprovementManager::getNumRolloutEvaluations() const
+{
+  return num_rollout_evaluations_;
+}
+
+inline unsigned long ImprovementManager::getNumSkippedRolloutEvaluations() const
+{
+  return num_skipped_rollout_evaluations_;
+}
+
 typedef boost::shared_ptr<ImprovementManager> ImprovementManagerPtr;
 }
 ;
@@ -56,12 +56,21 @@ public:
   virtual bool updatePlanningParameters();
   virtual void runSingleIteration(int iteration);
 
-private:
+protected:
+  // sampling distribution of the joint noise: noise = stddev * sample
+  virtual double getNoiseStddev(int dimension, int iteration) const;
+  virtual void sampleNoise(int dimension, Eigen::VectorXd& noise);
+  // called after the parameter update, with the rollout probabilities of the iteration
+  virtual void adaptNoise();
+
   void initializeCosts();
   void initializeNoiseGenerators();
   void initializeRollouts();
+  void initializeRolloutEvaluators();
   bool preAllocateTempVariables();
   bool generateRollouts(const std::vector<double>& noise_stddev, const std::vector<double>& contact_noise_stddev);
+  void evaluateRollouts();
+  void evaluateRolloutsOnWorker(int worker);
   void copyGroupTrajectory();
   bool setRolloutCosts();
   void computeUpdates();
@@ -75,6 +84,7 @@ private:
   bool computeNoise(Rollout& rollout);
   bool computeProjectedNoise(Rollout& rollout);
   void computeRolloutControlCost(Rollout& rollout);
+  void projectInPlace(Eigen::VectorXd& vector) const;
 
   int last_planning_parameter_index_;
 
@@ -110,6 +120,7 @@ private:
   int num_rollouts_reused_;
   int num_rollouts_extra_;
   int num_rollouts_gen_;
+  int num_rollouts_noiseless_; /**< generated rollouts at the front of rollouts_ without noise */
   bool rollouts_reused_; /**< Are we reusing rollouts for this iteration? */
   bool rollouts_reused_next_; /**< Can we reuse rollouts for the next iteration? */
   bool extra_rollouts_added_; /**< Have the "extra rollouts" been added for use in the next iteration? */
@@ -118,15 +129,22 @@ private:
   std::vector<Rollout> rollouts_;
   std::vector<Rollout> reused_rollouts_;
   std::vector<Rollout> extra_rollouts_;
-
-  std::vector<Eigen::MatrixXd> differentiation_matrices_;
-  std::vector<Eigen::MatrixXd> control_costs_all_;
-  std::vector<Eigen::MatrixXd> control_costs_; /**< [num_dimensions] num_parameters x num_parameters */
-  std::vector<Eigen::MatrixXd> inv_control_costs_; /**< [num_dimensions] num_parameters x num_parameters */
-  std::vector<Eigen::MatrixXd> projection_matrix_; /**< [num_dimensions] num_parameters x num_parameters */
+  std::vector<int> rollouts_to_evaluate_; /**< rollouts of this iteration whose state costs are not known yet */
+
+  // rollout-parallel evaluation: one EvaluationData clone and evaluator per worker thread
+  int num_rollout_threads_;
+  std::vector<EvaluationDataPtr> rollout_data_;
+  std::vector<EvaluationManagerPtr> rollout_evaluation_managers_;
+  std::vector<Eigen::VectorXd> tmp_rollout_costs_; /**< [num_rollout_threads] num_time_steps */
+  int next_rollout_; /**< next entry of rollouts_to_evaluate_ to be evaluated by a worker pool task */
+  boost::mutex next_rollout_mutex_;
+
+  std::vector<double> diff_rule_weights_; /**< [NUM_DIFF_RULES] smoothness cost weight of each differentiation rule */
+  BandedCholesky control_cost_cholesky_; /**< factor of the control cost of the free variables (same for every dimension) */
+  Eigen::VectorXd projection_scales_; /**< num_parameters: column scales of the smooth noise projection */
   double control_cost_weight_;
 
-  std::vector<MultivariateGaussian> noise_generators_; /**< objects that generate noise for each dimension */
+  std::vector<BandedMultivariateGaussian> noise_generators_; /**< objects that generate noise for each dimension */
   std::vector<MultivariateGaussian> contact_noise_generators_; /**< objects that generate noise for each dimension */
 
   // temporary variables pre-allocated for efficiency:
@@ -137,7 +155,10 @@ private:
   Eigen::VectorXd tmp_min_cost_; /**< num_time_steps */
   Eigen::VectorXd tmp_max_minus_min_cost_; /**< num_time_steps */
   Eigen::VectorXd tmp_sum_rollout_probabilities_; /**< num_time_steps */
-  std::vector<Eigen::MatrixXd> parameter_updates_; /**< [num_dimensions] num_time_steps x num_parameters */
+  Eigen::MatrixXd tmp_control_parameters_; /**< num_vars_all x num_dimensions */
+  Eigen::MatrixXd tmp_control_derivatives_; /**< num_vars_all x num_dimensions */
+  Eigen::MatrixXd tmp_control_costs_; /**< num_vars_all x num_dimensions */
+  std::vector<Eigen::VectorXd> parameter_updates_; /**< [num_dimensions] num_parameters */
   std::vector<Eigen::VectorXd> contact_parameter_updates_; /**< [num_dimensions] num_time_steps x num_parameters */
   std::vector<Eigen::VectorXd> time_step_weights_; /**< [num_dimensions] num_time_steps: Weights computed for updates per time-step */
 
@@ -0,0 +1,87 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef IMPROVEMENT_MANAGER_CMA_H_
+#define IMPROVEMENT_MANAGER_CMA_H_
+
+#include <itomp_ca_planner/optimization/improvement_manager_chomp.h>
+
+namespace itomp_ca_planner
+{
+
+// The rollout sampler of ImprovementManagerChomp with the joint noise distribution
+// adapted by CMA-ES instead of the noise_decay schedule (the contact noise keeps the
+// schedule). The noise of a joint is sigma * L^-T (sqrt(c) .* z), where LL^T is the
+// control cost (the smoothness prior).
+// The step size sigma follows cumulative step-size adaptation, and the variances c of
+// the prior-whitened noise follow the rank-one and rank-mu updates of separable
+// CMA-ES, so the correlation between time steps stays banded and a sample costs O(T).
+// The rollout weights are the time averages of the rollout probabilities, taken over
+// the rollouts sampled in the iteration only.
+class ImprovementManagerCMA: public ImprovementManagerChomp
+{
+public:
+  ImprovementManagerCMA();
+  virtual ~ImprovementManagerCMA();
+
+  virtual bool updatePlanningParameters();
+
+protected:
+  virtual double getNoiseStddev(int dimension, int iteration) const;
+  virtual void sampleNoise(int dimension, Eigen::VectorXd& noise);
+  virtual void adaptNoise();
+
+private:
+  void adaptNoise(int dimension);
+
+  std::vector<double> sigmas_; /**< [num_dimensions] step size */
+  std::vector<Eigen::VectorXd> variances_; /**< [num_dimensions] num_parameters: c */
+  std::vector<Eigen::VectorXd> variance_sqrts_; /**< [num_dimensions] num_parameters: sqrt(c) */
+  std::vector<Eigen::VectorXd> sigma_paths_; /**< [num_dimensions] num_parameters: evolution path of sigma */
+  std::vector<Eigen::VectorXd> covariance_paths_; /**< [num_dimensions] num_parameters: evolution path of c */
+
+  // temporary variables pre-allocated for efficiency:
+  Eigen::VectorXd tmp_rollout_weights_; /**< num_rollouts */
+  Eigen::VectorXd tmp_whitened_noise_; /**< num_parameters */
+  Eigen::VectorXd tmp_mean_step_; /**< num_parameters */
+  Eigen::VectorXd tmp_rank_mu_; /**< num_parameters */
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef IMPROVEMENT_MANAGER_GRADIENT_H_
+#define IMPROVEMENT_MANAGER_GRADIENT_H_
+
+#include <itomp_ca_planner/optimization/improvement_manager.h>
+#include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/optimization/evaluation_manager.h>
+#include <itomp_ca_planner/util/banded_cholesky.h>
+
+namespace itomp_ca_planner
+{
+
+// Covariant functional gradient descent (CHOMP) on the free waypoints. The cost
+// gradient is preconditioned by the inverse of the banded smoothness metric, so a
+// step changes the trajectory smoothly. Smoothness and SDF collision costs have
+// analytic gradients; the other costs are differentiated by finite differences of
+// the waypoint costs, perturbing every (2r + 1)-th waypoint at once.
+class ImprovementManagerGradient: public ImprovementManager
+{
+public:
+  ImprovementManagerGradient();
+  virtual ~ImprovementManagerGradient();
+
+  virtual bool updatePlanningParameters();
+  virtual void runSingleIteration(int iteration);
+
+private:
+  void initializeMetric();
+  void copyGroupTrajectory();
+  double evaluate(const std::vector<Eigen::VectorXd>& parameters, Eigen::VectorXd& state_costs);
+  void computeGradient();
+  void computeFiniteDifferenceGradient();
+  void computeDirections();
+
+  int num_dimensions_;
+  int num_contact_dimensions_;
+  int num_time_steps_;
+  int free_vars_start_index_;
+
+  std::vector<Eigen::VectorXd> parameters_; /**< [num_dimensions] num_parameters */
+  std::vector<Eigen::VectorXd> contact_parameters_;
+  std::vector<Eigen::VectorXd> candidate_parameters_; /**< [num_dimensions] num_parameters */
+  std::vector<Eigen::VectorXd> directions_; /**< [num_dimensions] num_parameters */
+
+  BandedCholesky metric_cholesky_; /**< smoothness metric of the free variables */
+
+  double cost_; /**< trajectory cost of parameters_ */
+  Eigen::VectorXd state_costs_; /**< num_time_steps: waypoint costs of parameters_ */
+  bool is_evaluated_; /**< the evaluation manager holds the evaluation of parameters_ */
+  bool use_finite_differences_; /**< some costs with nonzero weight have no analytic gradient */
+  double step_size_;
+  double max_step_size_;
+
+  // temporary variables pre-allocated for efficiency:
+  Eigen::MatrixXd gradient_; /**< num_time_steps x num_dimensions */
+  Eigen::MatrixXd collision_gradient_; /**< num_points x num_dimensions */
+  Eigen::VectorXd tmp_state_costs_; /**< num_time_steps */
+  Eigen::VectorXd tmp_joint_trajectory_; /**< num_points */
+  Eigen::VectorXd tmp_joint_gradient_; /**< num_points */
+};
+
+}
+
+#endif
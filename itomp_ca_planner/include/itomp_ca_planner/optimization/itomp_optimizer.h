@@ -43,6 +43,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/optimization/evaluation_manager.h>
 #include <itomp_ca_planner/optimization/improvement_manager.h>
 #include <itomp_ca_planner/optimization/best_cost_manager.h>
+#include <itomp_ca_planner/util/worker_pool.h>
 
 namespace itomp_ca_planner
 {
@@ -55,7 +56,7 @@ public:
 	ItompOptimizer(int trajectory_index, ItompCIOTrajectory* trajectory, ItompRobotModel *robot_model,
 			const ItompPlanningGroup *planning_group, double planning_start_time, double trajectory_start_time,
 			const moveit_msgs::Constraints& path_constraints, BestCostManager* best_cost_manager,
-			const planning_scene::PlanningSceneConstPtr& planning_scene);
+			const planning_scene::PlanningSceneConstPtr& planning_scene, WorkerPool* worker_pool = NULL);
 	virtual ~ItompOptimizer();
 
 	bool optimize();
@@ -66,7 +67,7 @@ public:
 private:
 	void initialize(ItompRobotModel *robot_model, const ItompPlanningGroup *planning_group,
 			double trajectory_start_time, const moveit_msgs::Constraints& path_constraints,
-			const planning_scene::PlanningSceneConstPtr& planning_scene);
+			const planning_scene::PlanningSceneConstPtr& planning_scene, WorkerPool* worker_pool);
 	bool updateBestTrajectory(double cost);
 
 	bool is_feasible;
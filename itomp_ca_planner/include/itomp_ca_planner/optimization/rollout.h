@@ -46,11 +46,14 @@ namespace itomp_ca_planner
 class Rollout
 {
 public:
+	Rollout();
+
 	std::vector<Eigen::VectorXd> parameters_; /**< [num_dimensions] num_parameters */
 	std::vector<Eigen::VectorXd> noise_; /**< [num_dimensions] num_parameters */
 	std::vector<Eigen::VectorXd> noise_projected_; /**< [num_dimensions][num_time_steps] num_parameters */
 	std::vector<Eigen::VectorXd> parameters_noise_projected_; /**< [num_dimensions][num_time_steps] num_parameters */
 	Eigen::VectorXd state_costs_; /**< num_time_steps */
+	bool state_costs_valid_; /**< state_costs_ are the evaluated costs of the current parameters_ */
 	std::vector<Eigen::VectorXd> control_costs_; /**< [num_dimensions] num_time_steps */
 	std::vector<Eigen::VectorXd> total_costs_; /**< [num_dimensions] num_time_steps */
 	std::vector<Eigen::VectorXd> cumulative_costs_; /**< [num_dimensions] num_time_steps */
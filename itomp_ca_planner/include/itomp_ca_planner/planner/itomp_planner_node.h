@@ -44,6 +44,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/trajectory/itomp_cio_trajectory.h>
 #include <itomp_ca_planner/optimization/itomp_optimizer.h>
 #include <itomp_ca_planner/optimization/best_cost_manager.h>
+#include <itomp_ca_planner/util/worker_pool.h>
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_scene/planning_scene.h>
 
@@ -112,6 +113,9 @@ private:
 
 	BestCostManager best_cost_manager_;
 
+	// runs the optimizers and their rollout tasks, created in init()
+	boost::scoped_ptr<WorkerPool> worker_pool_;
+
 	void jointConstraintsToJointState(
 			const std::vector<moveit_msgs::Constraints> &constraints,
 			std::vector<sensor_msgs::JointState>& joint_states)
@@ -0,0 +1,264 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <itomp_ca_planner/common.h>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
+namespace itomp_ca_planner
+{
+
+// A single aligned block of memory holding many arrays.
+// Arrays are laid out first (reserve), then the block is allocated once.
+// Copying an arena copies the whole block at once; views into the block
+// (ArenaArray, ArenaArray2D) store offsets and have to be bound again.
+class Arena
+{
+public:
+	static const size_t ALIGNMENT = 64;
+
+	Arena();
+	Arena(const Arena& arena);
+	~Arena();
+	Arena& operator=(const Arena& arena);
+
+	// starts a new layout
+	void clear();
+	// returns the byte offset of an array of count elements of type T
+	template<typename T>
+	size_t reserve(size_t count);
+	// allocates (zero-filled) memory for everything reserved so far
+	void allocate();
+	// exchanges the memory blocks of two arenas with the same layout
+	void swap(Arena& arena);
+
+	char* getData();
+	const char* getData() const;
+	size_t getSize() const;
+
+private:
+	void resizeBuffer(size_t capacity);
+
+	char* buffer_;
+	size_t size_;
+	size_t capacity_;
+};
+
+// Non-owning 1D view into an arena. Constness is deep: a const view gives
+// const elements.
+template<typename T>
+class ArenaArray
+{
+public:
+	ArenaArray() :
+			data_(NULL), size_(0), offset_(0)
+	{
+	}
+
+	void layout(Arena& arena, int size)
+	{
+		size_ = size;
+		offset_ = arena.reserve<T>(size);
+	}
+	void bind(Arena& arena)
+	{
+		data_ = reinterpret_cast<T*>(arena.getData() + offset_);
+	}
+	void bind(T* data, int size)
+	{
+		data_ = data;
+		size_ = size;
+	}
+
+	void fill(const T& value)
+	{
+		std::fill(data_, data_ + size_, value);
+	}
+
+	T& operator[](int i)
+	{
+		return data_[i];
+	}
+	const T& operator[](int i) const
+	{
+		return data_[i];
+	}
+	int size() const
+	{
+		return size_;
+	}
+	T* data()
+	{
+		return data_;
+	}
+	const T* data() const
+	{
+		return data_;
+	}
+	size_t getOffset() const
+	{
+		return offset_;
+	}
+
+	// copies elements [begin, end) between two arenas with the same layout
+	void copyRange(Arena& dst, const Arena& src, int begin, int end) const
+	{
+		if (begin < end)
+			memcpy(dst.getData() + offset_ + begin * sizeof(T),
+					src.getData() + offset_ + begin * sizeof(T),
+					(end - begin) * sizeof(T));
+	}
+
+private:
+	T* data_;
+	int size_;
+	size_t offset_;
+};
+
+// Non-owning row-major 2D view into an arena. Rows are contiguous, and
+// operator[] returns a view of one row so the element access syntax is
+// the same as for a vector of vectors.
+template<typename T>
+class ArenaArray2D
+{
+public:
+	ArenaArray2D() :
+			num_rows_(0), num_cols_(0)
+	{
+	}
+
+	void layout(Arena& arena, int num_rows, int num_cols)
+	{
+		num_rows_ = num_rows;
+		num_cols_ = num_cols;
+		data_.layout(arena, num_rows * num_cols);
+	}
+	void bind(Arena& arena)
+	{
+		data_.bind(arena);
+		rows_.resize(num_rows_);
+		for (int i = 0; i < num_rows_; ++i)
+			rows_[i].bind(data_.data() + i * num_cols_, num_cols_);
+	}
+
+	void fill(const T& value)
+	{
+		data_.fill(value);
+	}
+
+	ArenaArray<T>& operator[](int i)
+	{
+		return rows_[i];
+	}
+	const ArenaArray<T>& operator[](int i) const
+	{
+		return rows_[i];
+	}
+	int size() const
+	{
+		return num_rows_;
+	}
+	int getNumCols() const
+	{
+		return num_cols_;
+	}
+	T* data()
+	{
+		return data_.data();
+	}
+	const T* data() const
+	{
+		return data_.data();
+	}
+	size_t getOffset() const
+	{
+		return data_.getOffset();
+	}
+
+	// copies rows [begin, end) between two arenas with the same layout
+	void copyRows(Arena& dst, const Arena& src, int begin, int end) const
+	{
+		data_.copyRange(dst, src, begin * num_cols_, end * num_cols_);
+	}
+	// copies columns [begin, end) of every row
+	void copyCols(Arena& dst, const Arena& src, int begin, int end) const
+	{
+		for (int i = 0; i < num_rows_; ++i)
+			data_.copyRange(dst, src, i * num_cols_ + begin,
+					i * num_cols_ + end);
+	}
+
+private:
+	int num_rows_;
+	int num_cols_;
+	ArenaArray<T> data_;
+	std::vector<ArenaArray<T> > rows_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+template<typename T>
+size_t Arena::reserve(size_t count)
+{
+	size_t offset = size_;
+	size_t bytes = count * sizeof(T);
+	size_ += (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	return offset;
+}
+
+inline char* Arena::getData()
+{
+	return buffer_;
+}
+
+inline const char* Arena::getData() const
+{
+	return buffer_;
+}
+
+inline size_t Arena::getSize() const
+{
+	return size_;
+}
+
+}
+
+#endif /* ARENA_H_ */
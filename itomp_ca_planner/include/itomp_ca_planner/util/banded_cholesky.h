@@ -0,0 +1,90 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef BANDED_CHOLESKY_H_
+#define BANDED_CHOLESKY_H_
+
+#include <itomp_ca_planner/common.h>
+
+namespace itomp_ca_planner
+{
+
+// Cholesky factorization A = LL^T of a symmetric positive definite band
+// matrix. Both A and L are kept in lower band storage: a (bandwidth + 1) x n
+// matrix whose column j holds the entries (j, j), (j + 1, j), ...,
+// (j + bandwidth, j), so factorization is O(n b^2) and every solve is O(n b).
+class BandedCholesky
+{
+public:
+	BandedCholesky();
+	virtual ~BandedCholesky();
+
+	// returns false if the matrix is not positive definite
+	bool compute(const Eigen::MatrixXd& band);
+
+	int getSize() const;
+	int getBandwidth() const;
+
+	// x <- A^-1 x
+	void solveInPlace(Eigen::VectorXd& x) const;
+	// x <- L^-1 x
+	void solveLowerInPlace(Eigen::VectorXd& x) const;
+	// x <- L^-T x
+	void solveUpperInPlace(Eigen::VectorXd& x) const;
+	// x <- L^T x
+	void multiplyUpperInPlace(Eigen::VectorXd& x) const;
+
+private:
+	int size_;
+	int bandwidth_;
+	Eigen::MatrixXd factor_;
+};
+
+inline int BandedCholesky::getSize() const
+{
+	return size_;
+}
+
+inline int BandedCholesky::getBandwidth() const
+{
+	return bandwidth_;
+}
+
+}
+
+#endif /* BANDED_CHOLESKY_H_ */
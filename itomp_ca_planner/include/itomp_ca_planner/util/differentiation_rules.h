@@ -38,6 +38,9 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #ifndef DIFFERENTIATION_RULES_H_
 #define DIFFERENTIATION_RULES_H_
 
+#include <Eigen/Core>
+#include <algorithm>
+
 namespace itomp_ca_planner
 {
 
@@ -67,5 +70,120 @@ static const double DIFF_RULES[NUM_DIFF_RULES][DIFF_RULE_LENGTH] =
 
 };
 
+// number of points on either side of the center the rules above actually read
+inline int getDiffRuleRadius()
+{
+  int radius = 0;
+  for (int i = 0; i < NUM_DIFF_RULES; ++i)
+  {
+    for (int j = 0; j < DIFF_RULE_LENGTH; ++j)
+    {
+      if (DIFF_RULES[i][j] != 0.0)
+        radius = std::max(radius, std::max(j - DIFF_RULE_LENGTH / 2, DIFF_RULE_LENGTH / 2 - j));
+    }
+  }
+  return radius;
+}
+
+// Stencil kernels for the rules above. A rule is applied at every point
+// where the whole stencil fits in the trajectory; the rows of the outer
+// DIFF_RULE_LENGTH / 2 points are left zero. This is the product with the
+// banded differentiation matrix, without building it.
+
+// output = D * input, column by column. The rows of input are the points of
+// the trajectory and its columns are independent trajectories (joints or
+// rollouts), so each tap is one vectorized block operation.
+template<typename Derived1, typename Derived2>
+inline void applyDiffRule(const double* diff_rule, const Eigen::MatrixBase<Derived1>& input,
+    Eigen::MatrixBase<Derived2>& output)
+{
+  const int half_length = DIFF_RULE_LENGTH / 2;
+  const int num_rows = input.rows() - 2 * half_length;
+
+  output.setZero();
+  if (num_rows <= 0)
+    return;
+  for (int j = 0; j < DIFF_RULE_LENGTH; ++j)
+  {
+    if (diff_rule[j] == 0.0)
+      continue;
+    output.middleRows(half_length, num_rows) += diff_rule[j] * input.middleRows(j, num_rows);
+  }
+}
+
+// output = D^T * input, the adjoint of applyDiffRule
+template<typename Derived1, typename Derived2>
+inline void applyDiffRuleTranspose(const double* diff_rule, const Eigen::MatrixBase<Derived1>& input,
+    Eigen::MatrixBase<Derived2>& output)
+{
+  const int half_length = DIFF_RULE_LENGTH / 2;
+  const int num_rows = input.rows() - 2 * half_length;
+
+  output.setZero();
+  if (num_rows <= 0)
+    return;
+  for (int j = 0; j < DIFF_RULE_LENGTH; ++j)
+  {
+    if (diff_rule[j] == 0.0)
+      continue;
+    output.middleRows(j, num_rows) += diff_rule[j] * input.middleRows(half_length, num_rows);
+  }
+}
+
+// ||D * input||^2 of a single trajectory
+template<typename Derived>
+inline double computeDiffRuleSquaredNorm(const double* diff_rule, const Eigen::MatrixBase<Derived>& input)
+{
+  const int half_length = DIFF_RULE_LENGTH / 2;
+  const int size = input.size();
+
+  int tap_begin = 0;
+  int tap_end = DIFF_RULE_LENGTH - 1;
+  while (tap_begin <= tap_end && diff_rule[tap_begin] == 0.0)
+    ++tap_begin;
+  while (tap_end >= tap_begin && diff_rule[tap_end] == 0.0)
+    --tap_end;
+  if (tap_begin > tap_end)
+    return 0.0;
+
+  double sum = 0.0;
+  for (int i = half_length; i < size - half_length; ++i)
+  {
+    double value = 0.0;
+    for (int j = tap_begin; j <= tap_end; ++j)
+      value += diff_rule[j] * input(i - half_length + j);
+    sum += value * value;
+  }
+  return sum;
+}
+
+// Adds weight * (D^T * D) of a trajectory of the given size to the lower band
+// storage of its block of band.cols() variables starting at begin
+// (band(k, j) is the entry (begin + j + k, begin + j)).
+template<typename Derived>
+inline void addDiffRuleGramBand(const double* diff_rule, double weight, int size, int begin,
+    Eigen::MatrixBase<Derived>& band)
+{
+  const int half_length = DIFF_RULE_LENGTH / 2;
+  const int bandwidth = std::min<int>(band.rows() - 1, DIFF_RULE_LENGTH - 1);
+  const int num_vars = band.cols();
+
+  for (int j = 0; j < num_vars; ++j)
+  {
+    int col = begin + j;
+    for (int k = 0; k <= bandwidth && j + k < num_vars; ++k)
+    {
+      int row = col + k;
+      // the rows of D which have both row and col in their stencil
+      int m_begin = std::max(half_length, row - half_length);
+      int m_end = std::min(size - 1 - half_length, col + half_length);
+      double value = 0.0;
+      for (int m = m_begin; m <= m_end; ++m)
+        value += diff_rule[row - m + half_length] * diff_rule[col - m + half_length];
+      band(k, j) += weight * value;
+    }
+  }
+}
+
 }
 #endif
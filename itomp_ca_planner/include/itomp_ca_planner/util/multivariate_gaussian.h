@@ -38,6 +38,7 @@
 #define MULTIVARIATE_GAUSSIAN_H_
 
 #include <itomp_ca_planner/common.h>
+#include <itomp_ca_planner/util/banded_cholesky.h>
 #include <Eigen/Cholesky>
 #include <boost/random/variate_generator.hpp>
 #include <boost/random/normal_distribution.hpp>
@@ -66,6 +67,33 @@ private:
 	boost::shared_ptr<boost::variate_generator<boost::mt19937, boost::normal_distribution<> > > gaussian_;
 };
 
+/**
+ * \brief Generates samples from a multivariate gaussian distribution whose
+ * inverse covariance is a band matrix, given as its Cholesky factor LL^T.
+ * Samples are L^-T z, so each sample costs a banded triangular solve.
+ */
+class BandedMultivariateGaussian
+{
+public:
+	BandedMultivariateGaussian(const Eigen::VectorXd& mean, const itomp_ca_planner::BandedCholesky& precision_cholesky);
+
+	template<typename Derived>
+	void sample(Eigen::MatrixBase<Derived>& output);
+	// samples L^-T (scales .* z), the covariance L^-T diag(scales^2) L^-1
+	template<typename Derived>
+	void sample(Eigen::MatrixBase<Derived>& output, const Eigen::VectorXd& scales);
+
+private:
+	Eigen::VectorXd mean_; /**< Mean of the gaussian distribution */
+	itomp_ca_planner::BandedCholesky precision_cholesky_; /**< Cholesky decomposition (LL^T) of the inverse covariance */
+	Eigen::VectorXd tmp_sample_;
+
+	int size_;
+	boost::mt19937 rng_;
+	boost::normal_distribution<> normal_dist_;
+	boost::shared_ptr<boost::variate_generator<boost::mt19937, boost::normal_distribution<> > > gaussian_;
+};
+
 //////////////////////// template function definitions follow //////////////////////////////
 
 template<typename Derived1, typename Derived2>
@@ -93,4 +121,35 @@ void MultivariateGaussian::sample(Eigen::MatrixBase<Derived>& output)
 	output = mean_ + covariance_cholesky_ * output;
 }
 
+inline BandedMultivariateGaussian::BandedMultivariateGaussian(const Eigen::VectorXd& mean,
+		const itomp_ca_planner::BandedCholesky& precision_cholesky) :
+	mean_(mean), precision_cholesky_(precision_cholesky), tmp_sample_(mean.rows()), normal_dist_(0.0, 1.0)
+{
+	rng_.seed(rand());
+	size_ = mean.rows();
+	gaussian_.reset(new boost::variate_generator<boost::mt19937, boost::normal_distribution<> >(rng_, normal_dist_));
+}
+
+template<typename Derived>
+void BandedMultivariateGaussian::sample(Eigen::MatrixBase<Derived>& output)
+{
+	for (int i = 0; i < size_; ++i)
+	{
+		tmp_sample_(i) = (*gaussian_)();
+	}
+	precision_cholesky_.solveUpperInPlace(tmp_sample_);
+	output = mean_ + tmp_sample_;
+}
+
+template<typename Derived>
+void BandedMultivariateGaussian::sample(Eigen::MatrixBase<Derived>& output, const Eigen::VectorXd& scales)
+{
+	for (int i = 0; i < size_; ++i)
+	{
+		tmp_sample_(i) = scales(i) * (*gaussian_)();
+	}
+	precision_cholesky_.solveUpperInPlace(tmp_sample_);
+	output = mean_ + tmp_sample_;
+}
+
 #endif /* MULTIVARIATE_GAUSSIAN_H_ */
@@ -73,6 +73,7 @@ public:
 	double getFTRCostWeight() const;
 	double getCartesianTrajectoryCostWeight() const;
 	double getSingularityCostWeight() const;
+	double getSingularityThreshold() const;
 
 	bool getAnimatePath() const;
 	double getSmoothnessCostVelocity() const;
@@ -84,12 +85,33 @@ public:
 	const std::multimap<std::string, std::string>& getAnimateEndeffectorSegment() const;
 	int getNumTrajectories() const;
 	int getNumTrials() const;
+	const std::string& getImprovementManager() const;
+	double getGradientStepSize() const;
 	int getNumRollouts() const;
 	int getNumReusedRollouts() const;
+	int getNumThreads() const;
+	int getNumTrajectoryThreads() const;
+	int getNumRolloutThreads() const;
+	int getNumWaypointThreads() const;
 	double getNoiseStddev() const;
 	double getNoiseDecay() const;
 	bool getUseCumulativeCosts() const;
 	bool getUseSmoothNoises() const;
+	bool getUseIncrementalEvaluation() const;
+	bool getUsePartialFK() const;
+	bool getUseBatchFK() const;
+	const std::string& getCollisionBackend() const;
+	bool getUseCollisionPrefilter() const;
+	bool getUseCollisionCostQuery() const;
+	bool getUseCollisionCache() const;
+	double getCollisionCacheMaxClearance() const;
+	double getSDFResolution() const;
+	double getSDFPadding() const;
+	double getCollisionClearance() const;
+	const std::string& getContactForceSolver() const;
+	int getContactForceSolverIterations() const;
+	bool getUseGroundHeightmap() const;
+	double getGroundHeightmapResolution() const;
 	int getNumContacts() const;
 	const std::vector<double>& getContactVariableInitialValues() const;
 	const std::vector<double>& getContactVariableGoalValues() const;
@@ -158,6 +180,7 @@ private:
 	double ftr_cost_weight_;
 	double cartesian_trajectory_cost_weight_;
 	double singularity_cost_weight_;
+	double singularity_threshold_;
 	bool animate_path_;
 	double smoothness_cost_velocity_;
 	double smoothness_cost_acceleration_;
@@ -183,12 +206,33 @@ private:
 
 	int num_trials_;
 
+	std::string improvement_manager_;
+	double gradient_step_size_;
 	int num_rollouts_;
 	int num_reused_rollouts_;
+	int num_threads_;
+	int num_trajectory_threads_;
+	int num_rollout_threads_;
+	int num_waypoint_threads_;
 	double noise_stddev_;
 	double noise_decay_;
 	bool use_cumulative_costs_;
 	bool use_smooth_noises_;
+	bool use_incremental_evaluation_;
+	bool use_partial_fk_;
+	bool use_batch_fk_;
+	std::string collision_backend_;
+	bool use_collision_prefilter_;
+	bool use_collision_cost_query_;
+	bool use_collision_cache_;
+	double collision_cache_max_clearance_;
+	double sdf_resolution_;
+	double sdf_padding_;
+	double collision_clearance_;
+	std::string contact_force_solver_;
+	int contact_force_solver_iterations_;
+	bool use_ground_heightmap_;
+	double ground_heightmap_resolution_;
 
 	std::vector<double> temporary_variables_;
 
@@ -301,6 +345,11 @@ inline double PlanningParameters::getSingularityCostWeight() const
 	return singularity_cost_weight_;
 }
 
+inline double PlanningParameters::getSingularityThreshold() const
+{
+	return singularity_threshold_;
+}
+
 inline bool PlanningParameters::getAnimatePath() const
 {
 	return animate_path_;
@@ -385,6 +434,14 @@ inline const std::vector<double>& PlanningParameters::getContactVariableGoalValu
 	return contact_variable_goal_values_;
 }
 
+inline const std::string& PlanningParameters::getImprovementManager() const
+{
+	return improvement_manager_;
+}
+inline double PlanningParameters::getGradientStepSize() const
+{
+	return gradient_step_size_;
+}
 inline int PlanningParameters::getNumRollouts() const
 {
 	return num_rollouts_;
@@ -393,6 +450,22 @@ inline int PlanningParameters::getNumReusedRollouts() const
 {
 	return num_reused_rollouts_;
 }
+inline int PlanningParameters::getNumThreads() const
+{
+	return num_threads_;
+}
+inline int PlanningParameters::getNumTrajectoryThreads() const
+{
+	return num_trajectory_threads_;
+}
+inline int PlanningParameters::getNumRolloutThreads() const
+{
+	return num_rollout_threads_;
+}
+inline int PlanningParameters::getNumWaypointThreads() const
+{
+	return num_waypoint_threads_;
+}
 inline double PlanningParameters::getNoiseStddev() const
 {
 	return noise_stddev_;
@@ -409,6 +482,80 @@ inline bool PlanningParameters::getUseSmoothNoises() const
 {
 	return use_smooth_noises_;
 }
+inline bool PlanningParameters::getUseIncrementalEvaluation() const
+{
+	return use_incremental_evaluation_;
+}
+
+inline bool PlanningParameters::getUsePartialFK() const
+{
+	return use_partial_fk_;
+}
+
+inline bool PlanningParameters::getUseBatchFK() const
+{
+	return use_batch_fk_;
+}
+
+inline const std::string& PlanningParameters::getCollisionBackend() const
+{
+	return collision_backend_;
+}
+
+inline bool PlanningParameters::getUseCollisionPrefilter() const
+{
+	return use_collision_prefilter_;
+}
+
+inline bool PlanningParameters::getUseCollisionCostQuery() const
+{
+	return use_collision_cost_query_;
+}
+
+inline bool PlanningParameters::getUseCollisionCache() const
+{
+	return use_collision_cache_;
+}
+
+inline double PlanningParameters::getCollisionCacheMaxClearance() const
+{
+	return collision_cache_max_clearance_;
+}
+
+inline double PlanningParameters::getSDFResolution() const
+{
+	return sdf_resolution_;
+}
+
+inline double PlanningParameters::getSDFPadding() const
+{
+	return sdf_padding_;
+}
+
+inline double PlanningParameters::getCollisionClearance() const
+{
+	return collision_clearance_;
+}
+
+inline const std::string& PlanningParameters::getContactForceSolver() const
+{
+	return contact_force_solver_;
+}
+
+inline int PlanningParameters::getContactForceSolverIterations() const
+{
+	return contact_force_solver_iterations_;
+}
+
+inline bool PlanningParameters::getUseGroundHeightmap() const
+{
+	return use_ground_heightmap_;
+}
+
+inline double PlanningParameters::getGroundHeightmapResolution() const
+{
+	return ground_heightmap_resolution_;
+}
 
 inline std::string PlanningParameters::getEnvironmentModel() const
 {
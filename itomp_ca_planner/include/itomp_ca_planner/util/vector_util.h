@@ -67,9 +67,10 @@ void kdlVecVecToEigenVecVec(std::vector<std::vector<KDLType> >& kdl_vv,
 	}
 }
 
-template<typename VecType>
-void getVectorVelocities(int start, int end, double discretization, const std::vector<VecType>& pos, std::vector<
-		VecType>& vel, const VecType& zeroVec)
+// the containers can be std::vector or ArenaArray
+template<typename PosContainer, typename VelContainer, typename VecType>
+void getVectorVelocities(int start, int end, double discretization, const PosContainer& pos, VelContainer& vel,
+		const VecType& zeroVec)
 {
 	const double invTime = 1.0 / discretization;
 
@@ -84,9 +85,9 @@ void getVectorVelocities(int start, int end, double discretization, const std::v
 	}
 }
 
-template<typename VecType>
-void getVectorVelocitiesAndAccelerations(int start, int end, double discretization, const std::vector<VecType>& pos,
-		std::vector<VecType>& vel, std::vector<VecType>& acc, const VecType& zeroVec)
+template<typename PosContainer, typename VelContainer, typename VecType>
+void getVectorVelocitiesAndAccelerations(int start, int end, double discretization, const PosContainer& pos,
+		VelContainer& vel, VelContainer& acc, const VecType& zeroVec)
 {
 	const double invTime = 1.0 / discretization;
 
@@ -0,0 +1,128 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <itomp_ca_planner/common.h>
+#include <boost/function.hpp>
+#include <boost/thread/tss.hpp>
+#include <deque>
+
+namespace itomp_ca_planner
+{
+class WorkerPool;
+
+// Counts the unfinished tasks submitted with it.
+class TaskGroup
+{
+public:
+	TaskGroup();
+	virtual ~TaskGroup();
+
+	// Blocks until every task of the group has finished.
+	// The calling thread executes queued tasks of the group while it waits.
+	void wait(WorkerPool* pool);
+
+private:
+	void add();
+	void done();
+
+	boost::mutex mutex_;
+	boost::condition_variable condition_;
+	int num_pending_tasks_;
+
+	friend class WorkerPool;
+};
+
+// Long-lived threads with one task deque each. A worker pops tasks from the
+// back of its own deque and steals from the front of the others when idle.
+class WorkerPool
+{
+public:
+	WorkerPool(int num_threads);
+	virtual ~WorkerPool();
+
+	// Tasks submitted from a worker go to the deque of that worker,
+	// others are distributed round-robin.
+	void submit(const boost::function<void()>& task, TaskGroup* group = NULL);
+
+	// Runs one queued task (of the given group if it is not NULL).
+	// Returns false if there was none.
+	bool runPendingTask(TaskGroup* group = NULL);
+
+	int getNumThreads() const;
+
+private:
+	struct Task
+	{
+		boost::function<void()> function_;
+		TaskGroup* group_;
+	};
+	struct TaskQueue
+	{
+		boost::mutex mutex_;
+		std::deque<Task> tasks_;
+	};
+
+	void workerFunction(int index);
+	bool popTask(TaskGroup* group, Task& task);
+	void runTask(Task& task);
+	int getWorkerIndex() const;
+
+	int num_threads_;
+	std::vector<boost::shared_ptr<TaskQueue> > queues_;
+	boost::thread_group threads_;
+	boost::thread_specific_ptr<int> worker_index_;
+
+	boost::mutex mutex_;
+	boost::condition_variable condition_;
+	int num_queued_tasks_;
+	int next_queue_;
+	bool terminated_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+inline int WorkerPool::getNumThreads() const
+{
+	return num_threads_;
+}
+
+}
+
+#endif /* WORKER_POOL_H_ */
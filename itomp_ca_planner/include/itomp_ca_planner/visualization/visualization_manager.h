@@ -44,6 +44,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <kdl/frames.hpp>
 #include <itomp_ca_planner/trajectory/itomp_cio_trajectory.h>
 #include <itomp_ca_planner/util/singleton.h>
+#include <itomp_ca_planner/util/arena.h>
 
 namespace itomp_ca_planner
 {
@@ -63,13 +64,13 @@ public:
 
 	void animateEndeffector(int trajectory_index, int point_start,
 			int point_end,
-			const std::vector<std::vector<KDL::Frame> >& segmentFrames,
+			const ArenaArray2D<KDL::Frame>& segmentFrames,
 			bool best);
 
 	void animateCoM(int numFreeVars, int freeVarStartIndex,
-			const std::vector<KDL::Vector>& CoM, bool best);
+			const ArenaArray<KDL::Vector>& CoM, bool best);
 	void animateRoot(int numFreeVars, int freeVarStartIndex,
-			const std::vector<std::vector<KDL::Frame> >& segmentFrames,
+			const ArenaArray2D<KDL::Frame>& segmentFrames,
 			bool best);
 	void animatePath(int trajectory_index, const ItompCIOTrajectory* traj,
 			bool is_best, const std::string& group_name);
@@ -0,0 +1,118 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/collision/collision_cache.h>
+#include <cmath>
+
+namespace itomp_ca_planner
+{
+
+CollisionCache::CollisionCache() :
+		num_links_(0), counters_(new Counters())
+{
+	counters_->num_queries_ = 0;
+	counters_->num_hits_ = 0;
+}
+
+CollisionCache::~CollisionCache()
+{
+}
+
+void CollisionCache::init(int num_points, const std::vector<CollisionLink>& links)
+{
+	links_ = links;
+	num_links_ = links.size();
+	frames_.resize(num_points * num_links_);
+	clearances_.resize(num_points);
+	clear();
+}
+
+void CollisionCache::clear()
+{
+	std::fill(clearances_.begin(), clearances_.end(), 0.0);
+	counters_->num_queries_ = 0;
+	counters_->num_hits_ = 0;
+}
+
+bool CollisionCache::isCollisionFree(int point, const ArenaArray<KDL::Frame>& segment_frames) const
+{
+#pragma omp atomic
+	++counters_->num_queries_;
+
+	double clearance = clearances_[point];
+	if (clearance <= 0.0)
+		return false;
+
+	double max_motion = 0.5 * clearance;
+	const KDL::Frame* frames = &frames_[point * num_links_];
+	for (int i = 0; i < num_links_; ++i)
+	{
+		const CollisionLink& link = links_[i];
+		const KDL::Frame& frame = segment_frames[link.segment_index_];
+		const KDL::Frame& cached_frame = frames[i];
+
+		double translation = (frame * link.center_ - cached_frame * link.center_).Norm();
+		if (translation >= max_motion)
+			return false;
+
+		// rotation angle of cached_frame.M^T * frame.M from its trace
+		double trace = 0.0;
+		for (int r = 0; r < 3; ++r)
+			for (int c = 0; c < 3; ++c)
+				trace += frame.M(r, c) * cached_frame.M(r, c);
+		double cos_angle = std::max(-1.0, std::min(1.0, 0.5 * (trace - 1.0)));
+		double angle = std::acos(cos_angle);
+		// unbounded links (infinite radius) only pass if they did not rotate
+		if (angle > 0.0 && translation + link.radius_ * angle >= max_motion)
+			return false;
+	}
+
+#pragma omp atomic
+	++counters_->num_hits_;
+	return true;
+}
+
+void CollisionCache::setCollisionFree(int point, const ArenaArray<KDL::Frame>& segment_frames, double clearance)
+{
+	KDL::Frame* frames = &frames_[point * num_links_];
+	for (int i = 0; i < num_links_; ++i)
+		frames[i] = segment_frames[links_[i].segment_index_];
+	clearances_[point] = clearance;
+}
+
+}
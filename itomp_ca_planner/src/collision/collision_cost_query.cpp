@@ -0,0 +1,271 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/collision/collision_cost_query.h>
+#include <itomp_ca_planner/model/itomp_robot_model.h>
+#include <itomp_ca_planner/model/itomp_planning_group.h>
+#include <fcl/collision.h>
+#include <fcl/distance.h>
+#include <ros/ros.h>
+
+namespace itomp_ca_planner
+{
+
+static fcl::Transform3f toTransform3f(const KDL::Frame& frame)
+{
+	const KDL::Rotation& m = frame.M;
+	return fcl::Transform3f(fcl::Matrix3f(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2), m(2, 0), m(2, 1), m(2, 2)),
+			fcl::Vec3f(frame.p.x(), frame.p.y(), frame.p.z()));
+}
+
+static KDL::Frame toFrame(const Eigen::Affine3d& transform)
+{
+	const Eigen::Matrix3d& m = transform.linear();
+	const Eigen::Vector3d& p = transform.translation();
+	return KDL::Frame(
+			KDL::Rotation(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2), m(2, 0), m(2, 1), m(2, 2)),
+			KDL::Vector(p(0), p(1), p(2)));
+}
+
+CollisionCostQuery::CollisionCostQuery() :
+		num_moving_pairs_(0), request_(1, true)
+{
+}
+
+CollisionCostQuery::~CollisionCostQuery()
+{
+}
+
+void CollisionCostQuery::init(const ItompRobotModel* robot_model, const ItompPlanningGroup* planning_group,
+		const planning_scene::PlanningSceneConstPtr& planning_scene, bool self_collision_only)
+{
+	robot_shapes_.clear();
+	world_geometries_.clear();
+	world_objects_.clear();
+	pairs_.clear();
+	num_moving_pairs_ = 0;
+
+	const collision_detection::AllowedCollisionMatrix& acm = planning_scene->getAllowedCollisionMatrix();
+
+	std::vector<std::string> robot_shape_links;
+	std::vector<int> robot_shape_bodies;
+	const KDL::SegmentMap& segment_map = robot_model->getKDLTree()->getSegments();
+	const std::vector<const robot_model::LinkModel*>& link_models =
+			robot_model->getRobotModel()->getLinkModelsWithCollisionGeometry();
+	for (int i = 0; i < link_models.size(); ++i)
+	{
+		const robot_model::LinkModel* link_model = link_models[i];
+		if (segment_map.find(link_model->getName()) == segment_map.end())
+			continue;
+		int segment_index = robot_model->getForwardKinematicsSolver()->segmentNameToIndex(link_model->getName());
+		int rigid_body = (planning_group != NULL) ? planning_group->getRigidBodyIndex(segment_index) : segment_index;
+
+		const std::vector<shapes::ShapeConstPtr>& shapes = link_model->getShapes();
+		for (int j = 0; j < shapes.size(); ++j)
+		{
+			RobotShape robot_shape;
+			robot_shape.geometry_ = collision_detection::createCollisionGeometry(shapes[j], link_model, j);
+			if (!robot_shape.geometry_)
+				continue;
+			robot_shape.segment_index_ = segment_index;
+			robot_shape.origin_ = toFrame(link_model->getCollisionOriginTransforms()[j]);
+			robot_shapes_.push_back(robot_shape);
+			robot_shape_links.push_back(link_model->getName());
+			robot_shape_bodies.push_back(rigid_body);
+		}
+	}
+
+	std::vector<std::string> world_shape_objects;
+	const collision_detection::World& world = *planning_scene->getWorld();
+	for (collision_detection::World::const_iterator it = world.begin(); it != world.end() && !self_collision_only;
+			++it)
+	{
+		const collision_detection::World::Object& object = *it->second;
+		for (int i = 0; i < object.shapes_.size(); ++i)
+		{
+			collision_detection::FCLGeometryConstPtr geometry = collision_detection::createCollisionGeometry(
+					object.shapes_[i], &object);
+			if (!geometry)
+				continue;
+			world_geometries_.push_back(geometry);
+			world_objects_.push_back(
+					fcl::CollisionObject(geometry->collision_geometry_, toTransform3f(toFrame(object.shape_poses_[i]))));
+			world_objects_.back().computeAABB();
+			world_shape_objects.push_back(object.id_);
+		}
+	}
+
+	// a pair is static if both sides belong to the same rigid body, where the world is body -1
+	std::vector<ShapePair> static_pairs;
+	bool allowed;
+	for (int i = 0; i < robot_shapes_.size(); ++i)
+	{
+		ShapePair pair;
+		pair.robot_shape_ = i;
+		pair.is_self_collision_ = false;
+		for (int j = 0; j < world_objects_.size(); ++j)
+		{
+			if (acm.getAllowedCollision(robot_shape_links[i], world_shape_objects[j], allowed) && allowed)
+				continue;
+			pair.other_shape_ = j;
+			if (robot_shape_bodies[i] == -1)
+				static_pairs.push_back(pair);
+			else
+				pairs_.push_back(pair);
+		}
+
+		pair.is_self_collision_ = true;
+		for (int j = i + 1; j < robot_shapes_.size(); ++j)
+		{
+			if (robot_shape_links[i] == robot_shape_links[j])
+				continue;
+			if (acm.getAllowedCollision(robot_shape_links[i], robot_shape_links[j], allowed) && allowed)
+				continue;
+			pair.other_shape_ = j;
+			if (robot_shape_bodies[i] == robot_shape_bodies[j])
+				static_pairs.push_back(pair);
+			else
+				pairs_.push_back(pair);
+		}
+	}
+	num_moving_pairs_ = pairs_.size();
+	pairs_.insert(pairs_.end(), static_pairs.begin(), static_pairs.end());
+
+	ROS_INFO("Collision cost query : %d robot shapes, %d world shapes, %d moving pairs, %d static pairs",
+			(int) robot_shapes_.size(), (int) world_objects_.size(), num_moving_pairs_, (int) static_pairs.size());
+}
+
+void CollisionCostQuery::initWorkspace(CollisionCostWorkspace& workspace) const
+{
+	workspace.robot_objects_.clear();
+	workspace.robot_objects_.reserve(robot_shapes_.size());
+	for (int i = 0; i < robot_shapes_.size(); ++i)
+		workspace.robot_objects_.push_back(
+				fcl::CollisionObject(robot_shapes_[i].geometry_->collision_geometry_, fcl::Transform3f()));
+	workspace.pair_depths_.assign(getNumPairs(), 0.0);
+	workspace.num_colliding_pairs_ = 0;
+	workspace.result_.clear();
+}
+
+double CollisionCostQuery::computeDepthSum(const ArenaArray<KDL::Frame>& segment_frames,
+		CollisionCostWorkspace& workspace) const
+{
+	placeRobotShapes(segment_frames, workspace);
+	return computeDepthSum(0, num_moving_pairs_, workspace);
+}
+
+double CollisionCostQuery::computeStaticDepthSum(const ArenaArray<KDL::Frame>& segment_frames,
+		CollisionCostWorkspace& workspace) const
+{
+	placeRobotShapes(segment_frames, workspace);
+	return computeDepthSum(num_moving_pairs_, pairs_.size(), workspace);
+}
+
+void CollisionCostQuery::placeRobotShapes(const ArenaArray<KDL::Frame>& segment_frames,
+		CollisionCostWorkspace& workspace) const
+{
+	// the static shapes are placed too, a moving pair may have a static side
+	std::vector<fcl::CollisionObject>& robot_objects = workspace.robot_objects_;
+	for (int i = 0; i < robot_shapes_.size(); ++i)
+	{
+		const RobotShape& robot_shape = robot_shapes_[i];
+		robot_objects[i].setTransform(toTransform3f(segment_frames[robot_shape.segment_index_] * robot_shape.origin_));
+		robot_objects[i].computeAABB();
+	}
+}
+
+double CollisionCostQuery::computeDepthSum(int pair_begin, int pair_end, CollisionCostWorkspace& workspace) const
+{
+	// depth of the deepest contact of each pair, as in the planning scene contact maps
+	std::fill(workspace.pair_depths_.begin() + pair_begin, workspace.pair_depths_.begin() + pair_end, 0.0);
+	workspace.num_colliding_pairs_ = 0;
+	double depth_sum = 0.0;
+	for (int p = pair_begin; p < pair_end; ++p)
+	{
+		const fcl::CollisionObject* object1;
+		const fcl::CollisionObject* object2;
+		getPair(p, workspace, object1, object2);
+		if (!object1->getAABB().overlap(object2->getAABB()))
+			continue;
+
+		fcl::collide(object1, object2, request_, workspace.result_);
+		if (workspace.result_.numContacts() > 0)
+		{
+			double depth = workspace.result_.getContact(0).penetration_depth;
+			workspace.pair_depths_[p] = depth;
+			++workspace.num_colliding_pairs_;
+			depth_sum += depth;
+		}
+		workspace.result_.clear();
+	}
+
+	return depth_sum;
+}
+
+double CollisionCostQuery::computeMinDistance(CollisionCostWorkspace& workspace, double max_distance) const
+{
+	double min_distance = max_distance;
+	for (int p = 0; p < num_moving_pairs_ && min_distance > 0.0; ++p)
+	{
+		const fcl::CollisionObject* object1;
+		const fcl::CollisionObject* object2;
+		getPair(p, workspace, object1, object2);
+
+		// the box distance is a lower bound of the shape distance
+		if (object1->getAABB().distance(object2->getAABB()) >= min_distance)
+			continue;
+
+		fcl::distance(object1, object2, distance_request_, workspace.distance_result_);
+		min_distance = std::min(min_distance, workspace.distance_result_.min_distance);
+		workspace.distance_result_.clear();
+	}
+	return std::max(min_distance, 0.0);
+}
+
+void CollisionCostQuery::getPair(int pair, CollisionCostWorkspace& workspace, const fcl::CollisionObject*& object1,
+		const fcl::CollisionObject*& object2) const
+{
+	const ShapePair& shape_pair = pairs_[pair];
+	object1 = &workspace.robot_objects_[shape_pair.robot_shape_];
+	if (shape_pair.is_self_collision_)
+		object2 = &workspace.robot_objects_[shape_pair.other_shape_];
+	else
+		object2 = &world_objects_[shape_pair.other_shape_];
+}
+
+}
@@ -0,0 +1,311 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/collision/collision_prefilter.h>
+#include <itomp_ca_planner/model/itomp_planning_group.h>
+#include <geometric_shapes/bodies.h>
+#include <ros/ros.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace itomp_ca_planner
+{
+
+namespace
+{
+struct NodeCenterLess
+{
+	NodeCenterLess(int axis) :
+			axis_(axis)
+	{
+	}
+	template<typename T>
+	bool operator()(const T& a, const T& b) const
+	{
+		return a.box_.min_(axis_) + a.box_.max_(axis_) < b.box_.min_(axis_) + b.box_.max_(axis_);
+	}
+	int axis_;
+};
+}
+
+CollisionPrefilter::CollisionPrefilter() :
+		root_(-1), num_queries_(0), num_skipped_queries_(0)
+{
+}
+
+CollisionPrefilter::~CollisionPrefilter()
+{
+}
+
+void CollisionPrefilter::init(const LinkSphereModel& link_sphere_model, const ItompPlanningGroup* planning_group,
+		const planning_scene::PlanningSceneConstPtr& planning_scene)
+{
+	links_ = link_sphere_model.getLinks();
+
+	std::vector<int> link_bodies(links_.size());
+	is_link_moving_.resize(links_.size());
+	for (int i = 0; i < links_.size(); ++i)
+	{
+		int segment_index = links_[i].segment_index_;
+		link_bodies[i] = (planning_group != NULL) ? planning_group->getRigidBodyIndex(segment_index) : segment_index;
+		is_link_moving_[i] = (link_bodies[i] != -1);
+	}
+	nodes_.clear();
+	root_ = -1;
+	resetCounters();
+
+	const collision_detection::AllowedCollisionMatrix& acm = planning_scene->getAllowedCollisionMatrix();
+
+	// leaves : boxes around the bounding spheres of the world object shapes
+	std::vector<Node> leaves;
+	std::vector<std::string> object_ids;
+	const collision_detection::World& world = *planning_scene->getWorld();
+	for (collision_detection::World::const_iterator it = world.begin(); it != world.end(); ++it)
+	{
+		const collision_detection::World::Object& object = *it->second;
+		for (int i = 0; i < object.shapes_.size(); ++i)
+		{
+			Node leaf;
+			bodies::Body* body = bodies::createBodyFromShape(object.shapes_[i].get());
+			if (body != NULL)
+			{
+				body->setPose(object.shape_poses_[i]);
+				bodies::BoundingSphere sphere;
+				body->computeBoundingSphere(sphere);
+				delete body;
+
+				KDL::Vector center(sphere.center(0), sphere.center(1), sphere.center(2));
+				KDL::Vector extents(sphere.radius, sphere.radius, sphere.radius);
+				leaf.box_.min_ = center - extents;
+				leaf.box_.max_ = center + extents;
+			}
+			else
+			{
+				// octrees and planes have no body; a box covering the whole space always
+				// overlaps. The largest finite extents keep the box centers finite for the split.
+				double extent = std::numeric_limits<double>::max();
+				leaf.box_.min_ = KDL::Vector(-extent, -extent, -extent);
+				leaf.box_.max_ = KDL::Vector(extent, extent, extent);
+			}
+			leaf.left_ = leaf.right_ = -1;
+			leaf.object_ = object_ids.size();
+			leaves.push_back(leaf);
+		}
+		object_ids.push_back(object.id_);
+	}
+	if (!leaves.empty())
+	{
+		nodes_.reserve(2 * leaves.size());
+		root_ = buildNode(leaves, 0, leaves.size());
+	}
+
+	allowed_object_collisions_.assign(links_.size(), std::vector<char>(object_ids.size(), 0));
+	self_collision_pairs_.clear();
+	for (int i = 0; i < links_.size(); ++i)
+	{
+		bool allowed;
+		for (int j = 0; j < object_ids.size(); ++j)
+		{
+			if (acm.getAllowedCollision(links_[i].name_, object_ids[j], allowed) && allowed)
+				allowed_object_collisions_[i][j] = 1;
+		}
+		for (int j = i + 1; j < links_.size(); ++j)
+		{
+			if (link_bodies[i] == link_bodies[j])
+				continue;
+			if (acm.getAllowedCollision(links_[i].name_, links_[j].name_, allowed) && allowed)
+				continue;
+			self_collision_pairs_.push_back(std::make_pair(i, j));
+		}
+	}
+
+	ROS_INFO("Collision prefilter : %d links, %d world shapes, %d self collision pairs", (int) links_.size(),
+			(int) leaves.size(), (int) self_collision_pairs_.size());
+}
+
+int CollisionPrefilter::buildNode(std::vector<Node>& leaves, int begin, int end)
+{
+	Node node;
+	node.box_ = leaves[begin].box_;
+	for (int i = begin + 1; i < end; ++i)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			node.box_.min_(d) = std::min(node.box_.min_(d), leaves[i].box_.min_(d));
+			node.box_.max_(d) = std::max(node.box_.max_(d), leaves[i].box_.max_(d));
+		}
+	}
+
+	if (end - begin == 1)
+	{
+		nodes_.push_back(leaves[begin]);
+		return nodes_.size() - 1;
+	}
+
+	// median split along the longest axis of the box
+	KDL::Vector size = node.box_.max_ - node.box_.min_;
+	int axis = 0;
+	for (int d = 1; d < 3; ++d)
+	{
+		if (size(d) > size(axis))
+			axis = d;
+	}
+	int mid = (begin + end) / 2;
+	std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, NodeCenterLess(axis));
+
+	int index = nodes_.size();
+	node.object_ = -1;
+	nodes_.push_back(node);
+	int left = buildNode(leaves, begin, mid);
+	int right = buildNode(leaves, mid, end);
+	nodes_[index].left_ = left;
+	nodes_[index].right_ = right;
+	return index;
+}
+
+double CollisionPrefilter::getSquaredDistance(const BoundingBox& box, const KDL::Vector& point)
+{
+	double squared_distance = 0.0;
+	for (int d = 0; d < 3; ++d)
+	{
+		double diff = 0.0;
+		if (point(d) < box.min_(d))
+			diff = box.min_(d) - point(d);
+		else if (point(d) > box.max_(d))
+			diff = point(d) - box.max_(d);
+		squared_distance += diff * diff;
+	}
+	return squared_distance;
+}
+
+bool CollisionPrefilter::overlaps(int node, const KDL::Vector& center, double radius, int link) const
+{
+	const Node& n = nodes_[node];
+
+	if (getSquaredDistance(n.box_, center) > radius * radius)
+		return false;
+
+	if (n.left_ < 0)
+		return !allowed_object_collisions_[link][n.object_];
+
+	return overlaps(n.left_, center, radius, link) || overlaps(n.right_, center, radius, link);
+}
+
+double CollisionPrefilter::getDistance(int node, const KDL::Vector& center, int link, double max_distance) const
+{
+	const Node& n = nodes_[node];
+
+	double distance = std::sqrt(getSquaredDistance(n.box_, center));
+	if (distance >= max_distance)
+		return max_distance;
+
+	if (n.left_ < 0)
+		return allowed_object_collisions_[link][n.object_] ? max_distance : distance;
+
+	max_distance = getDistance(n.left_, center, link, max_distance);
+	return getDistance(n.right_, center, link, max_distance);
+}
+
+bool CollisionPrefilter::isCollisionPossible(const ArenaArray<KDL::Frame>& segment_frames, double* clearance) const
+{
+#pragma omp atomic
+	++num_queries_;
+
+	if (clearance != NULL)
+	{
+		// same tests, but every link and pair is visited to find the smallest gap
+		double min_gap = std::numeric_limits<double>::max();
+		for (int i = 0; i < links_.size() && root_ >= 0; ++i)
+		{
+			if (!is_link_moving_[i])
+				continue;
+			const CollisionLink& link = links_[i];
+			double max_distance = min_gap + link.radius_;
+			double distance = getDistance(root_, segment_frames[link.segment_index_] * link.center_, i, max_distance);
+			min_gap = std::min(min_gap, distance - link.radius_);
+		}
+		for (int i = 0; i < self_collision_pairs_.size(); ++i)
+		{
+			const CollisionLink& link1 = links_[self_collision_pairs_[i].first];
+			const CollisionLink& link2 = links_[self_collision_pairs_[i].second];
+			double distance = (segment_frames[link1.segment_index_] * link1.center_
+					- segment_frames[link2.segment_index_] * link2.center_).Norm();
+			min_gap = std::min(min_gap, distance - link1.radius_ - link2.radius_);
+		}
+
+		*clearance = min_gap;
+		if (min_gap > 0.0)
+		{
+#pragma omp atomic
+			++num_skipped_queries_;
+			return false;
+		}
+		return true;
+	}
+
+	bool possible = false;
+	if (root_ >= 0)
+	{
+		for (int i = 0; i < links_.size() && !possible; ++i)
+		{
+			if (!is_link_moving_[i])
+				continue;
+			const CollisionLink& link = links_[i];
+			possible = overlaps(root_, segment_frames[link.segment_index_] * link.center_, link.radius_, i);
+		}
+	}
+	for (int i = 0; i < self_collision_pairs_.size() && !possible; ++i)
+	{
+		const CollisionLink& link1 = links_[self_collision_pairs_[i].first];
+		const CollisionLink& link2 = links_[self_collision_pairs_[i].second];
+		KDL::Vector diff = segment_frames[link1.segment_index_] * link1.center_
+				- segment_frames[link2.segment_index_] * link2.center_;
+		double radius = link1.radius_ + link2.radius_;
+		possible = KDL::dot(diff, diff) < radius * radius;
+	}
+
+	if (!possible)
+	{
+#pragma omp atomic
+		++num_skipped_queries_;
+	}
+	return possible;
+}
+
+}
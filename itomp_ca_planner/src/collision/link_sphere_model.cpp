@@ -0,0 +1,191 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/collision/link_sphere_model.h>
+#include <itomp_ca_planner/model/itomp_robot_model.h>
+#include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
+#include <ros/ros.h>
+#include <cmath>
+#include <limits>
+
+namespace itomp_ca_planner
+{
+
+LinkSphereModel::LinkSphereModel()
+{
+}
+
+LinkSphereModel::~LinkSphereModel()
+{
+}
+
+void LinkSphereModel::init(const ItompRobotModel* robot_model)
+{
+	spheres_.clear();
+	links_.clear();
+
+	const KDL::SegmentMap& segment_map = robot_model->getKDLTree()->getSegments();
+	const std::vector<const robot_model::LinkModel*>& link_models =
+			robot_model->getRobotModel()->getLinkModelsWithCollisionGeometry();
+	for (int i = 0; i < link_models.size(); ++i)
+	{
+		const robot_model::LinkModel* link_model = link_models[i];
+		if (segment_map.find(link_model->getName()) == segment_map.end())
+		{
+			// no FK frame to place spheres in
+			addLink(link_model->getName(), 0, spheres_.size(), false);
+			continue;
+		}
+		int segment_index = robot_model->getForwardKinematicsSolver()->segmentNameToIndex(link_model->getName());
+		int first_sphere = spheres_.size();
+		bool bounded = true;
+
+		const std::vector<shapes::ShapeConstPtr>& shapes = link_model->getShapes();
+		for (int j = 0; j < shapes.size(); ++j)
+		{
+			const shapes::Shape* shape = shapes[j].get();
+			const Eigen::Affine3d& origin = link_model->getCollisionOriginTransforms()[j];
+
+			if (shape->type == shapes::SPHERE)
+			{
+				const Eigen::Vector3d& center = origin.translation();
+				CollisionSphere sphere;
+				sphere.segment_index_ = segment_index;
+				sphere.center_ = KDL::Vector(center(0), center(1), center(2));
+				sphere.radius_ = static_cast<const shapes::Sphere*>(shape)->radius;
+				spheres_.push_back(sphere);
+				continue;
+			}
+
+			if (shape->type != shapes::BOX && shape->type != shapes::CYLINDER && shape->type != shapes::CONE
+					&& shape->type != shapes::MESH)
+			{
+				bounded = false;
+				continue;
+			}
+
+			// bounding box of the shape in the shape frame
+			Eigen::Vector3d box_center = Eigen::Vector3d::Zero();
+			Eigen::Vector3d box_size;
+			const shapes::Mesh* mesh = dynamic_cast<const shapes::Mesh*>(shape);
+			if (mesh != NULL)
+			{
+				if (mesh->vertex_count == 0)
+					continue;
+				Eigen::Vector3d min_corner = Eigen::Map<const Eigen::Vector3d>(mesh->vertices);
+				Eigen::Vector3d max_corner = min_corner;
+				for (unsigned int v = 1; v < mesh->vertex_count; ++v)
+				{
+					Eigen::Map<const Eigen::Vector3d> vertex(mesh->vertices + 3 * v);
+					min_corner = min_corner.cwiseMin(vertex);
+					max_corner = max_corner.cwiseMax(vertex);
+				}
+				box_center = 0.5 * (min_corner + max_corner);
+				box_size = max_corner - min_corner;
+			}
+			else
+				box_size = shapes::computeShapeExtents(shape);
+
+			// split the longest axis into slabs no longer than the smallest cross section
+			// size, and cover each slab by the sphere through its corners
+			int axis;
+			double length = box_size.maxCoeff(&axis);
+			double width = box_size((axis + 1) % 3);
+			double height = box_size((axis + 2) % 3);
+			double slab_length = std::max(std::min(width, height), 1e-3);
+			int num_spheres = std::max(1, (int) std::ceil(length / slab_length));
+			slab_length = length / num_spheres;
+			double radius = 0.5 * std::sqrt(width * width + height * height + slab_length * slab_length);
+
+			for (int k = 0; k < num_spheres; ++k)
+			{
+				Eigen::Vector3d local_center = box_center;
+				local_center(axis) += -0.5 * length + (k + 0.5) * slab_length;
+				Eigen::Vector3d center = origin * local_center;
+
+				CollisionSphere sphere;
+				sphere.segment_index_ = segment_index;
+				sphere.center_ = KDL::Vector(center(0), center(1), center(2));
+				sphere.radius_ = radius;
+				spheres_.push_back(sphere);
+			}
+		}
+
+		addLink(link_model->getName(), segment_index, first_sphere, bounded);
+	}
+
+	ROS_INFO("%d collision spheres for %d links", (int) spheres_.size(), (int) links_.size());
+}
+
+void LinkSphereModel::addLink(const std::string& name, int segment_index, int first_sphere, bool bounded)
+{
+	int end_sphere = spheres_.size();
+	if (!bounded || first_sphere == end_sphere)
+	{
+		// a link without spheres is not bounded; the infinite radius makes the
+		// prefilter treat it as always possibly colliding
+		ROS_WARN("Collision geometry of link %s is not covered by spheres", name.c_str());
+		CollisionLink link;
+		link.name_ = name;
+		link.segment_index_ = segment_index;
+		link.center_ = KDL::Vector::Zero();
+		link.radius_ = std::numeric_limits<double>::infinity();
+		links_.push_back(link);
+		return;
+	}
+
+	// centered at the mean of the sphere centers, not the tightest sphere
+	KDL::Vector center = KDL::Vector::Zero();
+	for (int i = first_sphere; i < end_sphere; ++i)
+		center += spheres_[i].center_;
+	center = center / (end_sphere - first_sphere);
+
+	double radius = 0.0;
+	for (int i = first_sphere; i < end_sphere; ++i)
+		radius = std::max(radius, (spheres_[i].center_ - center).Norm() + spheres_[i].radius_);
+
+	CollisionLink link;
+	link.name_ = name;
+	link.segment_index_ = segment_index;
+	link.center_ = center;
+	link.radius_ = radius;
+	links_.push_back(link);
+}
+
+}
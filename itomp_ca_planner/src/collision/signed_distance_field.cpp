@@ -0,0 +1,382 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/collision/signed_distance_field.h>
+#include <geometric_shapes/bodies.h>
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <ros/ros.h>
+#include <limits>
+#include <cmath>
+
+namespace itomp_ca_planner
+{
+
+// larger grids are coarsened
+static const int MAX_SDF_CELLS = 256 * 256 * 256;
+
+SignedDistanceField::SignedDistanceField() :
+		origin_(KDL::Vector::Zero()), resolution_(1.0)
+{
+	size_[0] = size_[1] = size_[2] = 0;
+}
+
+SignedDistanceField::~SignedDistanceField()
+{
+}
+
+void SignedDistanceField::build(const collision_detection::World& world, double resolution, double padding)
+{
+	distances_.clear();
+	size_[0] = size_[1] = size_[2] = 0;
+
+	std::vector<bodies::Body*> bodies;
+	Eigen::Vector3d min_corner, max_corner;
+	for (collision_detection::World::const_iterator it = world.begin(); it != world.end(); ++it)
+	{
+		const collision_detection::World::Object& object = *it->second;
+		for (int i = 0; i < object.shapes_.size(); ++i)
+		{
+			bodies::Body* body = bodies::createBodyFromShape(object.shapes_[i].get());
+			if (body == NULL)
+				continue;
+			body->setPose(object.shape_poses_[i]);
+
+			bodies::BoundingSphere sphere;
+			body->computeBoundingSphere(sphere);
+			Eigen::Vector3d radius = Eigen::Vector3d::Constant(sphere.radius + padding);
+			if (bodies.empty())
+			{
+				min_corner = sphere.center - radius;
+				max_corner = sphere.center + radius;
+			}
+			else
+			{
+				min_corner = min_corner.cwiseMin(sphere.center - radius);
+				max_corner = max_corner.cwiseMax(sphere.center + radius);
+			}
+			bodies.push_back(body);
+		}
+	}
+	if (bodies.empty())
+		return;
+
+	resolution_ = resolution;
+	Eigen::Vector3d extents = max_corner - min_corner;
+	while (true)
+	{
+		for (int d = 0; d < 3; ++d)
+			size_[d] = (int) std::ceil(extents(d) / resolution_) + 1;
+		if ((double) size_[0] * size_[1] * size_[2] <= MAX_SDF_CELLS)
+			break;
+		resolution_ *= 1.25;
+	}
+	if (resolution_ != resolution)
+		ROS_WARN("Signed distance field resolution is increased to %f", resolution_);
+	origin_ = KDL::Vector(min_corner(0), min_corner(1), min_corner(2));
+
+	// voxelize the bodies
+	int num_cells = size_[0] * size_[1] * size_[2];
+	std::vector<char> occupied(num_cells, 0);
+	for (int i = 0; i < bodies.size(); ++i)
+	{
+		bodies::BoundingSphere sphere;
+		bodies[i]->computeBoundingSphere(sphere);
+
+		int cell_begin[3], cell_end[3];
+		for (int d = 0; d < 3; ++d)
+		{
+			cell_begin[d] = std::max(0, (int) std::floor((sphere.center(d) - sphere.radius - origin_(d)) / resolution_));
+			cell_end[d] = std::min(size_[d], (int) std::ceil((sphere.center(d) + sphere.radius - origin_(d)) / resolution_) + 1);
+		}
+		for (int x = cell_begin[0]; x < cell_end[0]; ++x)
+		{
+			for (int y = cell_begin[1]; y < cell_end[1]; ++y)
+			{
+				for (int z = cell_begin[2]; z < cell_end[2]; ++z)
+				{
+					int index = getCellIndex(x, y, z);
+					if (occupied[index])
+						continue;
+					Eigen::Vector3d center(origin_.x() + x * resolution_, origin_.y() + y * resolution_,
+							origin_.z() + z * resolution_);
+					if (bodies[i]->containsPoint(center))
+						occupied[index] = 1;
+				}
+			}
+		}
+		delete bodies[i];
+	}
+
+	// outside distance to the nearest occupied cell, inside distance to the nearest free cell
+	std::vector<char> is_free(num_cells);
+	for (int i = 0; i < num_cells; ++i)
+		is_free[i] = !occupied[i];
+	std::vector<double> outside_distances, inside_distances;
+	computeSquaredDistances(occupied, outside_distances);
+	computeSquaredDistances(is_free, inside_distances);
+
+	distances_.resize(num_cells);
+	for (int i = 0; i < num_cells; ++i)
+	{
+		distances_[i] = resolution_
+				* (std::sqrt(outside_distances[i]) - std::sqrt(inside_distances[i]));
+	}
+}
+
+void SignedDistanceField::computeSquaredDistances(const std::vector<char>& is_site,
+		std::vector<double>& squared_distances) const
+{
+	const double infinity = std::numeric_limits<double>::max();
+	int num_cells = size_[0] * size_[1] * size_[2];
+	squared_distances.resize(num_cells);
+	for (int i = 0; i < num_cells; ++i)
+		squared_distances[i] = is_site[i] ? 0.0 : infinity;
+
+	// separable transform along z, y and x
+	int max_size = std::max(size_[0], std::max(size_[1], size_[2]));
+	std::vector<double> f(max_size), d(max_size), z(max_size + 1);
+	std::vector<int> v(max_size);
+	const int strides[3] =
+	{ size_[1] * size_[2], size_[2], 1 };
+	for (int axis = 2; axis >= 0; --axis)
+	{
+		int n = size_[axis];
+		int stride = strides[axis];
+		int other0 = (axis == 0) ? 1 : 0;
+		int other1 = (axis == 2) ? 1 : 2;
+		for (int a = 0; a < size_[other0]; ++a)
+		{
+			for (int b = 0; b < size_[other1]; ++b)
+			{
+				int base = a * strides[other0] + b * strides[other1];
+				for (int i = 0; i < n; ++i)
+					f[i] = squared_distances[base + i * stride];
+				distanceTransform1D(&f[0], n, &d[0], &v[0], &z[0]);
+				for (int i = 0; i < n; ++i)
+					squared_distances[base + i * stride] = d[i];
+			}
+		}
+	}
+
+	// no sites at all, e.g. the bodies are smaller than a cell
+	double max_squared_distance = (double) size_[0] * size_[0] + (double) size_[1] * size_[1]
+			+ (double) size_[2] * size_[2];
+	for (int i = 0; i < num_cells; ++i)
+	{
+		if (squared_distances[i] == infinity)
+			squared_distances[i] = max_squared_distance;
+	}
+}
+
+void SignedDistanceField::distanceTransform1D(const double* f, int n, double* d, int* v, double* z)
+{
+	const double infinity = std::numeric_limits<double>::max();
+
+	// lower envelope of the parabolas rooted at the finite samples
+	int k = -1;
+	for (int q = 0; q < n; ++q)
+	{
+		if (f[q] == infinity)
+			continue;
+		double s = -infinity;
+		while (k >= 0)
+		{
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+			if (s > z[k])
+				break;
+			--k;
+		}
+		++k;
+		v[k] = q;
+		z[k] = (k == 0) ? -infinity : s;
+		z[k + 1] = infinity;
+	}
+
+	if (k < 0)
+	{
+		for (int q = 0; q < n; ++q)
+			d[q] = infinity;
+		return;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; ++q)
+	{
+		while (z[k + 1] < q)
+			++k;
+		double diff = q - v[k];
+		d[q] = diff * diff + f[v[k]];
+	}
+}
+
+double SignedDistanceField::getDistance(const KDL::Vector& position) const
+{
+	KDL::Vector gradient;
+	return getDistance(position, gradient);
+}
+
+double SignedDistanceField::getDistance(const KDL::Vector& position, KDL::Vector& gradient) const
+{
+	if (distances_.empty())
+	{
+		gradient = KDL::Vector::Zero();
+		return std::numeric_limits<double>::max();
+	}
+
+	// positions outside of the grid are projected to the grid boundary
+	double cell[3];
+	double outside = 0.0;
+	KDL::Vector outside_direction = KDL::Vector::Zero();
+	for (int d = 0; d < 3; ++d)
+	{
+		cell[d] = (position(d) - origin_(d)) / resolution_;
+		double max_cell = size_[d] - 1;
+		if (cell[d] < 0.0)
+		{
+			outside_direction(d) = cell[d];
+			cell[d] = 0.0;
+		}
+		else if (cell[d] > max_cell)
+		{
+			outside_direction(d) = cell[d] - max_cell;
+			cell[d] = max_cell;
+		}
+	}
+	outside = outside_direction.Norm();
+
+	int c[3];
+	double t[3];
+	for (int d = 0; d < 3; ++d)
+	{
+		c[d] = std::min((int) cell[d], std::max(size_[d] - 2, 0));
+		t[d] = cell[d] - c[d];
+	}
+	int c1[3];
+	for (int d = 0; d < 3; ++d)
+		c1[d] = std::min(c[d] + 1, size_[d] - 1);
+
+	double d000 = getCellDistance(c[0], c[1], c[2]);
+	double d001 = getCellDistance(c[0], c[1], c1[2]);
+	double d010 = getCellDistance(c[0], c1[1], c[2]);
+	double d011 = getCellDistance(c[0], c1[1], c1[2]);
+	double d100 = getCellDistance(c1[0], c[1], c[2]);
+	double d101 = getCellDistance(c1[0], c[1], c1[2]);
+	double d110 = getCellDistance(c1[0], c1[1], c[2]);
+	double d111 = getCellDistance(c1[0], c1[1], c1[2]);
+
+	// interpolate along z, then y, then x
+	double d00 = d000 + (d001 - d000) * t[2];
+	double d01 = d010 + (d011 - d010) * t[2];
+	double d10 = d100 + (d101 - d100) * t[2];
+	double d11 = d110 + (d111 - d110) * t[2];
+	double d0 = d00 + (d01 - d00) * t[1];
+	double d1 = d10 + (d11 - d10) * t[1];
+	double distance = d0 + (d1 - d0) * t[0];
+
+	// derivatives of the interpolant
+	double dz0 = (d001 - d000) + ((d011 - d010) - (d001 - d000)) * t[1];
+	double dz1 = (d101 - d100) + ((d111 - d110) - (d101 - d100)) * t[1];
+	gradient.x(d1 - d0);
+	gradient.y((d01 - d00) + ((d11 - d10) - (d01 - d00)) * t[0]);
+	gradient.z(dz0 + (dz1 - dz0) * t[0]);
+	gradient = gradient / resolution_;
+
+	if (outside > 0.0)
+	{
+		distance += outside * resolution_;
+		gradient += outside_direction / outside;
+	}
+
+	return distance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SignedDistanceFieldCache::SignedDistanceFieldCache() :
+		world_hash_(0), resolution_(0.0), padding_(0.0)
+{
+}
+
+SignedDistanceFieldCache::~SignedDistanceFieldCache()
+{
+}
+
+SignedDistanceFieldConstPtr SignedDistanceFieldCache::getSignedDistanceField(
+		const planning_scene::PlanningSceneConstPtr& planning_scene, double resolution, double padding)
+{
+	const collision_detection::World& world = *planning_scene->getWorld();
+	std::size_t world_hash = computeWorldHash(world);
+
+	boost::lock_guard<boost::mutex> guard(mutex_);
+	if (!field_ || world_hash != world_hash_ || resolution != resolution_ || padding != padding_)
+	{
+		ros::WallTime start_time = ros::WallTime::now();
+
+		boost::shared_ptr<SignedDistanceField> field(new SignedDistanceField());
+		field->build(world, resolution, padding);
+		field_ = field;
+		world_hash_ = world_hash;
+		resolution_ = resolution;
+		padding_ = padding;
+
+		ROS_INFO("Signed distance field of %d world objects computed in %f sec", (int) world.size(),
+				(ros::WallTime::now() - start_time).toSec());
+	}
+	return field_;
+}
+
+std::size_t SignedDistanceFieldCache::computeWorldHash(const collision_detection::World& world)
+{
+	std::size_t hash = 0;
+	for (collision_detection::World::const_iterator it = world.begin(); it != world.end(); ++it)
+	{
+		const collision_detection::World::Object& object = *it->second;
+		boost::hash_combine(hash, object.id_);
+		for (int i = 0; i < object.shapes_.size(); ++i)
+		{
+			boost::hash_combine(hash, object.shapes_[i].get());
+			const Eigen::Matrix4d& pose = object.shape_poses_[i].matrix();
+			for (int j = 0; j < 16; ++j)
+				boost::hash_combine(hash, pose.data()[j]);
+		}
+	}
+	return hash;
+}
+
+}
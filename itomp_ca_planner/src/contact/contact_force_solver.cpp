@@ -39,8 +39,10 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <ros/ros.h>
 #include <itomp_ca_planner/common.h>
 #include <itomp_ca_planner/contact/contact_force_solver.h>
-#include <itomp_ca_planner/optimization/f2c.h>
-#include <itomp_ca_planner/optimization/clapack.h>
+#include <itomp_ca_planner/contact/levmar.h>
+#include <itomp_ca_planner/util/planning_parameters.h>
+#include <Eigen/QR>
+#include <cfloat>
 
 namespace itomp_ca_planner
 {
@@ -49,194 +51,387 @@ const double w1 = 1e-1;
 const double w2 = 1e-7;
 const double dz = -0.1;
 
-ContactForceSolver::ContactForceSolver()
+namespace
 {
-
-}
-
-ContactForceSolver::~ContactForceSolver()
+const double k_0 = 1e-4;
+const double k_1 = 1e-5;
+
+const double CONTACT_MIN_DIR = -0.1;
+const double CONTACT_MAX_DIR = 0.19;
+const double CONTACT_MIN_RIGHT = -0.1;
+const double CONTACT_MAX_RIGHT = 0.1;
+
+// Dimension of a system with EXTRA shared rows and PER_CONTACT rows per contact.
+// Dynamic if the number of contacts is only known at run time.
+template<int NUM_CONTACTS, int PER_CONTACT, int EXTRA>
+struct SystemSize
 {
-
-}
-
-void ContactForceSolver::operator()(double friction_coeff, std::vector<KDL::Vector>& contact_forces,
-    std::vector<KDL::Vector>& contact_positions, const KDL::Wrench& wrench, const std::vector<double>& contact_values,
-    const std::vector<KDL::Frame> contact_parent_frames)
+  enum
+  {
+    value = (NUM_CONTACTS == Eigen::Dynamic) ? Eigen::Dynamic : EXTRA + PER_CONTACT * NUM_CONTACTS
+  };
+};
+
+// Both least-squares systems have a sparsity pattern that only depends on the
+// number of contacts. They are assembled into fixed-size matrices (allocated
+// once per batch) and solved with a Householder QR that is fully unrolled for
+// the common contact counts.
+template<int NUM_CONTACTS>
+void solveBatch(int num_points, int num_contacts, const KDL::Wrench* wrenches,
+    const KDL::Frame* contact_parent_frames, const double* contact_values, KDL::Vector* contact_forces,
+    KDL::Vector* contact_positions)
 {
-  const double k_0 = 1e-4;
-  const double k_1 = 1e-5;
+  typedef Eigen::Matrix<double, SystemSize<NUM_CONTACTS, 3, 6>::value, SystemSize<NUM_CONTACTS, 3, 0>::value> ForceMatrix;
+  typedef Eigen::Matrix<double, SystemSize<NUM_CONTACTS, 3, 6>::value, 1> ForceVector;
+  typedef Eigen::Matrix<double, SystemSize<NUM_CONTACTS, 2, 3>::value, SystemSize<NUM_CONTACTS, 2, 0>::value> CopMatrix;
+  typedef Eigen::Matrix<double, SystemSize<NUM_CONTACTS, 2, 3>::value, 1> CopVector;
 
-  int num_contacts = contact_forces.size();
+  ForceMatrix A_force(6 + 3 * num_contacts, 3 * num_contacts);
+  ForceVector b_force(6 + 3 * num_contacts);
+  CopMatrix A_cop(3 + 2 * num_contacts, 2 * num_contacts);
+  CopVector b_cop(3 + 2 * num_contacts);
 
-  // compute contact forces using linear programming
+  for (int point = 0; point < num_points; ++point)
   {
-    char trans = 'N';
-    integer m = 6 + num_contacts * 3;
-    integer n = num_contacts * 3;
-    integer nrhs = 1;
-    integer lda = m;
-    integer ldb = m;
-    integer lwork = m * n;
-    integer info = 0;
-
-    doublereal A[m * n];
-    doublereal b[m];
-    doublereal work[lwork];
-
-    // set A
-    memset(A, 0, sizeof(doublereal) * m * n);
-    int row = 0, column = 0;
+    const KDL::Wrench& wrench = wrenches[point];
+    const KDL::Frame* parent_frames = contact_parent_frames + point * num_contacts;
+    const double* values = contact_values + point * num_contacts;
+    KDL::Vector* forces = contact_forces + point * num_contacts;
+    KDL::Vector* positions = contact_positions + point * num_contacts;
+
+    // contact forces
+    A_force.setZero();
     for (int i = 0; i < num_contacts; ++i)
     {
-      // lapack uses column-major matrices
-      // A[r + c * lda]
-      A[0 + (column + 0) * lda] = 1;
-      A[1 + (column + 1) * lda] = 1;
-      A[2 + (column + 2) * lda] = 1;
-      column += 3;
+      const int column = 3 * i;
+      const KDL::Vector& p = parent_frames[i].p;
+
+      A_force(0, column + 0) = 1;
+      A_force(1, column + 1) = 1;
+      A_force(2, column + 2) = 1;
+
+      A_force(3, column + 1) = w1 * -p.z();
+      A_force(3, column + 2) = w1 * p.y();
+      A_force(4, column + 0) = w1 * p.z();
+      A_force(4, column + 2) = w1 * -p.x();
+      A_force(5, column + 0) = w1 * -p.y();
+      A_force(5, column + 1) = w1 * p.x();
+
+      const double contact_value = 5.0 * values[i];
+      const double e = k_0 / (contact_value * contact_value * contact_value * contact_value + k_1);
+      A_force(6 + column + 0, column + 0) = e;
+      A_force(6 + column + 1, column + 1) = e;
+      A_force(6 + column + 2, column + 2) = e;
     }
-    row = 3;
-    column = 0;
+
+    b_force.setZero();
+    b_force(0) = -wrench.force.x();
+    b_force(1) = -wrench.force.y();
+    b_force(2) = -wrench.force.z();
+    b_force(3) = w1 * -wrench.torque.x();
+    b_force(4) = w1 * -wrench.torque.y();
+    b_force(5) = w1 * -wrench.torque.z();
+
+    const Eigen::Matrix<double, ForceMatrix::ColsAtCompileTime, 1> x_force = A_force.householderQr().solve(b_force);
     for (int i = 0; i < num_contacts; ++i)
-    {
-      const KDL::Vector& p = contact_parent_frames[i].p;
-      A[(row + 0) + (column + 1) * lda] = w1 * -p.z();
-      A[(row + 0) + (column + 2) * lda] = w1 * p.y();
-      A[(row + 1) + (column + 0) * lda] = w1 * p.z();
-      A[(row + 1) + (column + 2) * lda] = w1 * -p.x();
-      A[(row + 2) + (column + 0) * lda] = w1 * -p.y();
-      A[(row + 2) + (column + 1) * lda] = w1 * p.x();
-
-      column += 3;
-    }
-    row = 6;
-    column = 0;
+      forces[i] = KDL::Vector(x_force(3 * i), x_force(3 * i + 1), x_force(3 * i + 2));
+
+    // centers of pressure (contact positions)
+    A_cop.setZero();
+    b_cop.setZero();
+    b_cop(0) = -wrench.torque.x();
+    b_cop(1) = -wrench.torque.y();
+    b_cop(2) = -wrench.torque.z();
     for (int i = 0; i < num_contacts; ++i)
     {
-      const doublereal contact_value = 5.0 * contact_values[i];
-      const doublereal e = (i < 2 ? 1.0 : 1.0) * k_0 / (contact_value * contact_value * contact_value * contact_value + k_1);
-      A[(row + 0) + (column + 0) * lda] = e;
-      A[(row + 1) + (column + 1) * lda] = e;
-      A[(row + 2) + (column + 2) * lda] = e;
-      row += 3;
-      column += 3;
+      const int column = 2 * i;
+      const KDL::Vector& p = parent_frames[i].p;
+      const KDL::Vector& f = forces[i];
+
+      A_cop(0, column + 1) = f.z();
+      A_cop(1, column + 0) = -f.z();
+      A_cop(2, column + 0) = f.y();
+      A_cop(2, column + 1) = -f.x();
+
+      A_cop(3 + column + 0, column + 0) = w2;
+      A_cop(3 + column + 1, column + 1) = w2;
+
+      const KDL::Vector torque = p * f;
+      b_cop(0) -= torque.x();
+      b_cop(1) -= torque.y();
+      b_cop(2) -= torque.z();
+
+      b_cop(0) += dz * f.y();
+      b_cop(1) += dz * f.x();
     }
 
-    // set b
-    b[0] = -wrench.force.x();
-    b[1] = -wrench.force.y();
-    b[2] = -wrench.force.z();
-    b[3] = w1 * -wrench.torque.x();
-    b[4] = w1 * -wrench.torque.y();
-    b[5] = w1 * -wrench.torque.z();
-    row = 6;
+    const Eigen::Matrix<double, CopMatrix::ColsAtCompileTime, 1> x_cop = A_cop.householderQr().solve(b_cop);
     for (int i = 0; i < num_contacts; ++i)
     {
-      b[row] = 0;
-      b[row + 1] = 0;
-      b[row + 2] = 0;
-      row += 3;
+      KDL::Vector diff = KDL::Vector(x_cop(2 * i), x_cop(2 * i + 1), dz);
+      diff.x(std::min(diff.x(), CONTACT_MAX_RIGHT));
+      diff.x(std::max(diff.x(), CONTACT_MIN_RIGHT));
+      diff.y(std::min(diff.y(), CONTACT_MAX_DIR));
+      diff.y(std::max(diff.y(), CONTACT_MIN_DIR));
+      diff = parent_frames[i].M * diff;
+      positions[i] = parent_frames[i].p + diff;
     }
+  }
+}
 
-    // solve
-    dgels_(&trans, &m, &n, &nrhs, A, &lda, b, &ldb, work, &lwork, &info);
+void solveLinear(int num_points, int num_contacts, const KDL::Wrench* wrenches,
+    const KDL::Frame* contact_parent_frames, const double* contact_values, KDL::Vector* contact_forces,
+    KDL::Vector* contact_positions)
+{
+  switch (num_contacts)
+  {
+  case 1:
+    solveBatch<1>(num_points, num_contacts, wrenches, contact_parent_frames, contact_values, contact_forces,
+        contact_positions);
+    break;
+  case 2:
+    solveBatch<2>(num_points, num_contacts, wrenches, contact_parent_frames, contact_values, contact_forces,
+        contact_positions);
+    break;
+  case 3:
+    solveBatch<3>(num_points, num_contacts, wrenches, contact_parent_frames, contact_values, contact_forces,
+        contact_positions);
+    break;
+  case 4:
+    solveBatch<4>(num_points, num_contacts, wrenches, contact_parent_frames, contact_values, contact_forces,
+        contact_positions);
+    break;
+  default:
+    solveBatch<Eigen::Dynamic>(num_points, num_contacts, wrenches, contact_parent_frames, contact_values,
+        contact_forces, contact_positions);
+    break;
+  }
+}
 
-    row = 0;
-    for (int i = 0; i < num_contacts; ++i)
-    {
-      double x = b[row];
-      double y = b[row + 1];
-      double z = b[row + 2];
-      contact_forces[i] = KDL::Vector(x, y, z);
-      row += 3;
-    }
+#ifdef ITOMP_HAVE_LEVMAR
+// Nonlinear contact problem of one waypoint. The parameters of contact i are
+// p[5i .. 5i+4] = (force x, y, z, center of pressure offset x, y), where the
+// offset is in the parent frame at height dz. The residuals are the force and
+// torque balance (6), the contact-value weighted force magnitudes (3 per
+// contact) and a small regularization of the offsets (2 per contact).
+struct ContactProblem
+{
+  int num_contacts_;
+  const KDL::Wrench* wrench_;
+  const KDL::Frame* parent_frames_;
+  const double* contact_values_;
+};
+
+inline double contactForceWeight(double value)
+{
+  const double contact_value = 5.0 * value;
+  return k_0 / (contact_value * contact_value * contact_value * contact_value + k_1);
+}
+
+void evaluateContactProblem(double* p, double* hx, int m, int n, void* adata)
+{
+  const ContactProblem& problem = *static_cast<const ContactProblem*>(adata);
+  const int num_contacts = problem.num_contacts_;
+
+  KDL::Vector force = problem.wrench_->force;
+  KDL::Vector torque = problem.wrench_->torque;
+  for (int i = 0; i < num_contacts; ++i)
+  {
+    const double* pi = p + 5 * i;
+    const KDL::Frame& parent_frame = problem.parent_frames_[i];
+    const KDL::Vector f(pi[0], pi[1], pi[2]);
+    const KDL::Vector r = parent_frame.p + parent_frame.M * KDL::Vector(pi[3], pi[4], dz);
+    force += f;
+    torque += r * f;
+
+    const double e = contactForceWeight(problem.contact_values_[i]);
+    hx[6 + 3 * i + 0] = e * f.x();
+    hx[6 + 3 * i + 1] = e * f.y();
+    hx[6 + 3 * i + 2] = e * f.z();
+    hx[6 + 3 * num_contacts + 2 * i + 0] = w2 * pi[3];
+    hx[6 + 3 * num_contacts + 2 * i + 1] = w2 * pi[4];
   }
+  hx[0] = force.x();
+  hx[1] = force.y();
+  hx[2] = force.z();
+  hx[3] = torque.x();
+  hx[4] = torque.y();
+  hx[5] = torque.z();
+}
+
+void evaluateContactProblemJacobian(double* p, double* jac, int m, int n, void* adata)
+{
+  const ContactProblem& problem = *static_cast<const ContactProblem*>(adata);
+  const int num_contacts = problem.num_contacts_;
 
-  ///////////////////////////////////////////////////////////////
-  // compute center of pressure (contact positions) using linear programming
+  // row-major n x m
+  std::fill(jac, jac + n * m, 0.0);
+  for (int i = 0; i < num_contacts; ++i)
   {
-    const double CONTACT_MIN_DIR = -0.1;
-    const double CONTACT_MAX_DIR = 0.19;
-    const double CONTACT_MIN_RIGHT = -0.1;
-    const double CONTACT_MAX_RIGHT = 0.1;
-
-    char trans = 'N';
-    integer m = 3 + num_contacts * 2;
-    integer n = num_contacts * 2;
-    integer nrhs = 1;
-    integer lda = m;
-    integer ldb = m;
-    integer lwork = m * n;
-    integer info = 0;
-
-    doublereal A[m * n];
-    doublereal b[m];
-    doublereal work[lwork];
-
-    // set A
-    memset(A, 0, sizeof(doublereal) * m * n);
-    int row = 0, column = 0;
-    for (int i = 0; i < num_contacts; ++i)
+    const double* pi = p + 5 * i;
+    const int column = 5 * i;
+    const KDL::Frame& parent_frame = problem.parent_frames_[i];
+    const KDL::Vector f(pi[0], pi[1], pi[2]);
+    const KDL::Vector r = parent_frame.p + parent_frame.M * KDL::Vector(pi[3], pi[4], dz);
+
+    // d(sum f) / df
+    for (int k = 0; k < 3; ++k)
+      jac[k * m + column + k] = 1.0;
+
+    // d(r x f) / df = [r]x
+    jac[3 * m + column + 1] = -r.z();
+    jac[3 * m + column + 2] = r.y();
+    jac[4 * m + column + 0] = r.z();
+    jac[4 * m + column + 2] = -r.x();
+    jac[5 * m + column + 0] = -r.y();
+    jac[5 * m + column + 1] = r.x();
+
+    // d(r x f) / dc = (M e_c) x f
+    const KDL::Vector dtorque_dx = parent_frame.M.UnitX() * f;
+    const KDL::Vector dtorque_dy = parent_frame.M.UnitY() * f;
+    for (int k = 0; k < 3; ++k)
     {
-      // lapack uses column-major matrices
-      // A[r + c * lda]
-      A[0 + (column + 1) * lda] = contact_forces[i].z();
-      A[1 + (column + 0) * lda] = -contact_forces[i].z();
-      A[2 + (column + 0) * lda] = contact_forces[i].y();
-      A[2 + (column + 1) * lda] = -contact_forces[i].x();
-      column += 2;
+      jac[(3 + k) * m + column + 3] = dtorque_dx(k);
+      jac[(3 + k) * m + column + 4] = dtorque_dy(k);
     }
-    row = 3;
-    column = 0;
-    for (int i = 0; i < num_contacts; ++i)
+
+    const double e = contactForceWeight(problem.contact_values_[i]);
+    for (int k = 0; k < 3; ++k)
+      jac[(6 + 3 * i + k) * m + column + k] = e;
+    jac[(6 + 3 * num_contacts + 2 * i + 0) * m + column + 3] = w2;
+    jac[(6 + 3 * num_contacts + 2 * i + 1) * m + column + 4] = w2;
+  }
+}
+#endif
+
+}
+
+ContactForceSolver::ContactForceSolver()
+{
+
+}
+
+ContactForceSolver::~ContactForceSolver()
+{
+
+}
+
+void ContactForceSolver::operator()(double friction_coeff, int num_points, int num_contacts,
+    const KDL::Wrench* wrenches, const KDL::Frame* contact_parent_frames, const double* contact_values,
+    KDL::Vector* contact_forces, KDL::Vector* contact_positions)
+{
+  if (PlanningParameters::getInstance()->getContactForceSolver() == "levmar")
+  {
+#ifdef ITOMP_HAVE_LEVMAR
+    solveConstrained(friction_coeff, num_points, num_contacts, wrenches, contact_parent_frames, contact_values,
+        contact_forces, contact_positions);
+    return;
+#else
+    ROS_WARN_ONCE("itomp_ca_planner was built without levmar. Using the linear contact force solver.");
+#endif
+  }
+
+  solveLinear(num_points, num_contacts, wrenches, contact_parent_frames, contact_values, contact_forces,
+      contact_positions);
+}
+
+void ContactForceSolver::solveConstrained(double friction_coeff, int num_points, int num_contacts,
+    const KDL::Wrench* wrenches, const KDL::Frame* contact_parent_frames, const double* contact_values,
+    KDL::Vector* contact_forces, KDL::Vector* contact_positions)
+{
+#ifdef ITOMP_HAVE_LEVMAR
+  const int m = 5 * num_contacts;
+  const int n = 6 + 5 * num_contacts;
+  const int k2 = 4 * num_contacts;
+  const int max_iterations = PlanningParameters::getInstance()->getContactForceSolverIterations();
+
+  parameters_.resize(m);
+  measurements_.assign(n, 0.0);
+  work_.resize(LM_BLEIC_DER_WORKSZ(m, n, 0, k2));
+
+  // box constraints : unilateral normal forces and center of pressure inside the sole
+  lower_bounds_.resize(m);
+  upper_bounds_.resize(m);
+  for (int i = 0; i < num_contacts; ++i)
+  {
+    double* lb = &lower_bounds_[5 * i];
+    double* ub = &upper_bounds_[5 * i];
+    lb[0] = lb[1] = -DBL_MAX;
+    ub[0] = ub[1] = ub[2] = DBL_MAX;
+    lb[2] = 0.0;
+    lb[3] = CONTACT_MIN_RIGHT;
+    ub[3] = CONTACT_MAX_RIGHT;
+    lb[4] = CONTACT_MIN_DIR;
+    ub[4] = CONTACT_MAX_DIR;
+  }
+
+  // linearized friction cone : mu f_z -+ f_x >= 0, mu f_z -+ f_y >= 0
+  constraints_.assign(k2 * m, 0.0);
+  constraint_bounds_.assign(k2, 0.0);
+  for (int i = 0; i < num_contacts; ++i)
+  {
+    for (int k = 0; k < 4; ++k)
     {
-      A[(row + 0) + (column + 0) * lda] = w2;
-      A[(row + 1) + (column + 1) * lda] = w2;
-      row += 2;
-      column += 2;
+      double* row = &constraints_[(4 * i + k) * m + 5 * i];
+      row[k / 2] = (k % 2 == 0) ? -1.0 : 1.0;
+      row[2] = friction_coeff;
     }
+  }
 
-    // set b
-    b[0] = -wrench.torque.x();
-    b[1] = -wrench.torque.y();
-    b[2] = -wrench.torque.z();
+  double opts[4] =
+  { LM_INIT_MU, 1e-15, 1e-15, 1e-20 };
+  double info[LM_INFO_SZ];
+
+  for (int point = 0; point < num_points; ++point)
+  {
+    const KDL::Frame* parent_frames = contact_parent_frames + point * num_contacts;
+    const double* values = contact_values + point * num_contacts;
+    KDL::Vector* forces = contact_forces + point * num_contacts;
+    KDL::Vector* positions = contact_positions + point * num_contacts;
+
+    // start from the linear solution of the waypoint. The iterations are capped, so
+    // the result depends on the start; it must only depend on the inputs of the
+    // waypoint, not on what the buffers held before or on where the window begins
+    solveLinear(1, num_contacts, wrenches + point, parent_frames, values, forces, positions);
     for (int i = 0; i < num_contacts; ++i)
     {
-      const KDL::Vector& p = contact_parent_frames[i].p;
-      const KDL::Vector& f = contact_forces[i];
-      const KDL::Vector torque = p * f;
-      b[0] -= torque.x();
-      b[1] -= torque.y();
-      b[2] -= torque.z();
-
-      b[0] += dz * f.y();
-      b[1] += dz * f.x();
+      double* pi = &parameters_[5 * i];
+      pi[0] = forces[i].x();
+      pi[1] = forces[i].y();
+      pi[2] = forces[i].z();
+      pi[3] = pi[4] = 0.0;
     }
-    row = 3;
+
+    // project the initial guess into the feasible set
     for (int i = 0; i < num_contacts; ++i)
     {
-      b[row] = 0;
-      b[row + 1] = 0;
-      row += 2;
+      double* pi = &parameters_[5 * i];
+      pi[2] = std::max(pi[2], 0.0);
+      const double max_tangential = friction_coeff * pi[2];
+      pi[0] = std::max(std::min(pi[0], max_tangential), -max_tangential);
+      pi[1] = std::max(std::min(pi[1], max_tangential), -max_tangential);
+      pi[3] = std::max(std::min(pi[3], CONTACT_MAX_RIGHT), CONTACT_MIN_RIGHT);
+      pi[4] = std::max(std::min(pi[4], CONTACT_MAX_DIR), CONTACT_MIN_DIR);
     }
 
-    // solve
-    dgels_(&trans, &m, &n, &nrhs, A, &lda, b, &ldb, work, &lwork, &info);
+    ContactProblem problem;
+    problem.num_contacts_ = num_contacts;
+    problem.wrench_ = wrenches + point;
+    problem.parent_frames_ = parent_frames;
+    problem.contact_values_ = values;
+
+    dlevmar_blic_der(evaluateContactProblem, evaluateContactProblemJacobian, &parameters_[0], &measurements_[0], m,
+        n, &lower_bounds_[0], &upper_bounds_[0], &constraints_[0], &constraint_bounds_[0], k2, max_iterations, opts,
+        info, &work_[0], NULL, &problem);
 
-    row = 0;
     for (int i = 0; i < num_contacts; ++i)
     {
-      const KDL::Rotation& rot = contact_parent_frames[i].M;
-      KDL::Vector diff = KDL::Vector(b[row], b[row + 1], dz);
-      diff.x(min(diff.x(), CONTACT_MAX_RIGHT));
-      diff.x(max(diff.x(), CONTACT_MIN_RIGHT));
-      diff.y(min(diff.y(), CONTACT_MAX_DIR));
-      diff.y(max(diff.y(), CONTACT_MIN_DIR));
-      diff = rot * diff;
-      contact_positions[i] = contact_parent_frames[i].p + diff;
-      row += 2;
+      const double* pi = &parameters_[5 * i];
+      forces[i] = KDL::Vector(pi[0], pi[1], pi[2]);
+      positions[i] = parent_frames[i].p + parent_frames[i].M * KDL::Vector(pi[3], pi[4], dz);
     }
   }
+#endif
 }
 
 }
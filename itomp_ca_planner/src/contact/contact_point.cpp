@@ -58,20 +58,20 @@ ContactPoint::~ContactPoint()
 }
 
 void ContactPoint::getPosition(int point, KDL::Vector& position,
-    const std::vector<std::vector<KDL::Frame> >& segmentFrames) const
+    const ArenaArray2D<KDL::Frame>& segmentFrames) const
 {
   position = segmentFrames[point][linkSegmentNumber_].p;
 }
 
 void ContactPoint::getFrame(int point, KDL::Frame& frame,
-    const std::vector<std::vector<KDL::Frame> >& segmentFrames) const
+    const ArenaArray2D<KDL::Frame>& segmentFrames) const
 {
   frame = segmentFrames[point][linkSegmentNumber_];
 }
 
 void ContactPoint::updateContactViolationVector(int start, int end, double discretization,
-    vector<Vector4d>& contactViolationVector, vector<KDL::Vector>& contactPointVelVector,
-    const vector<vector<KDL::Frame> >& segmentFrames, const planning_scene::PlanningSceneConstPtr& planning_scene) const
+    ArenaArray<Vector4d>& contactViolationVector, ArenaArray<KDL::Vector>& contactPointVelVector,
+    const ArenaArray2D<KDL::Frame>& segmentFrames, const planning_scene::PlanningSceneConstPtr& planning_scene) const
 {
   vector<KDL::Vector> contactPointPosVector(contactViolationVector.size());
   for (int i = start; i <= end; ++i)
@@ -90,22 +90,19 @@ void ContactPoint::updateContactViolationVector(int start, int end, double discr
     contactViolationVector[i] = Vector4d(diff.x(), diff.y(), diff.z(), angle);
     contactPointPosVector[i] = position;
   }
-  //for (int i = 0; i < start; ++i)
-//  if (start == 1)
-  //  contactPointPosVector[0] = segmentFrames[1][linkSegmentNumber_].p;
-  //else
-    contactPointPosVector[start - 1] = segmentFrames[start - 1][linkSegmentNumber_].p;
-  //for (int i = end + 1; i < contactPointPosVector.size(); ++i)
-//  if (end == contactPointPosVector.size() - 2)
-  //  contactPointPosVector[end + 1] = segmentFrames[end][linkSegmentNumber_].p;
-  //else
-    contactPointPosVector[end + 1] = segmentFrames[end + 1][linkSegmentNumber_].p;
+  // the velocity rule reads DIFF_RULE_LENGTH / 2 neighbors on each side, which have to be
+  // valid for windowed evaluations to match the full evaluation
+  int num_points = contactPointPosVector.size();
+  for (int i = max(0, start - DIFF_RULE_LENGTH / 2); i < start; ++i)
+    contactPointPosVector[i] = segmentFrames[i][linkSegmentNumber_].p;
+  for (int i = end + 1; i <= min(num_points - 1, end + DIFF_RULE_LENGTH / 2); ++i)
+    contactPointPosVector[i] = segmentFrames[i][linkSegmentNumber_].p;
 
   itomp_ca_planner::getVectorVelocities(start, end, discretization, contactPointPosVector, contactPointVelVector,
       KDL::Vector::Zero());
 }
 
-double ContactPoint::getDistanceToGround(int point, const std::vector<std::vector<KDL::Frame> >& segmentFrames, const planning_scene::PlanningSceneConstPtr& planning_scene) const
+double ContactPoint::getDistanceToGround(int point, const ArenaArray2D<KDL::Frame>& segmentFrames, const planning_scene::PlanningSceneConstPtr& planning_scene) const
 {
   KDL::Vector position;
   getPosition(point, position, segmentFrames);
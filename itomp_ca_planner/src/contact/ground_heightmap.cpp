@@ -0,0 +1,399 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/contact/ground_heightmap.h>
+#include <itomp_ca_planner/util/point_to_triangle_projection.h>
+#include <geometric_shapes/mesh_operations.h>
+#include <ros/ros.h>
+#include <boost/scoped_ptr.hpp>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace itomp_ca_planner
+{
+
+namespace
+{
+// triangles with steeper normals are not ground
+const double MIN_GROUND_NORMAL_Z = 0.5;
+// a ground surface is an overhang cell if the underside of another object is higher
+// than this above it
+const double MIN_OVERHANG_CLEARANCE = 0.05;
+const int MAX_NUM_CELLS = 4 * 1024 * 1024;
+
+struct NodeCenterLess
+{
+	NodeCenterLess(int axis) :
+			axis_(axis)
+	{
+	}
+	template<typename T>
+	bool operator()(const T& a, const T& b) const
+	{
+		return a.min_(axis_) + a.max_(axis_) < b.min_(axis_) + b.max_(axis_);
+	}
+	int axis_;
+};
+}
+
+GroundHeightmap::GroundHeightmap() :
+		resolution_(0.0), num_overhang_cells_(0), root_(-1)
+{
+	origin_[0] = origin_[1] = 0.0;
+	size_[0] = size_[1] = 0;
+}
+
+GroundHeightmap::~GroundHeightmap()
+{
+}
+
+void GroundHeightmap::build(const collision_detection::World& world, double resolution)
+{
+	cells_.clear();
+	triangles_.clear();
+	nodes_.clear();
+	root_ = -1;
+	size_[0] = size_[1] = 0;
+	num_overhang_cells_ = 0;
+	resolution_ = resolution;
+
+	for (collision_detection::World::const_iterator it = world.begin(); it != world.end(); ++it)
+	{
+		const collision_detection::World::Object& object = *it->second;
+		for (int i = 0; i < object.shapes_.size(); ++i)
+		{
+			const shapes::Shape* shape = object.shapes_[i].get();
+			const shapes::Mesh* mesh = dynamic_cast<const shapes::Mesh*>(shape);
+			if (mesh != NULL)
+			{
+				addTriangles(*mesh, object.shape_poses_[i]);
+				continue;
+			}
+			if (shape->type == shapes::BOX || shape->type == shapes::SPHERE || shape->type == shapes::CYLINDER
+					|| shape->type == shapes::CONE)
+			{
+				boost::scoped_ptr<shapes::Mesh> shape_mesh(shapes::createMeshFromShape(shape));
+				if (shape_mesh)
+					addTriangles(*shape_mesh, object.shape_poses_[i]);
+			}
+		}
+	}
+	if (triangles_.empty())
+		return;
+
+	std::vector<Node> leaves(triangles_.size());
+	for (int i = 0; i < triangles_.size(); ++i)
+	{
+		const Triangle& triangle = triangles_[i];
+		leaves[i].min_ = triangle.vertices_[0].cwiseMin(triangle.vertices_[1]).cwiseMin(triangle.vertices_[2]);
+		leaves[i].max_ = triangle.vertices_[0].cwiseMax(triangle.vertices_[1]).cwiseMax(triangle.vertices_[2]);
+		leaves[i].left_ = leaves[i].right_ = -1;
+		leaves[i].triangle_ = i;
+	}
+	nodes_.reserve(2 * leaves.size());
+	root_ = buildNode(leaves, 0, leaves.size());
+
+	rasterize(MIN_OVERHANG_CLEARANCE);
+
+	ROS_INFO("Ground heightmap of %d triangles : %d x %d cells (resolution %f), %d overhang cells",
+			(int) triangles_.size(), size_[0], size_[1], resolution_, num_overhang_cells_);
+}
+
+void GroundHeightmap::addTriangles(const shapes::Mesh& mesh, const Eigen::Affine3d& pose)
+{
+	for (unsigned int k = 0; k < mesh.triangle_count; ++k)
+	{
+		Triangle triangle;
+		for (int v = 0; v < 3; ++v)
+		{
+			unsigned int vertex = mesh.triangles[3 * k + v];
+			triangle.vertices_[v] = pose
+					* Eigen::Vector3d(mesh.vertices[3 * vertex], mesh.vertices[3 * vertex + 1],
+							mesh.vertices[3 * vertex + 2]);
+		}
+		Eigen::Vector3d normal = (triangle.vertices_[1] - triangle.vertices_[0]).cross(
+				triangle.vertices_[2] - triangle.vertices_[0]);
+		double area = normal.norm();
+		if (area < 1e-12)
+			continue;
+		normal /= area;
+		// keep the orientation of the mesh normals if it has them
+		if (mesh.triangle_normals != NULL)
+		{
+			Eigen::Vector3d mesh_normal = pose.rotation()
+					* Eigen::Vector3d(mesh.triangle_normals[3 * k], mesh.triangle_normals[3 * k + 1],
+							mesh.triangle_normals[3 * k + 2]);
+			if (normal.dot(mesh_normal) < 0.0)
+				normal = -normal;
+		}
+		triangle.normal_ = normal;
+		triangles_.push_back(triangle);
+	}
+}
+
+void GroundHeightmap::rasterize(double min_overhang_clearance)
+{
+	// the grid covers the ground triangles
+	double min_corner[2], max_corner[2];
+	bool has_ground = false;
+	for (int i = 0; i < triangles_.size(); ++i)
+	{
+		const Triangle& triangle = triangles_[i];
+		if (triangle.normal_.z() < MIN_GROUND_NORMAL_Z)
+			continue;
+		for (int v = 0; v < 3; ++v)
+		{
+			for (int d = 0; d < 2; ++d)
+			{
+				if (!has_ground)
+					min_corner[d] = max_corner[d] = triangle.vertices_[v](d);
+				min_corner[d] = std::min(min_corner[d], triangle.vertices_[v](d));
+				max_corner[d] = std::max(max_corner[d], triangle.vertices_[v](d));
+			}
+			has_ground = true;
+		}
+	}
+	if (!has_ground)
+		return;
+
+	double num_cells = (std::ceil((max_corner[0] - min_corner[0]) / resolution_) + 1)
+			* (std::ceil((max_corner[1] - min_corner[1]) / resolution_) + 1);
+	if (num_cells > MAX_NUM_CELLS)
+	{
+		double resolution = resolution_ * std::sqrt(num_cells / MAX_NUM_CELLS) * 1.01;
+		ROS_WARN("Ground heightmap resolution %f needs %.0f cells. Using %f", resolution_, num_cells, resolution);
+		resolution_ = resolution;
+	}
+	for (int d = 0; d < 2; ++d)
+	{
+		origin_[d] = min_corner[d];
+		size_[d] = (int) std::ceil((max_corner[d] - min_corner[d]) / resolution_) + 1;
+	}
+
+	const int num_grid_cells = size_[0] * size_[1];
+	const double infinity = std::numeric_limits<double>::infinity();
+	std::vector<double> top_heights(num_grid_cells, -infinity);
+	std::vector<double> min_ground_heights(num_grid_cells, infinity);
+	std::vector<double> max_underside_heights(num_grid_cells, -infinity);
+	Cell empty_cell;
+	empty_cell.normal_[0] = empty_cell.normal_[1] = 0.0f;
+	empty_cell.normal_[2] = 1.0f;
+	empty_cell.offset_ = 0.0f;
+	empty_cell.type_ = CELL_EMPTY;
+	cells_.assign(num_grid_cells, empty_cell);
+
+	for (int t = 0; t < triangles_.size(); ++t)
+	{
+		const Triangle& triangle = triangles_[t];
+		const Eigen::Vector3d& n = triangle.normal_;
+		bool is_ground = (n.z() >= MIN_GROUND_NORMAL_Z);
+		bool is_underside = (n.z() < -1e-3);
+		if (!is_ground && !is_underside)
+			continue;
+
+		const Eigen::Vector3d* v = triangle.vertices_;
+		double offset = n.dot(v[0]);
+		int begin[2], end[2];
+		for (int d = 0; d < 2; ++d)
+		{
+			double lo = std::min(std::min(v[0](d), v[1](d)), v[2](d));
+			double hi = std::max(std::max(v[0](d), v[1](d)), v[2](d));
+			begin[d] = std::max(0, (int) std::ceil((lo - origin_[d]) / resolution_ - 1e-6));
+			end[d] = std::min(size_[d] - 1, (int) std::floor((hi - origin_[d]) / resolution_ + 1e-6));
+		}
+
+		// signed doubled area of the xy projection, for the barycentric test
+		double area = (v[1].x() - v[0].x()) * (v[2].y() - v[0].y())
+				- (v[2].x() - v[0].x()) * (v[1].y() - v[0].y());
+		if (std::abs(area) < 1e-12)
+			continue;
+		const double sign = (area > 0.0) ? 1.0 : -1.0;
+		const double tolerance = -1e-9 * std::abs(area);
+
+		for (int i = begin[0]; i <= end[0]; ++i)
+		{
+			double x = origin_[0] + i * resolution_;
+			for (int j = begin[1]; j <= end[1]; ++j)
+			{
+				double y = origin_[1] + j * resolution_;
+				double w0 = sign * ((v[1].x() - x) * (v[2].y() - y) - (v[2].x() - x) * (v[1].y() - y));
+				double w1 = sign * ((v[2].x() - x) * (v[0].y() - y) - (v[0].x() - x) * (v[2].y() - y));
+				double w2 = sign * ((v[0].x() - x) * (v[1].y() - y) - (v[1].x() - x) * (v[0].y() - y));
+				if (w0 < tolerance || w1 < tolerance || w2 < tolerance)
+					continue;
+
+				double z = (offset - n.x() * x - n.y() * y) / n.z();
+				int index = i * size_[1] + j;
+				if (is_underside)
+				{
+					max_underside_heights[index] = std::max(max_underside_heights[index], z);
+					continue;
+				}
+
+				min_ground_heights[index] = std::min(min_ground_heights[index], z);
+				if (z > top_heights[index])
+				{
+					top_heights[index] = z;
+					Cell& cell = cells_[index];
+					cell.normal_[0] = n.x();
+					cell.normal_[1] = n.y();
+					cell.normal_[2] = n.z();
+					cell.offset_ = offset;
+					cell.type_ = CELL_GROUND;
+				}
+			}
+		}
+	}
+
+	for (int index = 0; index < num_grid_cells; ++index)
+	{
+		if (cells_[index].type_ == CELL_GROUND
+				&& max_underside_heights[index] > min_ground_heights[index] + min_overhang_clearance)
+		{
+			cells_[index].type_ = CELL_OVERHANG;
+			++num_overhang_cells_;
+		}
+	}
+}
+
+bool GroundHeightmap::getNearestGroundPosition(const KDL::Vector& in, KDL::Vector& out, KDL::Vector& normal) const
+{
+	if (triangles_.empty())
+		return false;
+
+	int i = (int) std::floor((in.x() - origin_[0]) / resolution_ + 0.5);
+	int j = (int) std::floor((in.y() - origin_[1]) / resolution_ + 0.5);
+	if (i >= 0 && i < size_[0] && j >= 0 && j < size_[1])
+	{
+		const Cell& cell = cells_[i * size_[1] + j];
+		if (cell.type_ == CELL_GROUND)
+		{
+			normal = KDL::Vector(cell.normal_[0], cell.normal_[1], cell.normal_[2]);
+			double z = (cell.offset_ - cell.normal_[0] * in.x() - cell.normal_[1] * in.y()) / cell.normal_[2];
+			out = KDL::Vector(in.x(), in.y(), z);
+			return true;
+		}
+	}
+
+	Eigen::Vector3d point(in.x(), in.y(), in.z());
+	double best_squared_distance = std::numeric_limits<double>::infinity();
+	Eigen::Vector3d best_position = point;
+	int best_triangle = -1;
+	findNearestTriangle(root_, point, best_squared_distance, best_position, best_triangle);
+
+	const Eigen::Vector3d& n = triangles_[best_triangle].normal_;
+	normal = KDL::Vector(n.x(), n.y(), n.z());
+	out = KDL::Vector(best_position.x(), best_position.y(), best_position.z());
+	return true;
+}
+
+int GroundHeightmap::buildNode(std::vector<Node>& leaves, int begin, int end)
+{
+	if (end - begin == 1)
+	{
+		nodes_.push_back(leaves[begin]);
+		return nodes_.size() - 1;
+	}
+
+	Node node;
+	node.min_ = leaves[begin].min_;
+	node.max_ = leaves[begin].max_;
+	for (int i = begin + 1; i < end; ++i)
+	{
+		node.min_ = node.min_.cwiseMin(leaves[i].min_);
+		node.max_ = node.max_.cwiseMax(leaves[i].max_);
+	}
+
+	// median split along the longest axis of the box
+	int axis;
+	(node.max_ - node.min_).maxCoeff(&axis);
+	int mid = (begin + end) / 2;
+	std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, NodeCenterLess(axis));
+
+	int index = nodes_.size();
+	node.triangle_ = -1;
+	nodes_.push_back(node);
+	int left = buildNode(leaves, begin, mid);
+	int right = buildNode(leaves, mid, end);
+	nodes_[index].left_ = left;
+	nodes_[index].right_ = right;
+	return index;
+}
+
+void GroundHeightmap::findNearestTriangle(int node, const Eigen::Vector3d& point, double& best_squared_distance,
+		Eigen::Vector3d& best_position, int& best_triangle) const
+{
+	const Node& n = nodes_[node];
+	if (n.triangle_ >= 0)
+	{
+		const Triangle& triangle = triangles_[n.triangle_];
+		Eigen::Vector3d projection = ProjPoint2Triangle(triangle.vertices_[0], triangle.vertices_[1],
+				triangle.vertices_[2], point);
+		double squared_distance = (projection - point).squaredNorm();
+		if (squared_distance < best_squared_distance)
+		{
+			best_squared_distance = squared_distance;
+			best_position = projection;
+			best_triangle = n.triangle_;
+		}
+		return;
+	}
+
+	// visit the nearer child first
+	double left_distance = getSquaredDistance(nodes_[n.left_], point);
+	double right_distance = getSquaredDistance(nodes_[n.right_], point);
+	int first = n.left_, second = n.right_;
+	if (right_distance < left_distance)
+	{
+		std::swap(first, second);
+		std::swap(left_distance, right_distance);
+	}
+	if (left_distance < best_squared_distance)
+		findNearestTriangle(first, point, best_squared_distance, best_position, best_triangle);
+	if (right_distance < best_squared_distance)
+		findNearestTriangle(second, point, best_squared_distance, best_position, best_triangle);
+}
+
+double GroundHeightmap::getSquaredDistance(const Node& node, const Eigen::Vector3d& point)
+{
+	Eigen::Vector3d diff = (node.min_ - point).cwiseMax(point - node.max_).cwiseMax(Eigen::Vector3d::Zero());
+	return diff.squaredNorm();
+}
+
+}
@@ -38,6 +38,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/contact/ground_manager.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
 #include <itomp_ca_planner/util/point_to_triangle_projection.h>
+#include <itomp_ca_planner/collision/signed_distance_field.h>
 #include <limits>
 
 namespace itomp_ca_planner
@@ -45,7 +46,8 @@ namespace itomp_ca_planner
 
 GroundManager GroundManager::instance_;
 
-GroundManager::GroundManager()
+GroundManager::GroundManager() :
+    use_heightmap_(false), world_hash_(0), heightmap_resolution_(0.0)
 {
 }
 
@@ -53,8 +55,21 @@ GroundManager::~GroundManager()
 {
 }
 
-void GroundManager::init()
+void GroundManager::init(const planning_scene::PlanningSceneConstPtr& planning_scene)
 {
+  use_heightmap_ = PlanningParameters::getInstance()->getUseGroundHeightmap();
+  if (!use_heightmap_)
+    return;
+
+  const collision_detection::World& world = *planning_scene->getWorld();
+  std::size_t world_hash = SignedDistanceFieldCache::computeWorldHash(world);
+  double resolution = PlanningParameters::getInstance()->getGroundHeightmapResolution();
+  if (world_hash != world_hash_ || resolution != heightmap_resolution_)
+  {
+    heightmap_.build(world, resolution);
+    world_hash_ = world_hash;
+    heightmap_resolution_ = resolution;
+  }
 }
 
 double interpolateSqrt(double x, double x1, double x2, double y1, double y2)
@@ -67,6 +82,10 @@ double interpolateSqrt(double x, double x1, double x2, double y1, double y2)
 void GroundManager::getNearestGroundPosition(const KDL::Vector& in, KDL::Vector& out, KDL::Vector& normal,
     const planning_scene::PlanningSceneConstPtr& planning_scene) const
 {
+  // the terrain table below is used if the world has no meshes
+  if (use_heightmap_ && heightmap_.getNearestGroundPosition(in, out, normal))
+    return;
+
   const double FOOT_FRONT = 0.2;
   const double FOOT_REAR = 0.2; //0.05;
   const double MARGIN = 0.1;
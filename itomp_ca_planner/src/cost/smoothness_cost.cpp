@@ -37,7 +37,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 */
 #include <itomp_ca_planner/cost/smoothness_cost.h>
 #include <itomp_ca_planner/util/differentiation_rules.h>
-#include <Eigen/LU>
+#include <itomp_ca_planner/util/banded_cholesky.h>
 
 using namespace std;
 using namespace Eigen;
@@ -46,58 +46,66 @@ namespace itomp_ca_planner
 {
 
 SmoothnessCost::SmoothnessCost(const ItompCIOTrajectory& trajectory, int joint_number,
-    const std::vector<double>& derivative_costs, double ridge_factor)
+    const std::vector<double>& derivative_costs, double ridge_factor) :
+    ridge_factor_(ridge_factor), scale_(1.0), max_quad_cost_inv_value_(0.0)
 {
   int num_vars_all = trajectory.getNumPoints();
   int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
-  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
-  quad_cost_full_ = MatrixXd::Zero(num_vars_all, num_vars_all);
 
-  // construct the quad cost for all variables, as a sum of squared differentiation matrices
+  // the quad cost for all variables is a sum of squared differentiation rules
   double multiplier = 1.0;
+  diff_rule_weights_.resize(derivative_costs.size());
   for (unsigned int i = 0; i < derivative_costs.size(); i++)
   {
     multiplier *= trajectory.getDiscretization();
-    diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
-    quad_cost_full_ += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+    diff_rule_weights_[i] = derivative_costs[i] * multiplier;
   }
-  quad_cost_full_ += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
 
-  // extract the quad cost just for the free variables:
-  quad_cost_ = quad_cost_full_.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
-
-  // invert the matrix:
-  quad_cost_inv_ = quad_cost_.inverse();
+  // the largest element of the inverse of the quad cost of the free variables,
+  // one banded solve per column
+  if (num_vars_free <= 0)
+    return;
+  MatrixXd quad_cost_band = MatrixXd::Zero(DIFF_RULE_LENGTH, num_vars_free);
+  quad_cost_band.row(0).setConstant(ridge_factor);
+  for (unsigned int i = 0; i < diff_rule_weights_.size(); i++)
+    addDiffRuleGramBand(DIFF_RULES[i], diff_rule_weights_[i], num_vars_all, DIFF_RULE_LENGTH - 1, quad_cost_band);
+
+  BandedCholesky quad_cost_cholesky;
+  if (!quad_cost_cholesky.compute(quad_cost_band))
+    return;
+  VectorXd column(num_vars_free);
+  for (int p = 0; p < num_vars_free; ++p)
+  {
+    column.setZero();
+    column(p) = 1.0;
+    quad_cost_cholesky.solveInPlace(column);
+    max_quad_cost_inv_value_ = std::max(max_quad_cost_inv_value_, column.maxCoeff());
+  }
 }
 
-Eigen::MatrixXd SmoothnessCost::getDiffMatrix(int size, const double* diff_rule) const
+void SmoothnessCost::computeGradient(const Eigen::VectorXd& joint_trajectory, Eigen::VectorXd& gradient) const
 {
-  MatrixXd matrix = MatrixXd::Zero(size, size);
-  for (int i = 0; i < size; i++)
+  int num_vars_all = joint_trajectory.rows();
+  VectorXd derivative(num_vars_all);
+  VectorXd derivative_gradient(num_vars_all);
+
+  // 2 * Q * x
+  gradient = (2.0 * ridge_factor_) * joint_trajectory;
+  for (unsigned int i = 0; i < diff_rule_weights_.size(); ++i)
   {
-    if (i - DIFF_RULE_LENGTH / 2 < 0 || i + DIFF_RULE_LENGTH / 2 >= size)
+    if (diff_rule_weights_[i] == 0.0)
       continue;
-
-    for (int j = -DIFF_RULE_LENGTH / 2; j <= DIFF_RULE_LENGTH / 2; j++)
-    {
-      int index = i + j;
-      matrix(i, index) = diff_rule[j + DIFF_RULE_LENGTH / 2];
-    }
+    applyDiffRule(DIFF_RULES[i], joint_trajectory, derivative);
+    applyDiffRuleTranspose(DIFF_RULES[i], derivative, derivative_gradient);
+    gradient += (2.0 * diff_rule_weights_[i]) * derivative_gradient;
   }
-  return matrix;
-}
-
-double SmoothnessCost::getMaxQuadCostInvValue() const
-{
-  return quad_cost_inv_.maxCoeff();
+  gradient *= scale_;
 }
 
 void SmoothnessCost::scale(double scale)
 {
-  double inv_scale = 1.0 / scale;
-  quad_cost_inv_ *= inv_scale;
-  quad_cost_ *= scale;
-  quad_cost_full_ *= scale;
+  scale_ *= scale;
+  max_quad_cost_inv_value_ /= scale;
 }
 
 SmoothnessCost::~SmoothnessCost()
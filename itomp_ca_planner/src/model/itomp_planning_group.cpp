@@ -48,4 +48,12 @@ std::vector<std::string> ItompPlanningGroup::getJointNames() const
 	return ret;
 }
 
+int ItompPlanningGroup::getRigidBodyIndex(int segment_index) const
+{
+	// if the reference frame moves, so do all segments
+	if (!fk_solver_->isPartialFKAvailable())
+		return segment_index;
+	return fk_solver_->getRigidBodyIndex(segment_index);
+}
+
 }
@@ -198,6 +198,9 @@ bool ItompRobotModel::init(robot_model::RobotModelPtr& robot_model, const std::s
     }
     group.fk_solver_.reset(
         new KDL::TreeFkSolverJointPosAxisPartial(kdl_tree_, robot_model_->getRootLinkName(), active_joints));
+    group.batch_fk_solver_.reset(
+        new KDL::TreeFkSolverJointPosAxisBatch(kdl_tree_, robot_model_->getRootLinkName()));
+    group.batch_fk_solver_->setPartialEvaluationOrder(group.fk_solver_->getSegmentEvaluationOrder());
 
     for (int i = 0; i < group.num_joints_; i++)
     {
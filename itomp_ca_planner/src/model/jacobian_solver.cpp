@@ -0,0 +1,213 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/model/jacobian_solver.h>
+#include <itomp_ca_planner/model/itomp_robot_model.h>
+#include <ros/ros.h>
+#include <Eigen/Jacobi>
+
+namespace itomp_ca_planner
+{
+
+JacobianSolver::JacobianSolver() :
+		num_entries_(0)
+{
+}
+
+JacobianSolver::~JacobianSolver()
+{
+}
+
+void JacobianSolver::clear()
+{
+	groups_.clear();
+	num_entries_ = 0;
+}
+
+int JacobianSolver::addGroup(const ItompRobotModel* robot_model, const std::string& group_name)
+{
+	int index = getGroupIndex(group_name);
+	if (index != -1)
+		return index;
+
+	robot_model::RobotModelConstPtr moveit_robot_model = robot_model->getRobotModel();
+	if (!moveit_robot_model->hasJointModelGroup(group_name))
+		return -1;
+	const robot_model::JointModelGroup* joint_model_group = moveit_robot_model->getJointModelGroup(group_name);
+	if (joint_model_group->getLinkModels().empty())
+		return -1;
+
+	const std::string& tip_link_name = joint_model_group->getLinkModels().back()->getName();
+	JacobianGroup group;
+	group.name_ = group_name;
+	group.tip_segment_ = robot_model->getForwardKinematicsSolver()->segmentNameToIndex(tip_link_name);
+	group.num_columns_ = joint_model_group->getVariableCount();
+	group.offset_ = num_entries_;
+
+	// the joints of the group between the tip link and the root
+	const KDL::Tree* tree = robot_model->getKDLTree();
+	KDL::SegmentMap::const_iterator it = tree->getSegment(tip_link_name);
+	if (it == tree->getSegments().end() || group.tip_segment_ < 0)
+	{
+		ROS_ERROR("Jacobian solver : tip link %s of group %s is not in the KDL tree", tip_link_name.c_str(),
+				group_name.c_str());
+		return -1;
+	}
+	for (; it != tree->getRootSegment(); it = it->second.parent)
+	{
+		const KDL::Joint& joint = it->second.segment.getJoint();
+		if (joint.getType() == KDL::Joint::None || !joint_model_group->hasJointModel(joint.getName()))
+			continue;
+
+		JacobianJoint jacobian_joint;
+		jacobian_joint.kdl_joint_ = it->second.q_nr;
+		jacobian_joint.column_ = joint_model_group->getVariableGroupIndex(joint.getName());
+		jacobian_joint.is_prismatic_ = (joint.getType() >= KDL::Joint::TransAxis);
+		group.joints_.push_back(jacobian_joint);
+	}
+
+	groups_.push_back(group);
+	num_entries_ += 6 * group.num_columns_;
+	return groups_.size() - 1;
+}
+
+int JacobianSolver::getGroupIndex(const std::string& group_name) const
+{
+	for (int i = 0; i < groups_.size(); ++i)
+	{
+		if (groups_[i].name_ == group_name)
+			return i;
+	}
+	return -1;
+}
+
+void JacobianSolver::computeJacobians(int begin, int end, const ArenaArray2D<KDL::Vector>& joint_pos,
+		const ArenaArray2D<KDL::Vector>& joint_axis, const ArenaArray2D<KDL::Frame>& segment_frames,
+		ArenaArray2D<double>& jacobians) const
+{
+	for (int point = begin; point < end; ++point)
+	{
+		ArenaArray<double>& row = jacobians[point];
+		std::fill(row.data(), row.data() + num_entries_, 0.0);
+
+		for (int g = 0; g < groups_.size(); ++g)
+		{
+			const JacobianGroup& group = groups_[g];
+			const KDL::Vector& tip_position = segment_frames[point][group.tip_segment_].p;
+			for (int j = 0; j < group.joints_.size(); ++j)
+			{
+				const JacobianJoint& joint = group.joints_[j];
+				const KDL::Vector& axis = joint_axis[point][joint.kdl_joint_];
+				double* column = row.data() + group.offset_ + 6 * joint.column_;
+				if (joint.is_prismatic_)
+				{
+					column[0] = axis.x();
+					column[1] = axis.y();
+					column[2] = axis.z();
+				}
+				else
+				{
+					KDL::Vector linear = axis * (tip_position - joint_pos[point][joint.kdl_joint_]);
+					column[0] = linear.x();
+					column[1] = linear.y();
+					column[2] = linear.z();
+					column[3] = axis.x();
+					column[4] = axis.y();
+					column[5] = axis.z();
+				}
+			}
+		}
+	}
+}
+
+double JacobianSolver::computeMinSingularValue(const ConstJacobian& jacobian, EigenBasis& basis)
+{
+	const int MAX_SWEEPS = 10;
+	const double TOLERANCE = 1e-12;
+
+	EigenBasis gram;
+	int dimension;
+	if (jacobian.cols() >= 6)
+	{
+		dimension = 6;
+		gram.noalias() = jacobian * jacobian.transpose();
+	}
+	else
+	{
+		dimension = jacobian.cols();
+		gram.setIdentity();
+		gram.topLeftCorner(dimension, dimension).noalias() = jacobian.transpose() * jacobian;
+	}
+	if (dimension == 0)
+		return 0.0;
+
+	if (basis.isZero())
+		basis.setIdentity();
+
+	// rotate into the previous eigenbasis, then sweep until the off-diagonal part vanishes
+	EigenBasis diagonal = basis.transpose() * gram * basis;
+	double scale = diagonal.diagonal().head(dimension).cwiseAbs().sum();
+	for (int sweep = 0; sweep < MAX_SWEEPS; ++sweep)
+	{
+		double off_diagonal = 0.0;
+		for (int p = 0; p < dimension; ++p)
+			for (int q = p + 1; q < dimension; ++q)
+				off_diagonal += diagonal(p, q) * diagonal(p, q);
+		if (off_diagonal <= TOLERANCE * TOLERANCE * scale * scale)
+			break;
+
+		for (int p = 0; p < dimension; ++p)
+		{
+			for (int q = p + 1; q < dimension; ++q)
+			{
+				if (diagonal(p, q) == 0.0)
+					continue;
+				Eigen::JacobiRotation<double> rotation;
+				rotation.makeJacobi(diagonal, p, q);
+				diagonal.applyOnTheLeft(p, q, rotation.adjoint());
+				diagonal.applyOnTheRight(p, q, rotation);
+				basis.applyOnTheRight(p, q, rotation);
+			}
+		}
+	}
+
+	double min_eigenvalue = diagonal.diagonal().head(dimension).minCoeff();
+	return std::sqrt(std::max(min_eigenvalue, 0.0));
+}
+
+}
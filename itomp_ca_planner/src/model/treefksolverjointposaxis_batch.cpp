@@ -0,0 +1,427 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2009, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Willow Garage nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <itomp_ca_planner/model/treefksolverjointposaxis_batch.hpp>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+// the component loops over waypoints are independent; let the compiler vectorize them
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define BATCH_FK_SIMD _Pragma("omp simd")
+#else
+#define BATCH_FK_SIMD
+#endif
+
+namespace KDL
+{
+
+TreeFkSolverJointPosAxisBatch::TreeFkSolverJointPosAxisBatch(const Tree& tree,
+		const std::string& reference_frame) :
+	num_joints_(tree.getNrOfJoints()), num_segments_(0), reference_frame_(
+			reference_frame), reference_frame_index_(-1), capacity_(0)
+{
+	// count the segments, then fill the tables in a second pass. Segments are
+	// numbered depth-first, the same way as TreeFkSolverJointPosAxisPartial does.
+	num_segments_ = flattenTree(tree.getRootSegment(), 0, -1);
+
+	segment_parent_.resize(num_segments_);
+	segment_q_nr_.resize(num_segments_);
+	segment_joint_kind_.resize(num_segments_);
+	segment_joint_scale_.resize(num_segments_);
+	segment_joint_axis_.resize(3 * num_segments_);
+	segment_joint_origin_.resize(3 * num_segments_);
+	segment_pose_zero_.resize(12 * num_segments_);
+	flattenTree(tree.getRootSegment(), 0, -1);
+
+	if (reference_frame_index_ < 0)
+	{
+		cout << "TreeFkSolverJointPosAxisBatch: Reference frame "
+				<< reference_frame
+				<< " could not be found! Forward kinematics will be performed in world frame.";
+		reference_frame_index_ = 0;
+	}
+}
+
+TreeFkSolverJointPosAxisBatch::~TreeFkSolverJointPosAxisBatch()
+{
+}
+
+int TreeFkSolverJointPosAxisBatch::flattenTree(
+		const SegmentMap::const_iterator this_segment, int segment_nr,
+		int parent_segment_nr)
+{
+	if (!segment_parent_.empty())
+	{
+		const Segment& segment = this_segment->second.segment;
+		const Joint& joint = segment.getJoint();
+
+		if (this_segment->first == reference_frame_)
+			reference_frame_index_ = segment_nr;
+
+		segment_parent_[segment_nr] = parent_segment_nr;
+		segment_q_nr_[segment_nr] = -1;
+		segment_joint_kind_[segment_nr] = JOINT_KIND_FIXED;
+		segment_joint_scale_[segment_nr] = 0.0;
+
+		Frame pose_zero = segment.pose(0.0);
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+				segment_pose_zero_[12 * segment_nr + 3 * r + c] = pose_zero.M(r, c);
+			segment_pose_zero_[12 * segment_nr + 9 + r] = pose_zero.p(r);
+		}
+
+		if (joint.getType() != Joint::None)
+		{
+			Vector axis = joint.JointAxis();
+			Vector origin = joint.JointOrigin();
+			for (int r = 0; r < 3; ++r)
+			{
+				segment_joint_axis_[3 * segment_nr + r] = axis(r);
+				segment_joint_origin_[3 * segment_nr + r] = origin(r);
+			}
+			segment_q_nr_[segment_nr] = this_segment->second.q_nr;
+
+			// pose(q) = J(scale * q) * pose(0), where J rotates about (or translates along)
+			// the joint axis. The scale is recovered from a unit joint displacement.
+			Frame pose_one = segment.pose(1.0);
+			if (joint.getType() <= Joint::RotZ)
+			{
+				segment_joint_kind_[segment_nr] = JOINT_KIND_ROTATIONAL;
+				segment_joint_scale_[segment_nr] = dot(
+						(pose_one.M * pose_zero.M.Inverse()).GetRot(), axis);
+			}
+			else
+			{
+				segment_joint_kind_[segment_nr] = JOINT_KIND_TRANSLATIONAL;
+				segment_joint_scale_[segment_nr] = dot(pose_one.p - pose_zero.p,
+						axis);
+			}
+		}
+	}
+
+	int par_seg_nr = segment_nr;
+	segment_nr++;
+
+	for (vector<SegmentMap::const_iterator>::const_iterator child =
+			this_segment->second.children.begin(); child
+			!= this_segment->second.children.end(); child++)
+		segment_nr = flattenTree(*child, segment_nr, par_seg_nr);
+	return segment_nr;
+}
+
+void TreeFkSolverJointPosAxisBatch::reserve(int num_points)
+{
+	if (num_points <= capacity_)
+		return;
+	capacity_ = num_points;
+	q_.resize(num_joints_ * capacity_);
+	frames_.resize(12 * num_segments_ * capacity_);
+}
+
+void TreeFkSolverJointPosAxisBatch::setPartialEvaluationOrder(
+		const std::vector<int>& segment_order)
+{
+	partial_segment_order_ = segment_order;
+
+	// parents outside the evaluation order are read back from the previous result
+	std::vector<bool> evaluated(num_segments_, false);
+	for (size_t i = 0; i < segment_order.size(); ++i)
+		evaluated[segment_order[i]] = true;
+	std::vector<bool> seeded(num_segments_, false);
+	partial_seed_segments_.clear();
+	for (size_t i = 0; i < segment_order.size(); ++i)
+	{
+		const int parent = segment_parent_[segment_order[i]];
+		if (parent >= 0 && !evaluated[parent] && !seeded[parent])
+		{
+			seeded[parent] = true;
+			partial_seed_segments_.push_back(parent);
+		}
+	}
+}
+
+void TreeFkSolverJointPosAxisBatch::gatherJointValues(const Eigen::MatrixXd& q,
+		const std::vector<int>& rows)
+{
+	const int num_points = rows.size();
+	const int stride = capacity_;
+
+	// gather the joint values joint-major so each joint is contiguous over waypoints
+	for (int j = 0; j < num_joints_; ++j)
+	{
+		double* q_j = &q_[j * stride];
+		for (int n = 0; n < num_points; ++n)
+			q_j[n] = q(rows[n], j);
+	}
+}
+
+void TreeFkSolverJointPosAxisBatch::computeSegment(int s, int num_points,
+		Vector* joint_pos, Vector* joint_axis)
+{
+	const int stride = capacity_;
+	double* w = &frames_[12 * s * stride];
+	const double* l0 = &segment_pose_zero_[12 * s];
+
+	// local pose of the segment, stored in its own slots
+	switch (segment_joint_kind_[s])
+	{
+	case JOINT_KIND_FIXED:
+		for (int k = 0; k < 12; ++k)
+		{
+			double* w_k = w + k * stride;
+			const double v = l0[k];
+			BATCH_FK_SIMD
+			for (int n = 0; n < num_points; ++n)
+				w_k[n] = v;
+		}
+		break;
+
+	case JOINT_KIND_ROTATIONAL:
+	{
+		const double* q_s = &q_[segment_q_nr_[s] * stride];
+		const double scale = segment_joint_scale_[s];
+		const double ax = segment_joint_axis_[3 * s];
+		const double ay = segment_joint_axis_[3 * s + 1];
+		const double az = segment_joint_axis_[3 * s + 2];
+		const double ox = segment_joint_origin_[3 * s];
+		const double oy = segment_joint_origin_[3 * s + 1];
+		const double oz = segment_joint_origin_[3 * s + 2];
+		const double px = l0[9] - ox, py = l0[10] - oy, pz = l0[11] - oz;
+		BATCH_FK_SIMD
+		for (int n = 0; n < num_points; ++n)
+		{
+			// Rodrigues' formula for the rotation about the joint axis
+			const double theta = scale * q_s[n];
+			const double c = cos(theta);
+			const double si = sin(theta);
+			const double t = 1.0 - c;
+			const double r00 = t * ax * ax + c;
+			const double r01 = t * ax * ay - si * az;
+			const double r02 = t * ax * az + si * ay;
+			const double r10 = t * ax * ay + si * az;
+			const double r11 = t * ay * ay + c;
+			const double r12 = t * ay * az - si * ax;
+			const double r20 = t * ax * az - si * ay;
+			const double r21 = t * ay * az + si * ax;
+			const double r22 = t * az * az + c;
+
+			w[0 * stride + n] = r00 * l0[0] + r01 * l0[3] + r02 * l0[6];
+			w[1 * stride + n] = r00 * l0[1] + r01 * l0[4] + r02 * l0[7];
+			w[2 * stride + n] = r00 * l0[2] + r01 * l0[5] + r02 * l0[8];
+			w[3 * stride + n] = r10 * l0[0] + r11 * l0[3] + r12 * l0[6];
+			w[4 * stride + n] = r10 * l0[1] + r11 * l0[4] + r12 * l0[7];
+			w[5 * stride + n] = r10 * l0[2] + r11 * l0[5] + r12 * l0[8];
+			w[6 * stride + n] = r20 * l0[0] + r21 * l0[3] + r22 * l0[6];
+			w[7 * stride + n] = r20 * l0[1] + r21 * l0[4] + r22 * l0[7];
+			w[8 * stride + n] = r20 * l0[2] + r21 * l0[5] + r22 * l0[8];
+			w[9 * stride + n] = r00 * px + r01 * py + r02 * pz + ox;
+			w[10 * stride + n] = r10 * px + r11 * py + r12 * pz + oy;
+			w[11 * stride + n] = r20 * px + r21 * py + r22 * pz + oz;
+		}
+		break;
+	}
+
+	case JOINT_KIND_TRANSLATIONAL:
+	{
+		const double* q_s = &q_[segment_q_nr_[s] * stride];
+		const double scale = segment_joint_scale_[s];
+		for (int k = 0; k < 9; ++k)
+		{
+			double* w_k = w + k * stride;
+			const double v = l0[k];
+			BATCH_FK_SIMD
+			for (int n = 0; n < num_points; ++n)
+				w_k[n] = v;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			double* w_k = w + (9 + k) * stride;
+			const double v = l0[9 + k];
+			const double a = scale * segment_joint_axis_[3 * s + k];
+			BATCH_FK_SIMD
+			for (int n = 0; n < num_points; ++n)
+				w_k[n] = v + a * q_s[n];
+		}
+		break;
+	}
+	}
+
+	const int parent = segment_parent_[s];
+	if (parent < 0)
+		return;
+
+	// joint position and axis are expressed in the parent frame
+	const double* p = &frames_[12 * parent * stride];
+	const int q_nr = segment_q_nr_[s];
+	if (q_nr >= 0)
+	{
+		const Vector axis(segment_joint_axis_[3 * s], segment_joint_axis_[3 * s + 1], segment_joint_axis_[3 * s + 2]);
+		const Vector origin(segment_joint_origin_[3 * s], segment_joint_origin_[3 * s + 1], segment_joint_origin_[3 * s + 2]);
+		for (int n = 0; n < num_points; ++n)
+		{
+			const Rotation rot(p[0 * stride + n], p[1 * stride + n], p[2 * stride + n],
+					p[3 * stride + n], p[4 * stride + n], p[5 * stride + n],
+					p[6 * stride + n], p[7 * stride + n], p[8 * stride + n]);
+			const Vector pos(p[9 * stride + n], p[10 * stride + n], p[11 * stride + n]);
+			joint_pos[n * num_joints_ + q_nr] = rot * origin + pos;
+			joint_axis[n * num_joints_ + q_nr] = rot * axis;
+		}
+	}
+
+	// world = parent * local
+	BATCH_FK_SIMD
+	for (int n = 0; n < num_points; ++n)
+	{
+		const double l[12] =
+		{ w[0 * stride + n], w[1 * stride + n], w[2 * stride + n],
+				w[3 * stride + n], w[4 * stride + n], w[5 * stride + n],
+				w[6 * stride + n], w[7 * stride + n], w[8 * stride + n],
+				w[9 * stride + n], w[10 * stride + n], w[11 * stride + n] };
+		for (int r = 0; r < 3; ++r)
+		{
+			const double p0 = p[(3 * r) * stride + n];
+			const double p1 = p[(3 * r + 1) * stride + n];
+			const double p2 = p[(3 * r + 2) * stride + n];
+			w[(3 * r) * stride + n] = p0 * l[0] + p1 * l[3] + p2 * l[6];
+			w[(3 * r + 1) * stride + n] = p0 * l[1] + p1 * l[4] + p2 * l[7];
+			w[(3 * r + 2) * stride + n] = p0 * l[2] + p1 * l[5] + p2 * l[8];
+			w[(9 + r) * stride + n] = p0 * l[9] + p1 * l[10] + p2 * l[11]
+					+ p[(9 + r) * stride + n];
+		}
+	}
+}
+
+int TreeFkSolverJointPosAxisBatch::JntToCartBatch(const Eigen::MatrixXd& q,
+		const std::vector<int>& rows, Vector* joint_pos, Vector* joint_axis,
+		Frame* segment_frames)
+{
+	const int num_points = rows.size();
+	if (num_points == 0)
+		return 0;
+	reserve(num_points);
+	const int stride = capacity_;
+
+	gatherJointValues(q, rows);
+	for (int s = 0; s < num_segments_; ++s)
+		computeSegment(s, num_points, joint_pos, joint_axis);
+
+	// convert into the reference frame and scatter into the KDL outputs
+	const double* ref = &frames_[12 * reference_frame_index_ * stride];
+	for (int n = 0; n < num_points; ++n)
+	{
+		const Frame inv_ref_frame = Frame(
+				Rotation(ref[0 * stride + n], ref[1 * stride + n], ref[2 * stride + n],
+						ref[3 * stride + n], ref[4 * stride + n], ref[5 * stride + n],
+						ref[6 * stride + n], ref[7 * stride + n], ref[8 * stride + n]),
+				Vector(ref[9 * stride + n], ref[10 * stride + n], ref[11 * stride + n])).Inverse();
+
+		Frame* frames = segment_frames + n * num_segments_;
+		for (int s = 0; s < num_segments_; ++s)
+		{
+			const double* w = &frames_[12 * s * stride];
+			frames[s] = inv_ref_frame * Frame(
+					Rotation(w[0 * stride + n], w[1 * stride + n], w[2 * stride + n],
+							w[3 * stride + n], w[4 * stride + n], w[5 * stride + n],
+							w[6 * stride + n], w[7 * stride + n], w[8 * stride + n]),
+					Vector(w[9 * stride + n], w[10 * stride + n], w[11 * stride + n]));
+		}
+
+		Vector* pos = joint_pos + n * num_joints_;
+		Vector* axis = joint_axis + n * num_joints_;
+		for (int j = 0; j < num_joints_; ++j)
+		{
+			axis[j] = inv_ref_frame * axis[j];
+			pos[j] = inv_ref_frame * pos[j];
+		}
+	}
+
+	return 0;
+}
+
+int TreeFkSolverJointPosAxisBatch::JntToCartBatchPartial(
+		const Eigen::MatrixXd& q, const std::vector<int>& rows,
+		Vector* joint_pos, Vector* joint_axis, Frame* segment_frames)
+{
+	const int num_points = rows.size();
+	if (num_points == 0)
+		return 0;
+	reserve(num_points);
+	const int stride = capacity_;
+
+	gatherJointValues(q, rows);
+
+	// the reference frame does not move, so the previous frames can be chained
+	// in the reference frame directly
+	for (size_t i = 0; i < partial_seed_segments_.size(); ++i)
+	{
+		const int s = partial_seed_segments_[i];
+		double* w = &frames_[12 * s * stride];
+		for (int n = 0; n < num_points; ++n)
+		{
+			const Frame& frame = segment_frames[n * num_segments_ + s];
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int c = 0; c < 3; ++c)
+					w[(3 * r + c) * stride + n] = frame.M(r, c);
+				w[(9 + r) * stride + n] = frame.p(r);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < partial_segment_order_.size(); ++i)
+		computeSegment(partial_segment_order_[i], num_points, joint_pos,
+				joint_axis);
+
+	for (int n = 0; n < num_points; ++n)
+	{
+		Frame* frames = segment_frames + n * num_segments_;
+		for (size_t i = 0; i < partial_segment_order_.size(); ++i)
+		{
+			const int s = partial_segment_order_[i];
+			const double* w = &frames_[12 * s * stride];
+			frames[s] = Frame(
+					Rotation(w[0 * stride + n], w[1 * stride + n], w[2 * stride + n],
+							w[3 * stride + n], w[4 * stride + n], w[5 * stride + n],
+							w[6 * stride + n], w[7 * stride + n], w[8 * stride + n]),
+					Vector(w[9 * stride + n], w[10 * stride + n], w[11 * stride + n]));
+		}
+	}
+
+	return 0;
+}
+
+} // namespace KDL
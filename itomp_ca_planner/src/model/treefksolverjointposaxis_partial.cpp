@@ -45,7 +45,7 @@ namespace KDL
 TreeFkSolverJointPosAxisPartial::TreeFkSolverJointPosAxisPartial(
 		const Tree& tree, const std::string& reference_frame,
 		const std::vector<bool>& active_joints) :
-	tree_(tree), reference_frame_(reference_frame), active_joints_(
+	tree_(tree), reference_frame_(reference_frame), reference_frame_index_(0), active_joints_(
 			active_joints)
 {
 	segment_names_.clear();
@@ -64,14 +64,25 @@ TreeFkSolverJointPosAxisPartial::TreeFkSolverJointPosAxisPartial(
 	}
 	num_segments_ = segment_names_.size();
 	num_joints_ = tree_.getNrOfJoints();
-	segment_frames_.resize(num_segments_);
 	segment_parent_frame_nr_.resize(num_segments_);
 	segment_parent_.resize(num_segments_, NULL);
+	segment_rigid_body_.resize(num_segments_, -1);
 	joint_parent_frame_nr_.resize(num_joints_);
 	joint_parent_.resize(num_joints_, NULL);
 	segment_evaluation_order_.clear();
 	joint_calc_pos_axis_.clear();
 	joint_calc_pos_axis_.resize(num_joints_, false);
+
+	// flatten the subtree driven by the active joints once, in evaluation order
+	buildEvaluationOrder(tree_.getRootSegment(), 0, -1, false, -1);
+
+	// partial results are only valid in a reference frame which does not move
+	partial_fk_available_ = true;
+	for (size_t i = 0; i < segment_evaluation_order_.size(); ++i)
+	{
+		if (segment_evaluation_order_[i] == reference_frame_index_)
+			partial_fk_available_ = false;
+	}
 }
 
 TreeFkSolverJointPosAxisPartial::~TreeFkSolverJointPosAxisPartial()
@@ -80,17 +91,22 @@ TreeFkSolverJointPosAxisPartial::~TreeFkSolverJointPosAxisPartial()
 
 int TreeFkSolverJointPosAxisPartial::JntToCartFull(const JntArray& q_in,
 		std::vector<Vector>& joint_pos, std::vector<Vector>& joint_axis,
-		std::vector<Frame>& segment_frames)
+		std::vector<Frame>& segment_frames) const
 {
 	joint_pos.resize(num_joints_);
 	joint_axis.resize(num_joints_);
 	segment_frames.resize(num_segments_);
 
-	segment_evaluation_order_.clear();
+	return JntToCartFull(q_in, &joint_pos[0], &joint_axis[0],
+			&segment_frames[0]);
+}
 
+int TreeFkSolverJointPosAxisPartial::JntToCartFull(const JntArray& q_in,
+		Vector* joint_pos, Vector* joint_axis, Frame* segment_frames) const
+{
 	// start the recursion
 	treeRecursiveFK(q_in, joint_pos, joint_axis, segment_frames,
-			Frame::Identity(), tree_.getRootSegment(), 0, -1, false);
+			Frame::Identity(), tree_.getRootSegment(), 0);
 
 	// get the inverse reference frame:
 	Frame inv_ref_frame = segment_frames[reference_frame_index_].Inverse();
@@ -108,8 +124,6 @@ int TreeFkSolverJointPosAxisPartial::JntToCartFull(const JntArray& q_in,
 		joint_pos[i] = inv_ref_frame * joint_pos[i];
 	}
 
-	segment_frames_ = segment_frames;
-
 	return 0;
 }
 
@@ -121,6 +135,13 @@ int TreeFkSolverJointPosAxisPartial::JntToCartPartial(const JntArray& q_in,
 	joint_axis.resize(num_joints_);
 	segment_frames.resize(num_segments_);
 
+	return JntToCartPartial(q_in, &joint_pos[0], &joint_axis[0],
+			&segment_frames[0]);
+}
+
+int TreeFkSolverJointPosAxisPartial::JntToCartPartial(const JntArray& q_in,
+		Vector* joint_pos, Vector* joint_axis, Frame* segment_frames) const
+{
 	// first solve for all segments
 	for (size_t i = 0; i < segment_evaluation_order_.size(); ++i)
 	{
@@ -154,10 +175,9 @@ int TreeFkSolverJointPosAxisPartial::JntToCartPartial(const JntArray& q_in,
 }
 
 int TreeFkSolverJointPosAxisPartial::treeRecursiveFK(const JntArray& q_in,
-		std::vector<Vector>& joint_pos, std::vector<Vector>& joint_axis,
-		std::vector<Frame>& segment_frames, const Frame& previous_frame,
-		const SegmentMap::const_iterator this_segment, int segment_nr,
-		int parent_segment_nr, bool active)
+		Vector* joint_pos, Vector* joint_axis, Frame* segment_frames,
+		const Frame& previous_frame,
+		const SegmentMap::const_iterator this_segment, int segment_nr) const
 {
 	Frame this_frame = previous_frame;
 
@@ -167,40 +187,63 @@ int TreeFkSolverJointPosAxisPartial::treeRecursiveFK(const JntArray& q_in,
 	{
 		int q_nr = this_segment->second.q_nr;
 		jnt_p = q_in(q_nr);
-		joint_parent_frame_nr_[q_nr] = parent_segment_nr;
-		joint_parent_[q_nr] = &(this_segment->second);
 		joint_pos[q_nr] = this_frame
 				* this_segment->second.segment.getJoint().JointOrigin();
 		joint_axis[q_nr] = this_frame.M
 				* this_segment->second.segment.getJoint().JointAxis();
-		if (active && active_joints_[q_nr])
+	}
+
+	// do the FK:
+	this_frame = this_frame * this_segment->second.segment.pose(jnt_p);
+	segment_frames[segment_nr] = this_frame;
+
+	segment_nr++;
+
+	// get poses of child segments
+	for (vector<SegmentMap::const_iterator>::const_iterator child =
+			this_segment->second.children.begin(); child
+			!= this_segment->second.children.end(); child++)
+		segment_nr = treeRecursiveFK(q_in, joint_pos, joint_axis,
+				segment_frames, this_frame, *child, segment_nr);
+	return segment_nr;
+}
+
+int TreeFkSolverJointPosAxisPartial::buildEvaluationOrder(
+		const SegmentMap::const_iterator this_segment, int segment_nr,
+		int parent_segment_nr, bool active, int rigid_body)
+{
+	if (this_segment->second.segment.getJoint().getType() != Joint::None)
+	{
+		int q_nr = this_segment->second.q_nr;
+		joint_parent_frame_nr_[q_nr] = parent_segment_nr;
+		joint_parent_[q_nr] = &(this_segment->second);
+
+		// the joint moves if any joint upstream of it is active
+		if (active)
 			joint_calc_pos_axis_[q_nr] = true;
 		if (active_joints_[q_nr])
+		{
 			active = true;
 
-		// TODO:
-		if (segment_nr < 4)
-			active = true;
+			// a new rigid body starts at each joint which changes
+			rigid_body = segment_nr;
+		}
 	}
+	segment_rigid_body_[segment_nr] = rigid_body;
 
-	// do the FK:
 	if (active)
 		segment_evaluation_order_.push_back(segment_nr);
 	segment_parent_frame_nr_[segment_nr] = parent_segment_nr;
 	segment_parent_[segment_nr] = &(this_segment->second);
-	this_frame = this_frame * this_segment->second.segment.pose(jnt_p);
-	segment_frames[segment_nr] = this_frame;
 
 	int par_seg_nr = segment_nr;
 	segment_nr++;
 
-	// get poses of child segments
 	for (vector<SegmentMap::const_iterator>::const_iterator child =
 			this_segment->second.children.begin(); child
 			!= this_segment->second.children.end(); child++)
-		segment_nr = treeRecursiveFK(q_in, joint_pos, joint_axis,
-				segment_frames, this_frame, *child, segment_nr, par_seg_nr,
-				active);
+		segment_nr = buildEvaluationOrder(*child, segment_nr, par_seg_nr,
+				active, rigid_body);
 	return segment_nr;
 }
 
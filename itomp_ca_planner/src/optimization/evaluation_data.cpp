@@ -40,6 +40,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/optimization/evaluation_manager.h>
 #include <itomp_ca_planner/model/itomp_planning_group.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
+#include <itomp_ca_planner/util/thread_budget.h>
 #include <boost/variant/get.hpp>
 #include <geometric_shapes/mesh_operations.h>
 #include <geometric_shapes/shape_operations.h>
@@ -51,19 +52,240 @@ using namespace Eigen;
 namespace itomp_ca_planner
 {
 
-EvaluationData::EvaluationData()
+EvaluationBuffers::EvaluationBuffers() :
+    is_shadow_valid_(false), shadow_stale_begin_(0), shadow_stale_end_(0), transaction_begin_(0), transaction_end_(0)
 {
 
 }
 
-EvaluationData::~EvaluationData()
+EvaluationBuffers::EvaluationBuffers(const EvaluationBuffers& buffers) :
+    is_shadow_valid_(false), shadow_stale_begin_(0), shadow_stale_end_(0), transaction_begin_(0), transaction_end_(0)
+{
+  *this = buffers;
+}
+
+EvaluationBuffers& EvaluationBuffers::operator=(const EvaluationBuffers& buffers)
 {
+  if (this == &buffers)
+    return *this;
+
+  // copy the layouts and the arena contents, then point the views at our own arena
+  joint_axis_ = buffers.joint_axis_;
+  joint_pos_ = buffers.joint_pos_;
+  segment_frames_ = buffers.segment_frames_;
+  segment_frames_initialized_ = buffers.segment_frames_initialized_;
+  jacobians_ = buffers.jacobians_;
+  state_is_in_collision_ = buffers.state_is_in_collision_;
+  collision_sphere_gradients_ = buffers.collision_sphere_gradients_;
+  state_validity_ = buffers.state_validity_;
+  linkPositions_ = buffers.linkPositions_;
+  linkVelocities_ = buffers.linkVelocities_;
+  linkAngularVelocities_ = buffers.linkAngularVelocities_;
+  CoMPositions_ = buffers.CoMPositions_;
+  CoMVelocities_ = buffers.CoMVelocities_;
+  CoMAccelerations_ = buffers.CoMAccelerations_;
+  AngularMomentums_ = buffers.AngularMomentums_;
+  Torques_ = buffers.Torques_;
+  wrenchSum_ = buffers.wrenchSum_;
+  contactViolationVector_ = buffers.contactViolationVector_;
+  contactPointVelVector_ = buffers.contactPointVelVector_;
+  contact_forces_ = buffers.contact_forces_;
+  stateContactInvariantCost_ = buffers.stateContactInvariantCost_;
+  statePhysicsViolationCost_ = buffers.statePhysicsViolationCost_;
+  stateCollisionCost_ = buffers.stateCollisionCost_;
+  stateFTRCost_ = buffers.stateFTRCost_;
+  stateCartesianTrajectoryCost_ = buffers.stateCartesianTrajectoryCost_;
+  stateSingularityCost_ = buffers.stateSingularityCost_;
+  singularity_bases_ = buffers.singularity_bases_;
+
+  arena_ = buffers.arena_;
+  bindBuffers();
+
+  // the shadow arena is not copied, it is rebuilt by the next transaction
+  is_shadow_valid_ = false;
+
+  return *this;
+}
+
+void EvaluationBuffers::allocateBuffers(int num_points, int num_kdl_joints, int num_segments, int num_mass_segments,
+    int num_contacts, int num_collision_spheres, int num_jacobian_entries)
+{
+  // laid out in the order of the evaluation stages
+  arena_.clear();
+  joint_axis_.layout(arena_, num_points, num_kdl_joints);
+  joint_pos_.layout(arena_, num_points, num_kdl_joints);
+  segment_frames_.layout(arena_, num_points, num_segments);
+  segment_frames_initialized_.layout(arena_, num_points);
+  jacobians_.layout(arena_, num_points, num_jacobian_entries);
+  state_is_in_collision_.layout(arena_, num_points);
+  collision_sphere_gradients_.layout(arena_, num_points, num_collision_spheres);
+  state_validity_.layout(arena_, num_points);
+  linkPositions_.layout(arena_, num_mass_segments, num_points);
+  linkVelocities_.layout(arena_, num_mass_segments, num_points);
+  linkAngularVelocities_.layout(arena_, num_mass_segments, num_points);
+  CoMPositions_.layout(arena_, num_points);
+  CoMVelocities_.layout(arena_, num_points);
+  CoMAccelerations_.layout(arena_, num_points);
+  AngularMomentums_.layout(arena_, num_points);
+  Torques_.layout(arena_, num_points);
+  wrenchSum_.layout(arena_, num_points);
+  contactViolationVector_.layout(arena_, num_contacts, num_points);
+  contactPointVelVector_.layout(arena_, num_contacts, num_points);
+  contact_forces_.layout(arena_, num_points, num_contacts);
+  stateContactInvariantCost_.layout(arena_, num_points);
+  statePhysicsViolationCost_.layout(arena_, num_points);
+  stateCollisionCost_.layout(arena_, num_points);
+  stateFTRCost_.layout(arena_, num_points);
+  stateCartesianTrajectoryCost_.layout(arena_, num_points);
+  stateSingularityCost_.layout(arena_, num_points);
+  singularity_bases_.layout(arena_, num_points);
+  arena_.allocate();
+  bindBuffers();
+  is_shadow_valid_ = false;
+
+  // the arena is zero-filled; frames start as identity like default constructed KDL frames
+  segment_frames_.fill(KDL::Frame::Identity());
+}
+
+void EvaluationBuffers::beginTransaction(int begin, int end)
+{
+  if (!is_shadow_valid_)
+  {
+    shadow_arena_ = arena_;
+    is_shadow_valid_ = true;
+  }
+  else
+  {
+    // bring the shadow up to date where the last transaction left it behind
+    copyWindow(shadow_arena_, arena_, shadow_stale_begin_, shadow_stale_end_);
+    copyWindow(shadow_arena_, arena_, begin, end);
+  }
+  shadow_stale_begin_ = shadow_stale_end_ = 0;
+  transaction_begin_ = begin;
+  transaction_end_ = end;
+}
+
+void EvaluationBuffers::commitTransaction()
+{
+  // the shadow keeps the old values of the window
+  markShadowStale(transaction_begin_, transaction_end_);
+}
+
+void EvaluationBuffers::rollbackTransaction()
+{
+  // the shadow holds the snapshot; after the swap it holds the discarded window
+  arena_.swap(shadow_arena_);
+  bindBuffers();
+  markShadowStale(transaction_begin_, transaction_end_);
+}
+
+void EvaluationBuffers::markShadowStale(int begin, int end)
+{
+  if (begin >= end)
+    return;
+  if (shadow_stale_begin_ >= shadow_stale_end_)
+  {
+    shadow_stale_begin_ = begin;
+    shadow_stale_end_ = end;
+  }
+  else
+  {
+    shadow_stale_begin_ = std::min(shadow_stale_begin_, begin);
+    shadow_stale_end_ = std::max(shadow_stale_end_, end);
+  }
+}
+
+void EvaluationBuffers::markWindowStale(int begin, int end, int free_begin, int free_end)
+{
+  if (begin >= end)
+    return;
+  markShadowStale(begin == free_begin ? 0 : begin, end == free_end ? CoMPositions_.size() : end);
+}
+
+void EvaluationBuffers::copyWindow(Arena& dst, const Arena& src, int begin, int end) const
+{
+  if (begin >= end)
+    return;
+
+  joint_axis_.copyRows(dst, src, begin, end);
+  joint_pos_.copyRows(dst, src, begin, end);
+  segment_frames_.copyRows(dst, src, begin, end);
+  segment_frames_initialized_.copyRange(dst, src, begin, end);
+  jacobians_.copyRows(dst, src, begin, end);
+  state_is_in_collision_.copyRange(dst, src, begin, end);
+  collision_sphere_gradients_.copyRows(dst, src, begin, end);
+  state_validity_.copyRange(dst, src, begin, end);
+  linkPositions_.copyCols(dst, src, begin, end);
+  linkVelocities_.copyCols(dst, src, begin, end);
+  linkAngularVelocities_.copyCols(dst, src, begin, end);
+  CoMPositions_.copyRange(dst, src, begin, end);
+  CoMVelocities_.copyRange(dst, src, begin, end);
+  CoMAccelerations_.copyRange(dst, src, begin, end);
+  AngularMomentums_.copyRange(dst, src, begin, end);
+  Torques_.copyRange(dst, src, begin, end);
+  wrenchSum_.copyRange(dst, src, begin, end);
+  contactViolationVector_.copyCols(dst, src, begin, end);
+  contactPointVelVector_.copyCols(dst, src, begin, end);
+  contact_forces_.copyRows(dst, src, begin, end);
+  stateContactInvariantCost_.copyRange(dst, src, begin, end);
+  statePhysicsViolationCost_.copyRange(dst, src, begin, end);
+  stateCollisionCost_.copyRange(dst, src, begin, end);
+  stateFTRCost_.copyRange(dst, src, begin, end);
+  stateCartesianTrajectoryCost_.copyRange(dst, src, begin, end);
+  stateSingularityCost_.copyRange(dst, src, begin, end);
+  singularity_bases_.copyRange(dst, src, begin, end);
+}
+
+void EvaluationBuffers::bindBuffers()
+{
+  joint_axis_.bind(arena_);
+  joint_pos_.bind(arena_);
+  segment_frames_.bind(arena_);
+  segment_frames_initialized_.bind(arena_);
+  jacobians_.bind(arena_);
+  state_is_in_collision_.bind(arena_);
+  collision_sphere_gradients_.bind(arena_);
+  state_validity_.bind(arena_);
+  linkPositions_.bind(arena_);
+  linkVelocities_.bind(arena_);
+  linkAngularVelocities_.bind(arena_);
+  CoMPositions_.bind(arena_);
+  CoMVelocities_.bind(arena_);
+  CoMAccelerations_.bind(arena_);
+  AngularMomentums_.bind(arena_);
+  Torques_.bind(arena_);
+  wrenchSum_.bind(arena_);
+  contactViolationVector_.bind(arena_);
+  contactPointVelVector_.bind(arena_);
+  contact_forces_.bind(arena_);
+  stateContactInvariantCost_.bind(arena_);
+  statePhysicsViolationCost_.bind(arena_);
+  stateCollisionCost_.bind(arena_);
+  stateFTRCost_.bind(arena_);
+  stateCartesianTrajectoryCost_.bind(arena_);
+  stateSingularityCost_.bind(arena_);
+  singularity_bases_.bind(arena_);
+}
+
+EvaluationData::EvaluationData() :
+    group_trajectory_(NULL), full_trajectory_(NULL), owns_trajectories_(false), is_evaluated_trajectory_valid_(false)
+{
+
+}
 
+EvaluationData::~EvaluationData()
+{
+  if (owns_trajectories_)
+  {
+    delete group_trajectory_;
+    delete full_trajectory_;
+  }
 }
 
 void EvaluationData::initialize(ItompCIOTrajectory *full_trajectory, ItompCIOTrajectory *group_trajectory,
     ItompRobotModel *robot_model, const ItompPlanningGroup *planning_group, const EvaluationManager* evaluation_manager,
-    int num_mass_segments, const moveit_msgs::Constraints& path_constraints,
+    int num_mass_segments, int num_collision_spheres, int num_jacobian_entries,
+    const moveit_msgs::Constraints& path_constraints,
     const planning_scene::PlanningSceneConstPtr& planning_scene)
 {
   full_trajectory_ = full_trajectory;
@@ -71,9 +293,13 @@ void EvaluationData::initialize(ItompCIOTrajectory *full_trajectory, ItompCIOTra
 
   robot_model_ = robot_model;
   planning_scene_ = planning_scene;
-  kinematic_state_.resize(getNumParallelThreads());
+  int num_waypoint_threads = ThreadBudget::getInstance()->getNumWaypointThreads();
+  kinematic_state_.resize(num_waypoint_threads);
   for (int i = 0; i < kinematic_state_.size(); ++i)
 	  kinematic_state_[i].reset(new robot_state::RobotState(robot_model->getRobotModel()));
+  collision_results_.resize(num_waypoint_threads);
+  collision_positions_.resize(num_waypoint_threads,
+      std::vector<double>(kinematic_state_[0]->getVariableCount()));
   //initStaticEnvironment();
 
   kdl_joint_array_.resize(robot_model->getKDLTree()->getNrOfJoints());
@@ -112,64 +338,14 @@ void EvaluationData::initialize(ItompCIOTrajectory *full_trajectory, ItompCIOTra
     joint_costs_[i].scale(max_cost_scale);
   }
 
-  joint_axis_.resize(num_points, std::vector<KDL::Vector>(robot_model->getKDLTree()->getNrOfJoints()));
-  joint_pos_.resize(num_points, std::vector<KDL::Vector>(robot_model->getKDLTree()->getNrOfJoints()));
-  segment_frames_.resize(num_points, std::vector<KDL::Frame>(robot_model->getKDLTree()->getNrOfSegments()));
-
-  state_is_in_collision_.resize(num_points);
+  // all per-waypoint buffers are zero-initialized
+  allocateBuffers(num_points, robot_model->getKDLTree()->getNrOfJoints(),
+      robot_model->getKDLTree()->getNrOfSegments(), num_mass_segments, num_contacts, num_collision_spheres,
+      num_jacobian_entries);
 
-  state_validity_.resize(num_points);
-  for (int i = 0; i < num_points; ++i)
-    state_validity_[i] = true;
+  state_validity_.fill(true);
   dynamic_obstacle_cost_ = Eigen::VectorXd::Zero(num_points);
 
-  stateContactInvariantCost_.resize(num_points);
-  statePhysicsViolationCost_.resize(num_points);
-  stateCollisionCost_.resize(num_points);
-  stateFTRCost_.resize(num_points);
-  stateCartesianTrajectoryCost_.resize(num_points);
-  stateSingularityCost_.resize(num_points);
-
-  linkPositions_.resize(num_mass_segments);
-  linkVelocities_.resize(num_mass_segments);
-  linkAngularVelocities_.resize(num_mass_segments);
-  for (int i = 0; i < num_mass_segments; ++i)
-  {
-    linkPositions_[i].resize(num_points);
-    linkVelocities_[i].resize(num_points);
-    linkAngularVelocities_[i].resize(num_points);
-  }
-  CoMPositions_.resize(num_points);
-  CoMVelocities_.resize(num_points);
-  CoMAccelerations_.resize(num_points);
-  AngularMomentums_.resize(num_points);
-  Torques_.resize(num_points);
-  wrenchSum_.resize(num_points);
-  contact_forces_.resize(num_points);
-  for (int i = 0; i < num_points; ++i)
-    contact_forces_[i].resize(num_contacts);
-
-  // init values to 0
-  for (int i = 0; i < num_points; ++i)
-  {
-    CoMPositions_[i] = KDL::Vector::Zero();
-    CoMVelocities_[i] = KDL::Vector::Zero();
-    CoMAccelerations_[i] = KDL::Vector::Zero();
-    AngularMomentums_[i] = KDL::Vector::Zero();
-    Torques_[i] = KDL::Vector::Zero();
-    wrenchSum_[i] = KDL::Wrench::Zero();
-    for (int j = 0; j < num_contacts; ++j)
-      contact_forces_[i][j] = KDL::Vector::Zero();
-  }
-
-  contactViolationVector_.resize(num_contacts);
-  contactPointVelVector_.resize(num_contacts);
-  for (int i = 0; i < num_contacts; ++i)
-  {
-    contactViolationVector_[i].resize(num_points);
-    contactPointVelVector_[i].resize(num_points);
-  }
-
   costAccumulator_.addCost(TrajectoryCost::CreateTrajectoryCost(TrajectoryCost::COST_SMOOTHNESS));
   costAccumulator_.addCost(TrajectoryCost::CreateTrajectoryCost(TrajectoryCost::COST_COLLISION));
   costAccumulator_.addCost(TrajectoryCost::CreateTrajectoryCost(TrajectoryCost::COST_VALIDITY));
@@ -182,6 +358,7 @@ void EvaluationData::initialize(ItompCIOTrajectory *full_trajectory, ItompCIOTra
   costAccumulator_.init(this);
 
   fk_solver_ = *planning_group->fk_solver_.get();
+  batch_fk_solver_ = *planning_group->batch_fk_solver_.get();
 
   cartesian_waypoints_.resize(path_constraints.position_constraints.size());
   for (int i = 0; i < path_constraints.position_constraints.size(); ++i)
@@ -266,6 +443,7 @@ EvaluationData* EvaluationData::clone() const
 
   new_data->group_trajectory_ = new ItompCIOTrajectory(*group_trajectory_);
   new_data->full_trajectory_ = new ItompCIOTrajectory(*full_trajectory_);
+  new_data->owns_trajectories_ = true;
 
   for (int i = 0; i < kinematic_state_.size(); ++i)
 	  new_data->kinematic_state_[i].reset(new robot_state::RobotState(robot_model_->getRobotModel()));
@@ -278,6 +456,7 @@ void EvaluationData::deepCopy(const EvaluationData& data)
   // store pointers
   ItompCIOTrajectory* group_trajectory = group_trajectory_;
   ItompCIOTrajectory* full_trajectory = full_trajectory_;
+  bool owns_trajectories = owns_trajectories_;
   std::vector<robot_state::RobotStatePtr> kinematic_state = kinematic_state_;
 
   // copy
@@ -290,11 +469,66 @@ void EvaluationData::deepCopy(const EvaluationData& data)
   // copy pointers again
   group_trajectory_ = group_trajectory;
   full_trajectory_ = full_trajectory;
+  owns_trajectories_ = owns_trajectories;
 
   // do not copy planning scene
   kinematic_state_ = kinematic_state;
 }
 
+void EvaluationData::getDirtyRange(int& begin, int& end) const
+{
+  int num_points = group_trajectory_->getNumPoints();
+  begin = 0;
+  end = num_points;
+  if (!is_evaluated_trajectory_valid_)
+    return;
+
+  begin = num_points;
+  end = 0;
+
+  const MatrixXd& trajectory = group_trajectory_->getTrajectory();
+  for (int i = 0; i < num_points; ++i)
+  {
+    if (trajectory.row(i) != evaluated_trajectory_.row(i))
+    {
+      begin = min(begin, i);
+      end = i + 1;
+    }
+  }
+
+  // a changed contact value affects all waypoints of its phase
+  const MatrixXd& contact_trajectory = group_trajectory_->getContactTrajectory();
+  int first_phase = contact_trajectory.rows();
+  int last_phase = -1;
+  for (int i = 0; i < contact_trajectory.rows(); ++i)
+  {
+    if (contact_trajectory.row(i) != evaluated_contact_trajectory_.row(i))
+    {
+      first_phase = min(first_phase, i);
+      last_phase = i;
+    }
+  }
+  if (first_phase <= last_phase)
+  {
+    for (int i = 0; i < num_points; ++i)
+    {
+      int phase = group_trajectory_->getContactPhase(i);
+      if (phase >= first_phase && phase <= last_phase)
+      {
+        begin = min(begin, i);
+        end = max(end, i + 1);
+      }
+    }
+  }
+}
+
+void EvaluationData::updateEvaluatedTrajectory()
+{
+  evaluated_trajectory_ = group_trajectory_->getTrajectory();
+  evaluated_contact_trajectory_ = group_trajectory_->getContactTrajectory();
+  is_evaluated_trajectory_valid_ = true;
+}
+
 void EvaluationData::compare(const EvaluationData& ref) const
 {
   printf("Compare\n");
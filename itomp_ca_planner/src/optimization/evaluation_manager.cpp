@@ -45,6 +45,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/contact/contact_force_solver.h>
 #include <itomp_ca_planner/util/min_jerk_trajectory.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
+#include <itomp_ca_planner/util/thread_budget.h>
 #include <itomp_ca_planner/util/vector_util.h>
 #include <itomp_ca_planner/util/multivariate_gaussian.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -87,6 +88,11 @@ enum LEG_JOINTS
 
 static bool STABILITY_COST_VERBOSE = false;
 
+// limbs of the force transmission ratio cost, in the order of the contact points
+static const int NUM_FTR_GROUPS = 4;
+static const char* FTR_GROUP_NAMES[NUM_FTR_GROUPS] =
+{ "left_leg", "right_leg", "left_arm", "right_arm" };
+
 EvaluationManager::EvaluationManager(int* iteration) :
 		iteration_(iteration), data_(&default_data_), count_(0)
 {
@@ -105,8 +111,6 @@ void EvaluationManager::initialize(ItompCIOTrajectory *full_trajectory,
 		const moveit_msgs::Constraints& path_constraints,
 		const planning_scene::PlanningSceneConstPtr& planning_scene)
 {
-	omp_set_num_threads(getNumParallelThreads());
-
 	planning_start_time_ = planning_start_time;
 	trajectory_start_time_ = trajectory_start_time;
 
@@ -140,11 +144,80 @@ void EvaluationManager::initialize(ItompCIOTrajectory *full_trajectory,
 
 	computeMassAndGravityForce();
 
-	GroundManager::getInstance().init();
+	GroundManager::getInstance().init(planning_scene);
+
+	link_sphere_model_.init(robot_model_);
+	signed_distance_field_.reset();
+	collision_prefilter_.reset();
+	collision_cost_query_.reset();
+	if (PlanningParameters::getInstance()->getCollisionBackend() == "sdf")
+	{
+		signed_distance_field_ =
+				SignedDistanceFieldCache::getInstance()->getSignedDistanceField(
+						planning_scene,
+						PlanningParameters::getInstance()->getSDFResolution(),
+						PlanningParameters::getInstance()->getSDFPadding());
+		initializeCollisionGradientChains();
+
+		// the field only holds the world objects, the self collision pairs are
+		// queried with FCL
+		CollisionCostQuery* collision_cost_query = new CollisionCostQuery();
+		collision_cost_query->init(robot_model_, planning_group_,
+				planning_scene, true);
+		if (collision_cost_query->getNumPairs() > 0)
+			collision_cost_query_.reset(collision_cost_query);
+		else
+			delete collision_cost_query;
+	}
+	else
+	{
+		// the per-group collision plan needs the query for the static pairs
+		if (PlanningParameters::getInstance()->getUseCollisionCostQuery())
+		{
+			CollisionCostQuery* collision_cost_query = new CollisionCostQuery();
+			collision_cost_query->init(robot_model_, planning_group_,
+					planning_scene);
+			collision_cost_query_.reset(collision_cost_query);
+		}
+		if (PlanningParameters::getInstance()->getUseCollisionPrefilter())
+		{
+			collision_prefilter_.reset(new CollisionPrefilter());
+			collision_prefilter_->init(link_sphere_model_,
+					collision_cost_query_ ? planning_group_ : NULL,
+					planning_scene);
+		}
+	}
+	int num_collision_spheres =
+			signed_distance_field_ ? link_sphere_model_.getNumSpheres() : 0;
+
+	jacobian_solver_.clear();
+	if (PlanningParameters::getInstance()->getFTRCostWeight() != 0.0)
+	{
+		for (int i = 0; i < NUM_FTR_GROUPS; ++i)
+			jacobian_solver_.addGroup(robot_model_, FTR_GROUP_NAMES[i]);
+	}
+	if (PlanningParameters::getInstance()->getSingularityCostWeight() != 0.0)
+		jacobian_solver_.addGroup(robot_model_, planning_group_->name_);
 
 	default_data_.initialize(full_trajectory, group_trajectory, robot_model,
-			planning_group, this, num_mass_segments_, path_constraints,
-			planning_scene);
+			planning_group, this, num_mass_segments_, num_collision_spheres,
+			jacobian_solver_.getNumEntries(),
+			path_constraints, planning_scene);
+
+	// a new planning scene starts with an empty cache
+	if (PlanningParameters::getInstance()->getUseCollisionCache())
+		default_data_.collision_cache_.init(num_points_,
+				link_sphere_model_.getLinks());
+
+	if (collision_cost_query_)
+	{
+		default_data_.static_collision_depths_.assign(num_points_, -1.0);
+		default_data_.collision_workspaces_.resize(
+				default_data_.kinematic_state_.size());
+		for (int i = 0; i < default_data_.collision_workspaces_.size(); ++i)
+			collision_cost_query_->initWorkspace(
+					default_data_.collision_workspaces_[i]);
+	}
 
 	timings_.resize(100, 0);
 	for (int i = 0; i < 100; ++i)
@@ -158,23 +231,59 @@ void EvaluationManager::initialize(ItompCIOTrajectory *full_trajectory,
 
 double EvaluationManager::evaluate()
 {
+	// only the waypoints changed since the last evaluation of data_ are recomputed,
+	// the per-waypoint results of the others are reused
+	int begin = 0;
+	int end = num_points_;
+	if (PlanningParameters::getInstance()->getUseIncrementalEvaluation())
+		data_->getDirtyRange(begin, end);
+
 	// do forward kinematics:
-	last_trajectory_collision_free_ = performForwardKinematics();
+	if (begin < end)
+		performForwardKinematics(begin, end);
 
 	//handleTrajectoryConstraint();
 
 	computeTrajectoryValidity();
-	last_trajectory_collision_free_ &= trajectory_validity_;
 
-	computeWrenchSum();
+	// the per-waypoint costs of the window depend on the changed waypoints
+	const int radius = getCostDependencyRadius();
+	int window_begin = max(full_vars_start_, begin - radius);
+	int window_end = min(full_vars_end_, end + radius);
 
-	computeStabilityCosts();
+	// the per-waypoint buffers are written outside of a derivative transaction.
+	// computeWrenchSum also copies the boundary values of the window to the fixed
+	// waypoints before full_vars_start_ and from full_vars_end_ on
+	if (begin < end)
+		data_->markShadowStale(begin, end);
+	data_->markWindowStale(window_begin, window_end, full_vars_start_,
+			full_vars_end_);
 
-	// TODO: reuse
-	computeCollisionCosts();
+	if (window_begin < window_end)
+	{
+		computeWrenchSum(window_begin, window_end);
+		computeStabilityCosts(window_begin, window_end);
 
-	//computeFTRs();
-	computeSingularityCosts();
+		// FTR depends on the contact forces of the stability stage
+		computeJacobians(window_begin, window_end);
+		computeFTRs(window_begin, window_end);
+	}
+
+	int collision_begin = max(full_vars_start_ + 1, begin);
+	int collision_end = min(full_vars_end_ - 1, end);
+	if (collision_begin < collision_end)
+	{
+		computeCollisionCosts(collision_begin, collision_end);
+
+		computeSingularityCosts(collision_begin, collision_end);
+	}
+
+	last_trajectory_collision_free_ = trajectory_validity_;
+	for (int i = 0; i < num_points_; ++i)
+	{
+		if (data_->state_is_in_collision_[i])
+			last_trajectory_collision_free_ = false;
+	}
 
 	computeCartesianTrajectoryCosts();
 
@@ -182,6 +291,8 @@ double EvaluationManager::evaluate()
 
 	last_trajectory_collision_free_ &= data_->costAccumulator_.isFeasible();
 
+	data_->updateEvaluatedTrajectory();
+
 	// TODO: if trajectory is changed in handle joint limits,
 	// update parameters
 
@@ -231,6 +342,14 @@ double EvaluationManager::evaluate(DERIVATIVE_VARIABLE_TYPE variable_type,
 
 	computeStabilityCosts(begin, end + 1);
 
+	// FTR depends on the contact forces of the stability stage
+	if (variable_type != DERIVATIVE_CONTACT_VARIABLE)
+	{
+		computeJacobians(begin, end);
+		computeSingularityCosts(begin, end);
+	}
+	computeFTRs(begin, end);
+
 	ADD_TIMER_POINT
 
 	if (variable_type != DERIVATIVE_CONTACT_VARIABLE)
@@ -238,8 +357,6 @@ double EvaluationManager::evaluate(DERIVATIVE_VARIABLE_TYPE variable_type,
 
 	ADD_TIMER_POINT
 
-	computeFTRs(begin, end);
-
 	data_->costAccumulator_.compute(data_);
 
 	UPDATE_TIME
@@ -317,7 +434,7 @@ void EvaluationManager::backupAndSetVariables(double new_value,
 		target_trajectory = &getGroupTrajectory()->getContactTrajectory();
 		break;
 	}
-	backup_data_.trajectory_value_ = (*target_trajectory)(free_point_index,
+	backup_trajectory_value_ = (*target_trajectory)(free_point_index,
 			joint_index);
 
 	ROS_ASSERT(
@@ -337,90 +454,10 @@ void EvaluationManager::backupAndSetVariables(double new_value,
 		updateFullTrajectory(free_point_index, joint_index);
 	}
 
-	int stride = getGroupTrajectory()->getContactPhaseStride();
-	if (free_point_index == 0)
-		free_point_index = 1;
-	int begin = (free_point_index - 1) * stride;
-
-	backup_data_.segment_frames_.resize(2 * stride);
-
-	backup_data_.wrenchSum_.resize(2 * stride + 1);
-	backup_data_.linkPositions_.resize(num_mass_segments_);
-	backup_data_.linkVelocities_.resize(num_mass_segments_);
-	backup_data_.linkAngularVelocities_.resize(num_mass_segments_);
-	for (int i = 0; i < num_mass_segments_; ++i)
-	{
-		backup_data_.linkPositions_[i].resize(2 * stride + 1);
-		backup_data_.linkVelocities_[i].resize(2 * stride + 1);
-		backup_data_.linkAngularVelocities_[i].resize(2 * stride + 1);
-	}
-	backup_data_.CoMPositions_.resize(2 * stride + 1);
-	backup_data_.CoMVelocities_.resize(2 * stride + 1);
-	backup_data_.CoMAccelerations_.resize(2 * stride + 1);
-	backup_data_.AngularMomentums_.resize(2 * stride + 1);
-	backup_data_.Torques_.resize(2 * stride + 1);
-	backup_data_.contactViolationVector_.resize(num_contacts_);
-	backup_data_.contactPointVelVector_.resize(num_contacts_);
-	for (int i = 0; i < num_contacts_; ++i)
-	{
-		backup_data_.contactViolationVector_[i].resize(2 * stride + 1);
-		backup_data_.contactPointVelVector_[i].resize(2 * stride + 1);
-	}
-
-	backup_data_.state_contact_invariant_cost_.resize(2 * stride + 1);
-	backup_data_.state_physics_violation_cost_.resize(2 * stride + 1);
-	backup_data_.state_collision_cost_.resize(2 * stride);
-	backup_data_.state_ftr_cost_.resize(2 * stride);
-
-	for (int i = 0; i < 2 * stride; ++i)
-	{
-		backup_data_.segment_frames_[i] = data_->segment_frames_[begin + i];
-	}
-
-	memcpy(&backup_data_.wrenchSum_[0], &data_->wrenchSum_[begin],
-			sizeof(KDL::Wrench) * 2 * stride + 1);
-	for (int i = 0; i < num_mass_segments_; ++i)
-	{
-		memcpy(&backup_data_.linkPositions_[i][0],
-				&data_->linkPositions_[i][begin],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-		memcpy(&backup_data_.linkVelocities_[i][0],
-				&data_->linkVelocities_[i][begin],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-		memcpy(&backup_data_.linkAngularVelocities_[i][0],
-				&data_->linkAngularVelocities_[i][begin],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-	}
-	memcpy(&backup_data_.CoMPositions_[0], &data_->CoMPositions_[begin],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&backup_data_.CoMVelocities_[0], &data_->CoMVelocities_[begin],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&backup_data_.CoMAccelerations_[0], &data_->CoMAccelerations_[begin],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&backup_data_.AngularMomentums_[0], &data_->AngularMomentums_[begin],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&backup_data_.Torques_[0], &data_->Torques_[begin],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	for (int i = 0; i < num_contacts_; ++i)
-	{
-		memcpy(&backup_data_.contactViolationVector_[i][0],
-				&data_->contactViolationVector_[i][begin],
-				sizeof(Vector4d) * 2 * stride + 1);
-		memcpy(&backup_data_.contactPointVelVector_[i][0],
-				&data_->contactPointVelVector_[i][begin],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-	}
-
-	memcpy(&backup_data_.state_contact_invariant_cost_[0],
-			&data_->stateContactInvariantCost_[begin],
-			sizeof(double) * 2 * stride + 1);
-	memcpy(&backup_data_.state_physics_violation_cost_[0],
-			&data_->statePhysicsViolationCost_[begin],
-			sizeof(double) * 2 * stride + 1);
-	memcpy(&backup_data_.state_collision_cost_[0],
-			&data_->stateCollisionCost_[begin], sizeof(double) * 2 * stride);
-	memcpy(&backup_data_.state_ftr_cost_[0], &data_->stateFTRCost_[begin],
-			sizeof(double) * 2 * stride + 1);
+	// snapshot every waypoint the windowed evaluate() may write
+	int begin, end;
+	getDerivativeWindow(free_point_index, begin, end);
+	data_->beginTransaction(begin, end);
 }
 
 void EvaluationManager::restoreVariable(DERIVATIVE_VARIABLE_TYPE variable_type,
@@ -444,7 +481,7 @@ void EvaluationManager::restoreVariable(DERIVATIVE_VARIABLE_TYPE variable_type,
 
 	// restore trajectory value
 	(*target_trajectory)(free_point_index, joint_index) =
-			backup_data_.trajectory_value_;
+			backup_trajectory_value_;
 	if (variable_type != DERIVATIVE_CONTACT_VARIABLE)
 	{
 		getGroupTrajectory()->updateTrajectoryFromFreePoint(free_point_index,
@@ -452,59 +489,22 @@ void EvaluationManager::restoreVariable(DERIVATIVE_VARIABLE_TYPE variable_type,
 		updateFullTrajectory(free_point_index, joint_index);
 	}
 	// restore variables
-	int stride = getGroupTrajectory()->getContactPhaseStride();
-	if (free_point_index == 0)
-		free_point_index = 1;
-	int begin = (free_point_index - 1) * stride;
-
-	for (int i = 0; i < 2 * stride; ++i)
-		data_->segment_frames_[begin + i] = backup_data_.segment_frames_[i];
-
-	memcpy(&data_->wrenchSum_[begin], &backup_data_.wrenchSum_[0],
-			sizeof(KDL::Wrench) * 2 * stride + 1);
-	for (int i = 0; i < num_mass_segments_; ++i)
-	{
-		memcpy(&data_->linkPositions_[i][begin],
-				&backup_data_.linkPositions_[i][0],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-		memcpy(&data_->linkVelocities_[i][begin],
-				&backup_data_.linkVelocities_[i][0],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-		memcpy(&data_->linkAngularVelocities_[i][begin],
-				&backup_data_.linkAngularVelocities_[i][0],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-	}
-	memcpy(&data_->CoMPositions_[begin], &backup_data_.CoMPositions_[0],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&data_->CoMVelocities_[begin], &backup_data_.CoMVelocities_[0],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&data_->CoMAccelerations_[begin], &backup_data_.CoMAccelerations_[0],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&data_->AngularMomentums_[begin], &backup_data_.AngularMomentums_[0],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	memcpy(&data_->Torques_[begin], &backup_data_.Torques_[0],
-			sizeof(KDL::Vector) * 2 * stride + 1);
-	for (int i = 0; i < num_contacts_; ++i)
-	{
-		memcpy(&data_->contactViolationVector_[i][begin],
-				&backup_data_.contactViolationVector_[i][0],
-				sizeof(Vector4d) * 2 * stride + 1);
-		memcpy(&data_->contactPointVelVector_[i][begin],
-				&backup_data_.contactPointVelVector_[i][0],
-				sizeof(KDL::Vector) * 2 * stride + 1);
-	}
+	data_->rollbackTransaction();
+}
 
-	memcpy(&data_->stateContactInvariantCost_[begin],
-			&backup_data_.state_contact_invariant_cost_[0],
-			sizeof(double) * 2 * stride + 1);
-	memcpy(&data_->statePhysicsViolationCost_[begin],
-			&backup_data_.state_physics_violation_cost_[0],
-			sizeof(double) * 2 * stride + 1);
-	memcpy(&data_->stateCollisionCost_[begin],
-			&backup_data_.state_collision_cost_[0],
-			sizeof(double) * 2 * stride);
-	memcpy(&data_->stateFTRCost_[begin], &backup_data_.state_ftr_cost_[0],
-			sizeof(double) * 2 * stride + 1);
+void EvaluationManager::getDerivativeWindow(int free_point_index, int& begin,
+		int& end)
+{
+	// evaluate(variable_type, ...) recomputes [begin, end + 1) of the
+	// variable's contact phase stride. The wrench computation also copies the
+	// boundary values to the fixed waypoints at both ends.
+	int stride = getGroupTrajectory()->getContactPhaseStride();
+	begin = max(0, (free_point_index - 1) * stride);
+	end = min(num_points_, (free_point_index + 1) * stride + 1);
+	if (begin <= full_vars_start_)
+		begin = 0;
+	if (end >= full_vars_end_)
+		end = num_points_;
 }
 
 double EvaluationManager::evaluateDerivatives(double value,
@@ -517,6 +517,8 @@ double EvaluationManager::evaluateDerivatives(double value,
 	// evaluate
 	double cost = evaluate(variable_type, free_point_index, joint_index);
 
+	// the rollback restores the buffers of the last full evaluation, so the
+	// dirty range tracking stays valid
 	restoreVariable(variable_type, free_point_index, joint_index);
 
 	return cost;
@@ -546,26 +548,51 @@ void EvaluationManager::computeMassAndGravityForce()
 	total_mass_ = 0.0;
 	const KDL::SegmentMap& segmentMap =
 			robot_model_->getKDLTree()->getSegments();
-	num_mass_segments_ = 0;
+	mass_segments_.clear();
 	for (KDL::SegmentMap::const_iterator it = segmentMap.begin();
 			it != segmentMap.end(); ++it)
 	{
 		const KDL::Segment& segment = it->second.segment;
-		double mass = segment.getInertia().getMass();
+		const KDL::RigidBodyInertia& inertia = segment.getInertia();
+		double mass = inertia.getMass();
 		if (mass == 0)
 			continue;
 
 		total_mass_ += mass;
-		masses_.push_back(mass);
 
-		++num_mass_segments_;
+		MassSegment mass_segment;
+		mass_segment.segment_index_ =
+				robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
+						segment.getName());
+		mass_segment.mass_ = mass;
+		mass_segment.kdl_mass_ = mass;
+		mass_segment.cog_ = inertia.getCOG();
+
+		// KDL stores the inertia about the segment origin, move it to the COG:
+		// I_cog = I_o - m (|c|^2 E - c c^T)
+		const KDL::Vector& c = mass_segment.cog_;
+		KDL::RotationalInertia cog_inertia = inertia.getRotationalInertia();
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				double parallel_axis = -c(r) * c(k);
+				if (r == k)
+					parallel_axis += KDL::dot(c, c);
+				cog_inertia.data[3 * r + k] -= mass * parallel_axis;
+			}
+		}
+		mass_segment.cog_inertia_ = cog_inertia;
+
+		mass_segments_.push_back(mass_segment);
 	}
+	num_mass_segments_ = mass_segments_.size();
 	gravity_force_ = total_mass_ * KDL::Vector(0.0, 0.0, -9.8);
 
 	// normalize gravity force to 1.0 and rescale masses
 	gravity_force_ = KDL::Vector(0.0, 0.0, -1.0);
-	for (int i = 0; i < masses_.size(); ++i)
-		masses_[i] /= total_mass_ * 9.8;
+	for (int i = 0; i < num_mass_segments_; ++i)
+		mass_segments_[i].mass_ /= total_mass_ * 9.8;
 	total_mass_ = 1.0 / 9.8;
 
 }
@@ -721,6 +748,7 @@ void EvaluationManager::updateFullTrajectory(int point_index, int joint_index)
 			point_index, joint_index);
 }
 
+//#define DEBUG_BATCH_FK
 bool EvaluationManager::performForwardKinematics(int begin, int end)
 {
 	double invTime = 1.0 / getGroupTrajectory()->getDiscretization();
@@ -731,50 +759,98 @@ bool EvaluationManager::performForwardKinematics(int begin, int end)
 	int safe_begin = max(0, begin);
 	int safe_end = min(num_points_, end);
 
-	// used in computeBaseFrames
-	int full_traj_index = getGroupTrajectory()->getFullTrajectoryIndex(
-			num_points_ - 1);
-	getFullTrajectory()->getTrajectoryPointKDL(full_traj_index,
-			data_->kdl_joint_array_);
-	data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_,
-			data_->joint_pos_[num_points_ - 1],
-			data_->joint_axis_[num_points_ - 1],
-			data_->segment_frames_[num_points_ - 1]);
+	// solve all waypoints of the range at once
+	bool use_batch_fk = PlanningParameters::getInstance()->getUseBatchFK()
+			&& safe_end - safe_begin > 1;
+	if (use_batch_fk)
+	{
+		data_->batch_fk_rows_.resize(safe_end - safe_begin);
+		for (int i = safe_begin; i < safe_end; ++i)
+			data_->batch_fk_rows_[i - safe_begin] =
+					getGroupTrajectory()->getFullTrajectoryIndex(i);
+
+		// like computeForwardKinematics, recompute only the segments below the
+		// group joints once every waypoint of the range had a full FK
+		bool use_partial_fk = PlanningParameters::getInstance()->getUsePartialFK()
+				&& data_->fk_solver_.isPartialFKAvailable();
+		for (int i = safe_begin; i < safe_end && use_partial_fk; ++i)
+			use_partial_fk = data_->segment_frames_initialized_[i];
+		if (use_partial_fk)
+			data_->batch_fk_solver_.JntToCartBatchPartial(
+					getFullTrajectory()->getTrajectory(), data_->batch_fk_rows_,
+					data_->joint_pos_[safe_begin].data(),
+					data_->joint_axis_[safe_begin].data(),
+					data_->segment_frames_[safe_begin].data());
+		else
+			data_->batch_fk_solver_.JntToCartBatch(
+					getFullTrajectory()->getTrajectory(), data_->batch_fk_rows_,
+					data_->joint_pos_[safe_begin].data(),
+					data_->joint_axis_[safe_begin].data(),
+					data_->segment_frames_[safe_begin].data());
+		for (int i = safe_begin; i < safe_end; ++i)
+			data_->segment_frames_initialized_[i] = 1;
 
-	// for each point in the trajectory
-	for (int i = safe_begin; i < safe_end; ++i)
+#ifdef DEBUG_BATCH_FK
+		std::vector<KDL::Vector> joint_pos, joint_axis;
+		std::vector<KDL::Frame> segment_frames;
+		for (int i = safe_begin; i < safe_end; ++i)
+		{
+			getFullTrajectory()->getTrajectoryPointKDL(
+					data_->batch_fk_rows_[i - safe_begin],
+					data_->kdl_joint_array_);
+			data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_, joint_pos,
+					joint_axis, segment_frames);
+			for (int j = 0; j < segment_frames.size(); ++j)
+			{
+				if (!KDL::Equal(segment_frames[j], data_->segment_frames_[i][j]))
+					ROS_ERROR("%s FK mismatch at point %d segment %d",
+							use_partial_fk ? "Partial batch" : "Batch", i, j);
+			}
+			for (int j = 0; j < joint_pos.size(); ++j)
+			{
+				if (!KDL::Equal(joint_pos[j], data_->joint_pos_[i][j])
+						|| !KDL::Equal(joint_axis[j], data_->joint_axis_[i][j]))
+					ROS_ERROR("%s FK mismatch at point %d joint %d",
+							use_partial_fk ? "Partial batch" : "Batch", i, j);
+			}
+		}
+#endif
+	}
+
+	// used in computeBaseFrames
+	if (!use_batch_fk || safe_end != num_points_)
 	{
-		int full_traj_index = getGroupTrajectory()->getFullTrajectoryIndex(i);
+		int full_traj_index = getGroupTrajectory()->getFullTrajectoryIndex(
+				num_points_ - 1);
 		getFullTrajectory()->getTrajectoryPointKDL(full_traj_index,
 				data_->kdl_joint_array_);
-		// TODO: ?
-		/*
-		 // update kdl_joint_array with vel, acc
-		 if (i < 1)
-		 {
-		 for (int j = 0; j < planning_group_->num_joints_; j++)
-		 {
-		 int target_joint = planning_group_->group_joints_[j].kdl_joint_index_;
-		 data_->kdl_joint_array_(target_joint) = (*getGroupTrajectory())(i, j);
-		 }
-		 }
-		 */
+		computeForwardKinematics(num_points_ - 1);
+	}
 
-		//computeBaseFrames(data_->kdl_joint_array_, i);
-		if (i == safe_begin)
-			data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_,
-					data_->joint_pos_[i], data_->joint_axis_[i],
-					data_->segment_frames_[i]);
-		else
-			data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_,
-					data_->joint_pos_[i], data_->joint_axis_[i],
-					data_->segment_frames_[i]);
-		// TODO: check patrial FK
-		/*
-		 data_->fk_solver_.JntToCartPartial(data_->kdl_joint_array_,
-		 data_->joint_pos_[i], data_->joint_axis_[i],
-		 data_->segment_frames_[i]);
-		 */
+	// for each point in the trajectory
+	for (int i = safe_begin; i < safe_end; ++i)
+	{
+		if (!use_batch_fk)
+		{
+			int full_traj_index = getGroupTrajectory()->getFullTrajectoryIndex(i);
+			getFullTrajectory()->getTrajectoryPointKDL(full_traj_index,
+					data_->kdl_joint_array_);
+			// TODO: ?
+			/*
+			 // update kdl_joint_array with vel, acc
+			 if (i < 1)
+			 {
+			 for (int j = 0; j < planning_group_->num_joints_; j++)
+			 {
+			 int target_joint = planning_group_->group_joints_[j].kdl_joint_index_;
+			 data_->kdl_joint_array_(target_joint) = (*getGroupTrajectory())(i, j);
+			 }
+			 }
+			 */
+
+			//computeBaseFrames(data_->kdl_joint_array_, i);
+			computeForwardKinematics(i);
+		}
 
 		data_->state_is_in_collision_[i] = false;
 
@@ -787,6 +863,47 @@ bool EvaluationManager::performForwardKinematics(int begin, int end)
 	return is_collision_free_;
 }
 
+//#define DEBUG_PARTIAL_FK
+void EvaluationManager::computeForwardKinematics(int point)
+{
+	// joints outside the planning group do not change during the optimization, so
+	// after the first full FK of a waypoint only the segments below the group joints
+	// need to be recomputed
+	if (PlanningParameters::getInstance()->getUsePartialFK()
+			&& data_->segment_frames_initialized_[point]
+			&& data_->fk_solver_.isPartialFKAvailable())
+	{
+		data_->fk_solver_.JntToCartPartial(data_->kdl_joint_array_,
+				data_->joint_pos_[point].data(), data_->joint_axis_[point].data(),
+				data_->segment_frames_[point].data());
+
+#ifdef DEBUG_PARTIAL_FK
+		std::vector<KDL::Vector> joint_pos, joint_axis;
+		std::vector<KDL::Frame> segment_frames;
+		data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_, joint_pos,
+				joint_axis, segment_frames);
+		for (int j = 0; j < segment_frames.size(); ++j)
+		{
+			if (!KDL::Equal(segment_frames[j], data_->segment_frames_[point][j]))
+				ROS_ERROR("Partial FK mismatch at point %d segment %d", point, j);
+		}
+		for (int j = 0; j < joint_pos.size(); ++j)
+		{
+			if (!KDL::Equal(joint_pos[j], data_->joint_pos_[point][j])
+					|| !KDL::Equal(joint_axis[j], data_->joint_axis_[point][j]))
+				ROS_ERROR("Partial FK mismatch at point %d joint %d", point, j);
+		}
+#endif
+	}
+	else
+	{
+		data_->fk_solver_.JntToCartFull(data_->kdl_joint_array_,
+				data_->joint_pos_[point].data(), data_->joint_axis_[point].data(),
+				data_->segment_frames_[point].data());
+		data_->segment_frames_initialized_[point] = 1;
+	}
+}
+
 void EvaluationManager::computeTrajectoryValidity()
 {
 	trajectory_validity_ = true;
@@ -844,31 +961,19 @@ void EvaluationManager::computeTrajectoryValidity()
 
 void EvaluationManager::updateCoM(int point)
 {
-	const KDL::SegmentMap& segmentMap =
-			robot_model_->getKDLTree()->getSegments();
 	// compute CoM, p_j
-	int mass_segment_index = 0;
-	data_->CoMPositions_[point] = KDL::Vector::Zero();
-	for (KDL::SegmentMap::const_iterator it = segmentMap.begin();
-			it != segmentMap.end(); ++it)
+	const ArenaArray<KDL::Frame>& segment_frames = data_->segment_frames_[point];
+	KDL::Vector com = KDL::Vector::Zero();
+	for (int i = 0; i < num_mass_segments_; ++i)
 	{
-		const KDL::Segment& segment = it->second.segment;
-		double mass = segment.getInertia().getMass();
-		if (mass == 0.0)
-			continue;
-		mass = masses_[mass_segment_index];
-
-		int sn = robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
-				segment.getName());
-		const KDL::Vector& pos = data_->segment_frames_[point][sn]
-				* segment.getInertia().getCOG();
+		const MassSegment& mass_segment = mass_segments_[i];
+		const KDL::Vector pos = segment_frames[mass_segment.segment_index_]
+				* mass_segment.cog_;
 
-		data_->CoMPositions_[point] += pos * mass;
-		data_->linkPositions_[mass_segment_index][point] = pos;
-
-		++mass_segment_index;
+		com += pos * mass_segment.mass_;
+		data_->linkPositions_[i][point] = pos;
 	}
-	data_->CoMPositions_[point] = data_->CoMPositions_[point] / total_mass_;
+	data_->CoMPositions_[point] = com / total_mass_;
 
 	if (STABILITY_COST_VERBOSE)
 	{
@@ -948,35 +1053,20 @@ void EvaluationManager::computeWrenchSum(int begin, int end)
 	}
 
 	// TODO: compute angular velocities = (cur-prev)/time
-	const KDL::SegmentMap& segment_map =
-			robot_model_->getKDLTree()->getSegments();
 	const double inv_time = 1.0 / getGroupTrajectory()->getDiscretization();
-	for (int point = safe_begin; point < safe_end; ++point)
+	for (int i = 0; i < num_mass_segments_; ++i)
 	{
-		int mass_segment_index = 0;
-		for (KDL::SegmentMap::const_iterator it = segment_map.begin();
-				it != segment_map.end(); ++it)
+		int sn = mass_segments_[i].segment_index_;
+		ArenaArray<KDL::Vector>& angular_velocities =
+				data_->linkAngularVelocities_[i];
+		for (int point = safe_begin; point < safe_end; ++point)
 		{
-			const KDL::Segment& segment = it->second.segment;
-			double mass = segment.getInertia().getMass();
-			if (mass == 0.0)
-				continue;
-			mass = masses_[mass_segment_index];
-
-			int sn =
-					robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
-							segment.getName());
-			const KDL::Vector& pos = data_->segment_frames_[point][sn]
-					* segment.getInertia().getCOG();
-			const KDL::Rotation& prev_rotation = data_->segment_frames_[point
-					- 1][sn].M;
+			const KDL::Rotation& prev_rotation =
+					data_->segment_frames_[point - 1][sn].M;
 			const KDL::Rotation& cur_rotation =
 					data_->segment_frames_[point][sn].M;
-			const KDL::Rotation& rot_diff = cur_rotation
-					* prev_rotation.Inverse();
-			data_->linkAngularVelocities_[mass_segment_index][point] =
-					rot_diff.GetRot() * inv_time;
-			++mass_segment_index;
+			angular_velocities[point] = (cur_rotation
+					* prev_rotation.Inverse()).GetRot() * inv_time;
 		}
 	}
 
@@ -985,32 +1075,31 @@ void EvaluationManager::computeWrenchSum(int begin, int end)
 	//data_->AngularMomentums_[num_points_ - 1] = KDL::Vector(0.0, 0.0, 0.0);
 	for (int point = safe_begin; point < safe_end; ++point)
 	{
-		data_->AngularMomentums_[point] = KDL::Vector(0.0, 0.0, 0.0);
+		const KDL::Vector& com = data_->CoMPositions_[point];
+		KDL::Vector angular_momentum = KDL::Vector::Zero();
 
-		int mass_segment_index = 0;
-		for (KDL::SegmentMap::const_iterator it = segment_map.begin();
-				it != segment_map.end(); ++it)
+		const ArenaArray<KDL::Frame>& segment_frames =
+				data_->segment_frames_[point];
+		for (int i = 0; i < num_mass_segments_; ++i)
 		{
-			const KDL::Segment& segment = it->second.segment;
-			double mass = segment.getInertia().getMass();
-			if (mass == 0.0)
-				continue;
-			mass = masses_[mass_segment_index];
-
-			int sn =
-					robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
-							segment.getName());
-			KDL::Vector angularVelTerm = (data_->segment_frames_[point][sn]
-					* segment.getInertia()).getRotationalInertia()
-					* data_->linkAngularVelocities_[mass_segment_index][point];
-
-			data_->AngularMomentums_[point] += mass
-					* (data_->linkPositions_[mass_segment_index][point]
-							- data_->CoMPositions_[point])
-					* data_->linkVelocities_[mass_segment_index][point]
-					+ angularVelTerm;
-			++mass_segment_index;
+			const MassSegment& mass_segment = mass_segments_[i];
+			const KDL::Frame& frame =
+					segment_frames[mass_segment.segment_index_];
+			const KDL::Vector& pos = data_->linkPositions_[i][point];
+			const KDL::Vector& w = data_->linkAngularVelocities_[i][point];
+
+			// rotational inertia of the segment about the world origin, as given by
+			// (frame * segment inertia).getRotationalInertia():
+			// R I_cog R^T w + m (|p|^2 w - p (p . w))
+			KDL::Vector angularVelTerm = frame.M
+					* (mass_segment.cog_inertia_ * (frame.M.Inverse(w)))
+					+ mass_segment.kdl_mass_
+							* (KDL::dot(pos, pos) * w - KDL::dot(pos, w) * pos);
+
+			angular_momentum += mass_segment.mass_ * (pos - com)
+					* data_->linkVelocities_[i][point] + angularVelTerm;
 		}
+		data_->AngularMomentums_[point] = angular_momentum;
 	}
 	// compute torques
 	itomp_ca_planner::getVectorVelocities(safe_begin, safe_end - 1,
@@ -1071,72 +1160,94 @@ void EvaluationManager::computeStabilityCosts(int begin, int end)
 {
 	int safe_begin = max(full_vars_start_ + 1, begin);
 	int safe_end = min(full_vars_end_ - 1, end);
-	for (int point = safe_begin; point < safe_end; point++)
-	{
-		INIT_TIME_MEASUREMENT(10)
-		ADD_TIMER_POINT
+	if (safe_begin >= safe_end)
+		return;
 
-		double state_contact_invariant_cost = 0.0;
-		double state_physics_violation_cost = 0.0;
-		if (planning_group_->name_ != "lower_body"
-				&& planning_group_->name_ != "whole_body")
+	if (planning_group_->name_ != "lower_body"
+			&& planning_group_->name_ != "whole_body")
+	{
+		for (int point = safe_begin; point < safe_end; point++)
 		{
-			data_->stateContactInvariantCost_[point] =
-					state_contact_invariant_cost;
-			data_->statePhysicsViolationCost_[point] =
-					state_physics_violation_cost;
-			continue;
+			data_->stateContactInvariantCost_[point] = 0.0;
+			data_->statePhysicsViolationCost_[point] = 0.0;
 		}
+		return;
+	}
 
-		int num_contacts = planning_group_->getNumContacts();
-		if (num_contacts == 0)
-			return;
+	int num_contacts = planning_group_->getNumContacts();
+	if (num_contacts == 0)
+		return;
 
-		std::vector<KDL::Frame> contact_parent_frames(num_contacts);
-		std::vector<double> contact_values(num_contacts);
-		std::vector<KDL::Vector> contact_positions(num_contacts);
+	INIT_TIME_MEASUREMENT(10)
+	ADD_TIMER_POINT
+
+	std::vector<int> contact_parent_segments(num_contacts);
+	for (int i = 0; i < num_contacts; ++i)
+	{
+		KDL::SegmentMap::const_iterator it_segment_link =
+				robot_model_->getKDLTree()->getSegment(
+						planning_group_->contactPoints_[i].getLinkName());
+		it_segment_link = it_segment_link->second.parent;
+		string parent_segment_name = it_segment_link->first;
+		contact_parent_segments[i] =
+				robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
+						parent_segment_name);
+	}
+
+	// gather the inputs of all waypoints so that the contact forces of the
+	// whole window are solved in one batch
+	// [(point - safe_begin) * num_contacts + contact]
+	int num_points = safe_end - safe_begin;
+	std::vector<KDL::Frame> contact_parent_frames(num_points * num_contacts);
+	std::vector<double> contact_values(num_points * num_contacts);
+	std::vector<KDL::Vector> contact_positions(num_points * num_contacts);
+	for (int point = safe_begin; point < safe_end; point++)
+	{
+		int index = (point - safe_begin) * num_contacts;
 		for (int i = 0; i < num_contacts; ++i)
 		{
-			KDL::SegmentMap::const_iterator it_segment_link =
-					robot_model_->getKDLTree()->getSegment(
-							planning_group_->contactPoints_[i].getLinkName());
-			it_segment_link = it_segment_link->second.parent;
-			string parent_segment_name = it_segment_link->first;
-			int segment_number =
-					robot_model_->getForwardKinematicsSolver()->segmentNameToIndex(
-							parent_segment_name);
-			contact_parent_frames[i] =
-					data_->segment_frames_[point][segment_number];
+			contact_parent_frames[index + i] =
+					data_->segment_frames_[point][contact_parent_segments[i]];
 
 			planning_group_->contactPoints_[i].getPosition(point,
-					contact_positions[i], data_->segment_frames_);
+					contact_positions[index + i], data_->segment_frames_);
 		}
 
 		int phase = getGroupTrajectory()->getContactPhase(point);
 		for (int i = 0; i < num_contacts; ++i)
-			contact_values[i] = getGroupTrajectory()->getContactValue(phase, i);
+			contact_values[index + i] = getGroupTrajectory()->getContactValue(
+					phase, i);
 
 		// test
 		if (point <= full_vars_start_ || point >= full_vars_end_ - 1)
 		{
-			contact_values[0] = 10.0;
-			contact_values[1] = 10.0;
+			contact_values[index + 0] = 10.0;
+			contact_values[index + 1] = 10.0;
 		}
 		else
 		{
-			contact_values[0] = (phase + LeftLegStart) % 2 == 0 ? 10.0 : 0.0;
-			contact_values[1] = (phase + LeftLegStart) % 2 == 0 ? 0.0 : 10.0;
+			contact_values[index + 0] =
+					(phase + LeftLegStart) % 2 == 0 ? 10.0 : 0.0;
+			contact_values[index + 1] =
+					(phase + LeftLegStart) % 2 == 0 ? 0.0 : 10.0;
 		}
+	}
+
+	ADD_TIMER_POINT
 
-		ADD_TIMER_POINT
+	data_->contact_force_solver_(
+			PlanningParameters::getInstance()->getFrictionCoefficient(),
+			num_points, num_contacts, &data_->wrenchSum_[safe_begin],
+			&contact_parent_frames[0], &contact_values[0],
+			data_->contact_forces_[safe_begin].data(), &contact_positions[0]);
 
-		data_->contact_force_solver_(
-				PlanningParameters::getInstance()->getFrictionCoefficient(),
-				data_->contact_forces_[point], contact_positions,
-				data_->wrenchSum_[point], contact_values,
-				contact_parent_frames);
+	ADD_TIMER_POINT
 
-		ADD_TIMER_POINT
+	for (int point = safe_begin; point < safe_end; point++)
+	{
+		int index = (point - safe_begin) * num_contacts;
+		double state_contact_invariant_cost = 0.0;
+		double state_physics_violation_cost = 0.0;
 
 		for (int i = 0; i < num_contacts; ++i)
 		{
@@ -1147,14 +1258,14 @@ void EvaluationManager::computeStabilityCosts(int begin, int end)
 			cost += 16.0
 					* KDL::dot(data_->contactPointVelVector_[i][point],
 							data_->contactPointVelVector_[i][point]);
-			state_contact_invariant_cost += contact_values[i] * cost;
+			state_contact_invariant_cost += contact_values[index + i] * cost;
 		}
 
 		KDL::Wrench contactWrench;
 		for (int i = 0; i < num_contacts; ++i)
 		{
 			contactWrench.force += data_->contact_forces_[point][i];
-			contactWrench.torque += contact_positions[i]
+			contactWrench.torque += contact_positions[index + i]
 					* data_->contact_forces_[point][i];
 		}
 
@@ -1170,23 +1281,23 @@ void EvaluationManager::computeStabilityCosts(int begin, int end)
 					data_->CoMPositions_[point].z());
 			for (int i = 0; i < num_contacts; ++i)
 			{
-				KDL::Vector rel_pos = (contact_positions[i]
+				KDL::Vector rel_pos = (contact_positions[index + i]
 						- data_->CoMPositions_[point]);
 				KDL::Vector contact_torque = rel_pos
 						* data_->contact_forces_[point][i];
 				printf(
 						"CP %d V:%f F:(%f %f %f) RT:(%f %f %f)xF=(%f %f %f) r:(%f %f %f) p:(%f %f %f)\n",
-						i, contact_values[i],
+						i, contact_values[index + i],
 						data_->contact_forces_[point][i].x(),
 						data_->contact_forces_[point][0].y(),
 						data_->contact_forces_[point][i].z(), rel_pos.x(),
 						rel_pos.y(), rel_pos.z(), contact_torque.x(),
 						contact_torque.y(), contact_torque.z(),
-						contact_parent_frames[i].p.x(),
-						contact_parent_frames[i].p.y(),
-						contact_parent_frames[i].p.z(),
-						contact_positions[i].x(), contact_positions[i].y(),
-						contact_positions[i].z());
+						contact_parent_frames[index + i].p.x(),
+						contact_parent_frames[index + i].p.y(),
+						contact_parent_frames[index + i].p.z(),
+						contact_positions[index + i].x(), contact_positions[index + i].y(),
+						contact_positions[index + i].z());
 			}
 		}
 
@@ -1248,40 +1359,109 @@ void EvaluationManager::computeStabilityCosts(int begin, int end)
 
 		data_->stateContactInvariantCost_[point] = state_contact_invariant_cost;
 		data_->statePhysicsViolationCost_[point] = state_physics_violation_cost;
+	}
 
-ADD_TIMER_POINT	UPDATE_TIME
+	ADD_TIMER_POINT
+	UPDATE_TIME
 	PRINT_TIME(stability, 10000)
 }
 
-}
-
 void EvaluationManager::computeCollisionCosts(int begin, int end)
 {
+	if (signed_distance_field_)
+	{
+		computeSignedDistanceCollisionCosts(begin, end);
+		return;
+	}
+
 	int num_all_joints = data_->kinematic_state_[0]->getVariableCount();
 
-	int num_threads = getNumParallelThreads();
+	// one robot state and result buffer per thread, sized by ThreadBudget
+	int num_threads = data_->kinematic_state_.size();
 
 	collision_detection::CollisionRequest collision_request;
 	collision_request.verbose = false;
 	collision_request.contacts = true;
 	collision_request.max_contacts = 1000;
 
-	std::vector<collision_detection::CollisionResult> collision_result(
-			num_threads);
-	std::vector<std::vector<double> > positions(num_threads);
+	std::vector<collision_detection::CollisionResult>& collision_result =
+			data_->collision_results_;
+	std::vector<std::vector<double> >& positions = data_->collision_positions_;
 
-	for (int i = 0; i < num_threads; ++i)
-	{
-		positions[i].resize(num_all_joints);
-	}
+	bool use_collision_cache = PlanningParameters::getInstance()->getUseCollisionCache();
 
 	int safe_begin = max(0, begin);
 	int safe_end = min(num_points_, end);
-#pragma omp parallel for
+#pragma omp parallel for num_threads(num_threads)
 	for (int i = safe_begin; i < safe_end; ++i)
 	{
+		const ArenaArray<KDL::Frame>& segment_frames = data_->segment_frames_[i];
 		int thread_num = omp_get_thread_num();
 
+		// the pairs which cannot move while planning the group are queried once,
+		// the cache, the prefilter and the query below only handle the moving pairs
+		double static_depth = 0.0;
+		if (collision_cost_query_)
+		{
+			double& static_collision_depth =
+					data_->static_collision_depths_[i];
+			if (static_collision_depth < 0.0)
+				static_collision_depth =
+						collision_cost_query_->computeStaticDepthSum(
+								segment_frames,
+								data_->collision_workspaces_[thread_num]);
+			static_depth = static_collision_depth;
+		}
+		bool static_collision = (static_depth > 0.0);
+
+		// links moved less than half of the clearance of the last free result
+		if (use_collision_cache
+				&& data_->collision_cache_.isCollisionFree(i, segment_frames))
+		{
+			data_->state_is_in_collision_[i] = static_collision;
+			data_->stateCollisionCost_[i] = static_depth;
+			continue;
+		}
+
+		// states whose link spheres are apart from everything skip the narrow phase
+		double clearance = 0.0;
+		if (collision_prefilter_
+				&& !collision_prefilter_->isCollisionPossible(segment_frames,
+						use_collision_cache ? &clearance : NULL))
+		{
+			data_->state_is_in_collision_[i] = static_collision;
+			data_->stateCollisionCost_[i] = static_depth;
+			if (use_collision_cache)
+				data_->collision_cache_.setCollisionFree(i, segment_frames,
+						clearance);
+			continue;
+		}
+
+		if (collision_cost_query_)
+		{
+			CollisionCostWorkspace& workspace =
+					data_->collision_workspaces_[thread_num];
+			data_->stateCollisionCost_[i] = static_depth
+					+ collision_cost_query_->computeDepthSum(segment_frames,
+							workspace);
+			data_->state_is_in_collision_[i] = static_collision
+					|| (workspace.num_colliding_pairs_ > 0);
+			if (use_collision_cache)
+			{
+				if (workspace.num_colliding_pairs_ == 0)
+					data_->collision_cache_.setCollisionFree(i, segment_frames,
+							collision_cost_query_->computeMinDistance(workspace,
+									PlanningParameters::getInstance()->getCollisionCacheMaxClearance()));
+				else
+					data_->collision_cache_.invalidate(i);
+			}
+			continue;
+		}
+
+		// the planning scene checks give no clearance to cache
+		if (use_collision_cache)
+			data_->collision_cache_.invalidate(i);
+
 		double depthSum = 0.0;
 
 		int full_traj_index = getGroupTrajectory()->getFullTrajectoryIndex(i);
@@ -1298,6 +1478,7 @@ void EvaluationManager::computeCollisionCosts(int begin, int end)
 
 		const collision_detection::CollisionResult::ContactMap& contact_map =
 				collision_result[thread_num].contacts;
+		data_->state_is_in_collision_[i] = !contact_map.empty();
 		for (collision_detection::CollisionResult::ContactMap::const_iterator it =
 				contact_map.begin(); it != contact_map.end(); ++it)
 		{
@@ -1307,96 +1488,252 @@ void EvaluationManager::computeCollisionCosts(int begin, int end)
 
 			// for debug
 			//ROS_INFO("[%d] Collision between %s and %s : %f", i, contact.body_name_1.c_str(), contact.body_name_2.c_str(), contact.depth);
-
-			last_trajectory_collision_free_ = false;
 		}
 		collision_result[thread_num].clear();
 		data_->stateCollisionCost_[i] = depthSum;
 	}
 }
 
-std::vector<double> computeFTR(const std::string& group_name,
-		int contact_point_index, int begin, int end, const EvaluationData* data,
-		const ItompPlanningGroup * planning_group)
+void EvaluationManager::computeSignedDistanceCollisionCosts(int begin, int end)
 {
-	std::vector<double> positions, trajectory_ftrs;
-	int num_joints = data->getFullTrajectory()->getNumJoints();
-	positions.resize(num_joints);
-	for (int i = begin; i < end; ++i)
+	// CHOMP obstacle cost of each sphere with the clearance epsilon:
+	// c(d) = -d + epsilon / 2 for d < 0, (d - epsilon)^2 / (2 epsilon) for d < epsilon
+	const double epsilon = PlanningParameters::getInstance()->getCollisionClearance();
+	const std::vector<CollisionSphere>& spheres =
+			link_sphere_model_.getSpheres();
+	int num_spheres = spheres.size();
+
+	int safe_begin = max(0, begin);
+	int safe_end = min(num_points_, end);
+	for (int i = safe_begin; i < safe_end; ++i)
+	{
+		const ArenaArray<KDL::Frame>& segment_frames =
+				data_->segment_frames_[i];
+		ArenaArray<KDL::Vector>& gradients =
+				data_->collision_sphere_gradients_[i];
+
+		double cost = 0.0;
+		bool in_collision = false;
+		for (int s = 0; s < num_spheres; ++s)
+		{
+			const CollisionSphere& sphere = spheres[s];
+			KDL::Vector center = segment_frames[sphere.segment_index_]
+					* sphere.center_;
+
+			KDL::Vector distance_gradient;
+			double distance = signed_distance_field_->getDistance(center,
+					distance_gradient) - sphere.radius_;
+
+			if (distance < 0.0)
+			{
+				in_collision = true;
+				cost += -distance + 0.5 * epsilon;
+				gradients[s] = -1.0 * distance_gradient;
+			}
+			else if (distance < epsilon)
+			{
+				double diff = distance - epsilon;
+				cost += 0.5 * diff * diff / epsilon;
+				gradients[s] = (diff / epsilon) * distance_gradient;
+			}
+			else
+				gradients[s] = KDL::Vector::Zero();
+		}
+
+		// penetration depths of the self collision pairs, the static pairs once
+		// per waypoint as in computeCollisionCosts
+		if (collision_cost_query_)
+		{
+			CollisionCostWorkspace& workspace =
+					data_->collision_workspaces_[0];
+			double& static_collision_depth =
+					data_->static_collision_depths_[i];
+			if (static_collision_depth < 0.0)
+				static_collision_depth =
+						collision_cost_query_->computeStaticDepthSum(
+								segment_frames, workspace);
+			cost += static_collision_depth
+					+ collision_cost_query_->computeDepthSum(segment_frames,
+							workspace);
+			in_collision = in_collision || (static_collision_depth > 0.0)
+					|| (workspace.num_colliding_pairs_ > 0);
+		}
+
+		data_->state_is_in_collision_[i] = in_collision;
+		data_->stateCollisionCost_[i] = cost;
+	}
+}
+
+void EvaluationManager::initializeCollisionGradientChains()
+{
+	const KDL::Tree* tree = robot_model_->getKDLTree();
+	const std::vector<CollisionLink>& links = link_sphere_model_.getLinks();
+
+	segment_chains_.clear();
+	segment_chains_.resize(tree->getNrOfSegments());
+	for (int l = 0; l < links.size(); ++l)
 	{
-		int full_traj_index =
-				data->getGroupTrajectory()->getFullTrajectoryIndex(i);
-		double cost = 0;
-		for (std::size_t k = 0; k < num_joints; k++)
+		const CollisionLink& link = links[l];
+		std::vector<ChainJoint>& chain = segment_chains_[link.segment_index_];
+		chain.clear();
+
+		KDL::SegmentMap::const_iterator it = tree->getSegment(link.name_);
+		if (it == tree->getSegments().end())
+			continue;
+		for (; it != tree->getRootSegment(); it = it->second.parent)
 		{
-			positions[k] = (*data->getFullTrajectory())(full_traj_index, k);
+			const KDL::Joint& joint = it->second.segment.getJoint();
+			if (joint.getType() == KDL::Joint::None)
+				continue;
+			for (int j = 0; j < num_joints_; ++j)
+			{
+				if (group_joint_to_kdl_joint_index_[j] != it->second.q_nr)
+					continue;
+				ChainJoint chain_joint;
+				chain_joint.kdl_joint_ = it->second.q_nr;
+				chain_joint.group_joint_ = j;
+				chain_joint.is_prismatic_ = (joint.getType() >= KDL::Joint::TransAxis);
+				chain.push_back(chain_joint);
+			}
 		}
-		data->kinematic_state_[0]->setVariablePositions(&positions[0]);
-		robot_model::RobotModelConstPtr robot_model_ptr =
-				data->getItompRobotModel()->getRobotModel();
-		Eigen::MatrixXd jacobianFull = (data->kinematic_state_[0]->getJacobian(
-				robot_model_ptr->getJointModelGroup(group_name)));
-		Eigen::MatrixXd jacobian = jacobianFull.block(0, 0, 3,
-				jacobianFull.cols());
-		Eigen::MatrixXd jacobian_transpose = jacobian.transpose();
-
-		// computing direction, first version as COM velocity between poses
-		const KDL::Vector& dir_kdl =
-				data->contact_forces_[i][contact_point_index];
-		Eigen::Vector3d direction(dir_kdl.x(), dir_kdl.y(), dir_kdl.z());
-		if (direction.norm() != 0)
+	}
+}
+
+void EvaluationManager::computeCollisionCostGradient(
+		Eigen::MatrixXd& gradient) const
+{
+	// chain rule through the sphere centers, d(center) / dq is the
+	// Jacobian column of the joint at the center
+	gradient = Eigen::MatrixXd::Zero(num_points_, num_joints_);
+	if (!signed_distance_field_)
+		return;
+
+	const std::vector<CollisionSphere>& spheres =
+			link_sphere_model_.getSpheres();
+	int num_spheres = spheres.size();
+	for (int i = full_vars_start_ + 1; i < full_vars_end_ - 1; ++i)
+	{
+		const ArenaArray<KDL::Frame>& segment_frames =
+				data_->segment_frames_[i];
+		const ArenaArray<KDL::Vector>& gradients =
+				data_->collision_sphere_gradients_[i];
+		for (int s = 0; s < num_spheres; ++s)
 		{
-			direction.normalize();
-			double ftr = 1
-					/ std::sqrt(
-							direction.transpose()
-									* (jacobian * jacobian_transpose)
-									* direction);
-			KDL::Vector position, unused, normal;
-			planning_group->contactPoints_[contact_point_index].getPosition(i,
-					position, data->segment_frames_);
-			GroundManager::getInstance().getNearestGroundPosition(position,
-					unused, normal, data->planning_scene_); // TODO get more accurate normal
-			Eigen::Vector3d normalEigen(normal.x(), normal.y(), normal.z());
-			double contact_variable =
-					data->getGroupTrajectory()->getContactTrajectory()(
-							i
-									/ data->getGroupTrajectory()->getContactPhaseStride(),
-							contact_point_index);
-
-			ftr *= -direction.dot(normalEigen);
-			// bound value btw -10 and 10, then 0 and 1
-			ftr = (ftr < -10) ? -10 : ftr;
-			ftr = (ftr > 10) ? 10 : ftr;
-			ftr = (ftr + 10) / 20;
-			cost = dir_kdl.Norm() - ftr;
-			cost = (cost < 0) ? 0 : cost;
+			const KDL::Vector& sphere_gradient = gradients[s];
+			if (sphere_gradient == KDL::Vector::Zero())
+				continue;
+
+			const CollisionSphere& sphere = spheres[s];
+			KDL::Vector center = segment_frames[sphere.segment_index_]
+					* sphere.center_;
+			const std::vector<ChainJoint>& chain =
+					segment_chains_[sphere.segment_index_];
+			for (int j = 0; j < chain.size(); ++j)
+			{
+				const ChainJoint& joint = chain[j];
+				const KDL::Vector& axis =
+						data_->joint_axis_[i][joint.kdl_joint_];
+				if (joint.is_prismatic_)
+					gradient(i, joint.group_joint_) += KDL::dot(sphere_gradient,
+							axis);
+				else
+					gradient(i, joint.group_joint_) += KDL::dot(sphere_gradient,
+							axis
+									* (center
+											- data_->joint_pos_[i][joint.kdl_joint_]));
+			}
 		}
-		trajectory_ftrs.push_back(cost);
 	}
-	return trajectory_ftrs;
+}
+
+void EvaluationManager::computeJacobians(int begin, int end)
+{
+	if (jacobian_solver_.getNumGroups() == 0)
+		return;
+
+	int safe_begin = max(0, begin);
+	int safe_end = min(num_points_, end);
+	jacobian_solver_.computeJacobians(safe_begin, safe_end, data_->joint_pos_,
+			data_->joint_axis_, data_->segment_frames_, data_->jacobians_);
+}
+
+double EvaluationManager::computeFTR(int point, int contact_point_index,
+		int jacobian_group) const
+{
+	// reads the contact forces of the stability stage
+	const KDL::Vector& dir_kdl =
+			data_->contact_forces_[point][contact_point_index];
+	Eigen::Vector3d direction(dir_kdl.x(), dir_kdl.y(), dir_kdl.z());
+	if (direction.norm() == 0)
+		return 0.0;
+	direction.normalize();
+
+	JacobianSolver::ConstJacobian jacobian = jacobian_solver_.getJacobian(
+			data_->jacobians_, point, jacobian_group);
+	Eigen::Matrix3d jacobian_jacobian_transpose = jacobian.topRows(3)
+			* jacobian.topRows(3).transpose();
+	double ftr = 1
+			/ std::sqrt(
+					direction.transpose() * jacobian_jacobian_transpose
+							* direction);
+
+	KDL::Vector position, unused, normal;
+	planning_group_->contactPoints_[contact_point_index].getPosition(point,
+			position, data_->segment_frames_);
+	GroundManager::getInstance().getNearestGroundPosition(position, unused,
+			normal, data_->planning_scene_); // TODO get more accurate normal
+	Eigen::Vector3d normalEigen(normal.x(), normal.y(), normal.z());
+
+	ftr *= -direction.dot(normalEigen);
+	// bound value btw -10 and 10, then 0 and 1
+	ftr = (ftr < -10) ? -10 : ftr;
+	ftr = (ftr > 10) ? 10 : ftr;
+	ftr = (ftr + 10) / 20;
+	double cost = dir_kdl.Norm() - ftr;
+	return (cost < 0) ? 0 : cost;
 }
 
 void EvaluationManager::computeFTRs(int begin, int end)
 {
 	int safe_begin = max(0, begin);
 	int safe_end = min(num_points_, end);
-	std::vector<double> left_leg_cost = computeFTR("left_leg", 0, safe_begin,
-			safe_end, data_, planning_group_);
-	std::vector<double> right_leg_cost = computeFTR("right_leg", 1, safe_begin,
-			safe_end, data_, planning_group_);
-	std::vector<double> left_arm_cost = computeFTR("left_arm", 2, safe_begin,
-			safe_end, data_, planning_group_);
-	std::vector<double> right_arm_cost = computeFTR("right_arm", 3, safe_begin,
-			safe_end, data_, planning_group_);
-	for (unsigned int i = safe_begin; i < safe_end; ++i)
+
+	// the limbs whose contact point and Jacobian exist, with the weights of the legs
+	// and the arms
+	int limbs[NUM_FTR_GROUPS];
+	int jacobian_groups[NUM_FTR_GROUPS];
+	double weights[NUM_FTR_GROUPS];
+	int num_limbs = 0;
+	int num_contact_points = min((int) planning_group_->contactPoints_.size(),
+			num_contacts_);
+	for (int i = 0; i < NUM_FTR_GROUPS && i < num_contact_points; ++i)
+	{
+		int jacobian_group = jacobian_solver_.getGroupIndex(FTR_GROUP_NAMES[i]);
+		if (jacobian_group == -1)
+			continue;
+		limbs[num_limbs] = i;
+		jacobian_groups[num_limbs] = jacobian_group;
+		weights[num_limbs] = (i < 2) ? 1.0 : 0.5;
+		++num_limbs;
+	}
+
+	if (num_limbs == 0)
 	{
-		int v_index = i - safe_begin;
-		data_->stateFTRCost_[i] = (left_leg_cost[v_index]
-				+ right_leg_cost[v_index])
-				+ 0.5 * (left_arm_cost[v_index] + right_arm_cost[v_index]);
+		for (int i = safe_begin; i < safe_end; ++i)
+			data_->stateFTRCost_[i] = 0.0;
+		return;
 	}
 
+	// waypoints are independent, each thread writes the costs of its own waypoints
+	int num_threads = ThreadBudget::getInstance()->getNumWaypointThreads();
+#pragma omp parallel for num_threads(num_threads)
+	for (int i = safe_begin; i < safe_end; ++i)
+	{
+		double cost = 0.0;
+		for (int l = 0; l < num_limbs; ++l)
+			cost += weights[l] * computeFTR(i, limbs[l], jacobian_groups[l]);
+		data_->stateFTRCost_[i] = cost;
+	}
 }
 
 void EvaluationManager::printDebugInfo()
@@ -1758,61 +2095,36 @@ void EvaluationManager::getJointIndex(int& groupIndex, int& kdlIndex, int joint,
 
 void EvaluationManager::computeSingularityCosts(int begin, int end)
 {
-	const string group_name = planning_group_->name_;
-
 	if (PlanningParameters::getInstance()->getSingularityCostWeight() == 0.0)
 		return;
 
-	return;
+	int jacobian_group = jacobian_solver_.getGroupIndex(planning_group_->name_);
+	if (jacobian_group == -1)
+		return;
+
+	// hinge on the smallest singular value of the planning group Jacobian
+	const double threshold =
+			PlanningParameters::getInstance()->getSingularityThreshold();
 
 	double min_singular_value = std::numeric_limits<double>::max();
 	int min_singular_value_index = begin;
 
-	std::vector<double> positions;
-	int num_joints = data_->getFullTrajectory()->getNumJoints();
-	positions.resize(num_joints);
-	for (int i = begin; i < end; ++i)
+	int safe_begin = max(0, begin);
+	int safe_end = min(num_points_, end);
+	for (int i = safe_begin; i < safe_end; ++i)
 	{
-		data_->stateSingularityCost_[i] = 0.0;
+		double value = JacobianSolver::computeMinSingularValue(
+				jacobian_solver_.getJacobian(data_->jacobians_, i,
+						jacobian_group), data_->singularity_bases_[i]);
 
-		int full_traj_index =
-				data_->getGroupTrajectory()->getFullTrajectoryIndex(i);
-		double cost = 0;
-		for (std::size_t k = 0; k < num_joints; k++)
+		double cost = 0.0;
+		if (value < threshold)
 		{
-			positions[k] = (*data_->getFullTrajectory())(full_traj_index, k);
+			double diff = (threshold - value) / threshold;
+			cost = diff * diff;
 		}
-		int sz = data_->kinematic_state_[0]->getVariableCount();
-		data_->kinematic_state_[0]->setVariablePositions(&positions[0]);
-		data_->kinematic_state_[0]->update();
-		robot_model::RobotModelConstPtr robot_model_ptr =
-				data_->getItompRobotModel()->getRobotModel();
-
-		const moveit::core::JointModelGroup* jmg =
-				robot_model_ptr->getJointModelGroup(group_name);
-		Eigen::MatrixXd jacobianFull = (data_->kinematic_state_[0]->getJacobian(
-				jmg));
-
-		int rows2 = jacobianFull.rows();
-		cout << jacobianFull << endl;
-		for (int k = 0; k < num_joints; ++k)
-			printf("%f ", positions[k]);
-		printf("\n");
-
-		Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobianFull);
-		cout << svd.singularValues() << endl;
-
-		/*
-		 printf("[%d] svd values : ", i);
-		 for (int j = 0; j < svd.singularValues().rows(); ++j)
-		 {
-		 printf("%f ", svd.singularValues()(j));
-		 }
-		 printf("\n");
-		 */
+		data_->stateSingularityCost_[i] = cost;
 
-		int rows = svd.singularValues().rows();
-		double value = (rows == 0 ? 0.0 : svd.singularValues()(rows - 1));
 		if (value < min_singular_value)
 		{
 			min_singular_value = value;
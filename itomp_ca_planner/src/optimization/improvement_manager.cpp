@@ -42,7 +42,8 @@ namespace itomp_ca_planner
 {
 
 ImprovementManager::ImprovementManager() :
-    last_planning_parameter_index_(-1)
+    evaluation_manager_(NULL), worker_pool_(NULL), last_planning_parameter_index_(-1), num_rollout_evaluations_(0),
+        num_skipped_rollout_evaluations_(0)
 {
 
 }
@@ -52,9 +53,10 @@ ImprovementManager::~ImprovementManager()
 
 }
 
-void ImprovementManager::initialize(EvaluationManager *evaluation_manager)
+void ImprovementManager::initialize(EvaluationManager *evaluation_manager, WorkerPool *worker_pool)
 {
   evaluation_manager_ = evaluation_manager;
+  worker_pool_ = worker_pool;
 }
 
 bool ImprovementManager::updatePlanningParameters()
@@ -37,9 +37,11 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 */
 #include <itomp_ca_planner/optimization/improvement_manager_chomp.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
+#include <itomp_ca_planner/util/thread_budget.h>
 #include <itomp_ca_planner/util/differentiation_rules.h>
 #include <itomp_ca_planner/model/itomp_robot_joint.h>
 #include <Eigen/LU>
+#include <boost/bind.hpp>
 #include <iostream>
 
 using namespace Eigen;
@@ -47,7 +49,8 @@ using namespace Eigen;
 namespace itomp_ca_planner
 {
 
-ImprovementManagerChomp::ImprovementManagerChomp()
+ImprovementManagerChomp::ImprovementManagerChomp() :
+    num_rollout_threads_(1), next_rollout_(0)
 {
 
 }
@@ -105,6 +108,7 @@ bool ImprovementManagerChomp::updatePlanningParameters()
   initializeCosts();
   initializeNoiseGenerators();
   initializeRollouts();
+  initializeRolloutEvaluators();
 
   preAllocateTempVariables();
 
@@ -117,6 +121,7 @@ void ImprovementManagerChomp::initializeRollouts()
   num_rollouts_reused_ = PlanningParameters::getInstance()->getNumReusedRollouts();
   num_rollouts_extra_ = 1;
   num_rollouts_gen_ = 0;
+  num_rollouts_noiseless_ = 0;
   if (num_rollouts_reused_ >= num_rollouts_)
   {
     ROS_ERROR("Number of reused rollouts must be strictly less than number of rollouts.");
@@ -169,79 +174,73 @@ void ImprovementManagerChomp::initializeRollouts()
   rollouts_reused_next_ = false;
   extra_rollouts_added_ = false;
   rollout_cost_sorter_.reserve(num_rollouts_);
+  rollouts_to_evaluate_.reserve(num_rollouts_);
 
   rollout_costs_ = Eigen::MatrixXd::Zero(num_rollouts_, num_time_steps_);
   tmp_rollout_cost_ = Eigen::VectorXd::Zero(num_time_steps_);
 }
 
+void ImprovementManagerChomp::initializeRolloutEvaluators()
+{
+  num_rollout_threads_ = std::min(ThreadBudget::getInstance()->getNumRolloutThreads(), num_rollouts_);
+  if (num_rollout_threads_ < 1)
+    num_rollout_threads_ = 1;
+
+  rollout_evaluation_managers_.clear();
+  rollout_data_.clear();
+  tmp_rollout_costs_.clear();
+  if (num_rollout_threads_ == 1)
+    return;
+
+  // each worker evaluates rollouts on its own copy of the trajectories, FK solver and robot states
+  for (int i = 0; i < num_rollout_threads_; ++i)
+  {
+    EvaluationDataPtr data(evaluation_manager_->getDefaultData().clone());
+    EvaluationManagerPtr evaluation_manager(new EvaluationManager(*evaluation_manager_));
+    evaluation_manager->setData(data.get());
+    evaluation_manager->print_debug_texts_ = false;
+
+    rollout_data_.push_back(data);
+    rollout_evaluation_managers_.push_back(evaluation_manager);
+    tmp_rollout_costs_.push_back(VectorXd::Zero(num_time_steps_));
+  }
+}
+
 void ImprovementManagerChomp::initializeCosts()
 {
   control_cost_weight_ = PlanningParameters::getInstance()->getSmoothnessCostWeight();
 
+  // the rule i is scaled by 1 / discretization^(i + 1)
   double multiplier = 1.0;
-  differentiation_matrices_.clear();
-  differentiation_matrices_.resize(NUM_DIFF_RULES, MatrixXd::Zero(num_vars_all_, num_vars_all_));
-  for (int d = 0; d < NUM_DIFF_RULES; ++d)
+  diff_rule_weights_.resize(NUM_DIFF_RULES);
+  for (int i = 0; i < NUM_DIFF_RULES; ++i)
   {
     multiplier /= PlanningParameters::getInstance()->getTrajectoryDiscretization();
-    for (int i = 0; i < num_vars_all_; i++)
-    {
-      for (int j = -DIFF_RULE_LENGTH / 2; j <= DIFF_RULE_LENGTH / 2; j++)
-      {
-        int index = i + j;
-        if (index < 0)
-          continue;
-        if (index >= num_vars_all_)
-          continue;
-        differentiation_matrices_[d](i, index) = multiplier * DIFF_RULES[d][j + DIFF_RULE_LENGTH / 2];
-      }
-    }
-    //ROS_INFO_STREAM(differentiation_matrices_[d]);
+    diff_rule_weights_[i] = PlanningParameters::getInstance()->getSmoothnessCosts()[i] * multiplier * multiplier;
   }
 
-  control_costs_all_.clear();
-  control_costs_.clear();
-  inv_control_costs_.clear();
-  for (int d = 0; d < num_dimensions_; ++d)
-  {
-    // construct the quadratic cost matrices (for all variables)
-    MatrixXd cost_all = MatrixXd::Identity(num_vars_all_, num_vars_all_)
-        * PlanningParameters::getInstance()->getRidgeFactor();
-    for (int i = 0; i < NUM_DIFF_RULES; ++i)
-    {
-      cost_all += PlanningParameters::getInstance()->getSmoothnessCosts()[i]
-          * (differentiation_matrices_[i].transpose() * differentiation_matrices_[i]);
-    }
-    control_costs_all_.push_back(cost_all);
-
-    // extract the quadratic cost just for the free variables:
-    MatrixXd cost_free = cost_all.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free_, num_vars_free_);
-    control_costs_.push_back(cost_free);
-
-    inv_control_costs_.push_back(cost_free.fullPivLu().inverse());
-  }
+  // the control cost of the free variables is the band matrix
+  // ridge * I + sum_i w_i * D_i^T * D_i restricted to the free block
+  MatrixXd cost_band = MatrixXd::Zero(DIFF_RULE_LENGTH, num_vars_free_);
+  cost_band.row(0).setConstant(PlanningParameters::getInstance()->getRidgeFactor());
+  for (int i = 0; i < NUM_DIFF_RULES; ++i)
+    addDiffRuleGramBand(DIFF_RULES[i], diff_rule_weights_[i], num_vars_all_, free_vars_start_index_, cost_band);
+  if (!control_cost_cholesky_.compute(cost_band))
+    ROS_ERROR("Control cost matrix is not positive definite");
 
+  // the smooth projection is inv(control_cost) with each column p scaled by
+  // 1 / (num_time_steps * max_p), which is applied as a banded solve of the scaled vector
   ROS_INFO("Precomputing projection matrices..");
-  projection_matrix_.resize(num_dimensions_);
-  for (int d = 0; d < num_dimensions_; ++d)
+  projection_scales_ = VectorXd::Ones(num_vars_free_);
+  if (use_smooth_noises_)
   {
-    if (use_smooth_noises_)
+    VectorXd column(num_vars_free_);
+    for (int p = 0; p < num_time_steps_; ++p)
     {
-      projection_matrix_[d] = inv_control_costs_[d];
-      for (int p = 0; p < num_time_steps_; ++p)
-      {
-        double column_max = inv_control_costs_[d](0, p);
-        for (int p2 = 1; p2 < num_time_steps_; ++p2)
-        {
-          if (inv_control_costs_[d](p2, p) > column_max)
-            column_max = inv_control_costs_[d](p2, p);
-        }
-        projection_matrix_[d].col(p) *= (1.0 / (num_time_steps_ * column_max));
-      }
-    }
-    else
-    {
-      projection_matrix_[d].setIdentity(inv_control_costs_[d].rows(), inv_control_costs_[d].cols());
+      column.setZero();
+      column(p) = 1.0;
+      control_cost_cholesky_.solveInPlace(column);
+      projection_scales_(p) = 1.0 / (num_time_steps_ * column.maxCoeff());
     }
   }
   ROS_INFO("Done precomputing projection matrices.");
@@ -249,10 +248,11 @@ void ImprovementManagerChomp::initializeCosts()
 
 void ImprovementManagerChomp::initializeNoiseGenerators()
 {
-  // invert the control costs, initialize noise generators:
+  // the noise covariance is the inverse of the control cost
+  noise_generators_.clear();
   for (int d = 0; d < num_dimensions_; ++d)
   {
-    MultivariateGaussian mvg(VectorXd::Zero(num_time_steps_), inv_control_costs_[d]);
+    BandedMultivariateGaussian mvg(VectorXd::Zero(num_time_steps_), control_cost_cholesky_);
     noise_generators_.push_back(mvg);
   }
   contact_noise_generators_.clear();
@@ -275,7 +275,7 @@ bool ImprovementManagerChomp::preAllocateTempVariables()
   {
     tmp_noise_.push_back(VectorXd::Zero(num_time_steps_));
     tmp_parameters_.push_back(VectorXd::Zero(num_time_steps_));
-    parameter_updates_.push_back(MatrixXd::Zero(num_time_steps_, num_time_steps_));
+    parameter_updates_.push_back(VectorXd::Zero(num_time_steps_));
     time_step_weights_.push_back(VectorXd::Zero(num_time_steps_));
   }
   for (int d = 0; d < num_contact_dimensions_; ++d)
@@ -286,6 +286,9 @@ bool ImprovementManagerChomp::preAllocateTempVariables()
   tmp_max_cost_ = VectorXd::Zero(num_time_steps_);
   tmp_min_cost_ = VectorXd::Zero(num_time_steps_);
   tmp_sum_rollout_probabilities_ = VectorXd::Zero(num_time_steps_);
+  tmp_control_parameters_ = MatrixXd::Zero(num_vars_all_, num_dimensions_);
+  tmp_control_derivatives_ = MatrixXd::Zero(num_vars_all_, num_dimensions_);
+  tmp_control_costs_ = MatrixXd::Zero(num_vars_all_, num_dimensions_);
 
   return true;
 }
@@ -299,7 +302,7 @@ void ImprovementManagerChomp::runSingleIteration(int iteration)
   noise.resize(num_dimensions_);
   for (int i = 0; i < num_dimensions_; ++i)
   {
-    noise[i] = noise_stddev_[i] * pow(noise_decay_, iteration);
+    noise[i] = getNoiseStddev(i, iteration);
   }
   std::vector<double> contact_noise;
   contact_noise.resize(num_contact_dimensions_);
@@ -313,13 +316,7 @@ void ImprovementManagerChomp::runSingleIteration(int iteration)
   // get rollouts and execute them
   generateRollouts(noise, contact_noise);
 
-  for (unsigned int r = 0; r < rollouts_.size(); ++r)
-  {
-    evaluation_manager_->setTrajectory(rollouts_[r].parameters_, rollouts_[r].contact_parameters_);
-    //evaluation_manager_->evaluate(rollouts_[r].parameters_, rollouts_[r].contact_parameters_, tmp_rollout_cost_);
-    evaluation_manager_->evaluate(tmp_rollout_cost_);
-    rollout_costs_.row(r) = tmp_rollout_cost_.transpose();
-  }
+  evaluateRollouts();
   /*
   Eigen::VectorXd costs(rollouts_.size());
   for (int i = 0; i < rollouts_.size(); ++i)
@@ -347,6 +344,77 @@ void ImprovementManagerChomp::runSingleIteration(int iteration)
   //evaluation_manager_->getFullTrajectoryConst()->printTrajectory();
 }
 
+void ImprovementManagerChomp::evaluateRollouts()
+{
+  // reused rollouts keep the state costs of their earlier evaluation
+  rollouts_to_evaluate_.clear();
+  for (int r = 0; r < num_rollouts_; ++r)
+  {
+    if (!rollouts_[r].state_costs_valid_)
+      rollouts_to_evaluate_.push_back(r);
+  }
+  int num_rollouts = rollouts_to_evaluate_.size();
+  num_rollout_evaluations_ += num_rollouts;
+  num_skipped_rollout_evaluations_ += num_rollouts_ - num_rollouts;
+
+  if (num_rollout_threads_ == 1)
+  {
+    for (int i = 0; i < num_rollouts; ++i)
+    {
+      int r = rollouts_to_evaluate_[i];
+      evaluation_manager_->setTrajectory(rollouts_[r].parameters_, rollouts_[r].contact_parameters_);
+      //evaluation_manager_->evaluate(rollouts_[r].parameters_, rollouts_[r].contact_parameters_, tmp_rollout_cost_);
+      evaluation_manager_->evaluate(tmp_rollout_cost_);
+      rollout_costs_.row(r) = tmp_rollout_cost_.transpose();
+    }
+    return;
+  }
+
+  // rollout r always writes row r, so the result does not depend on the schedule
+  if (worker_pool_ != NULL)
+  {
+    // each task owns one evaluator and pulls rollouts until none is left;
+    // idle workers of the pool steal the tasks of busier trajectories
+    next_rollout_ = 0;
+    TaskGroup task_group;
+    for (int i = 0; i < num_rollout_threads_; ++i)
+      worker_pool_->submit(boost::bind(&ImprovementManagerChomp::evaluateRolloutsOnWorker, this, i), &task_group);
+    task_group.wait(worker_pool_);
+    return;
+  }
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_rollout_threads_)
+  for (int i = 0; i < num_rollouts; ++i)
+  {
+    int r = rollouts_to_evaluate_[i];
+    int thread_num = omp_get_thread_num();
+    EvaluationManager* evaluation_manager = rollout_evaluation_managers_[thread_num].get();
+    evaluation_manager->setTrajectory(rollouts_[r].parameters_, rollouts_[r].contact_parameters_);
+    evaluation_manager->evaluate(tmp_rollout_costs_[thread_num]);
+    rollout_costs_.row(r) = tmp_rollout_costs_[thread_num].transpose();
+  }
+}
+
+void ImprovementManagerChomp::evaluateRolloutsOnWorker(int worker)
+{
+  EvaluationManager* evaluation_manager = rollout_evaluation_managers_[worker].get();
+  while (true)
+  {
+    int i;
+    {
+      boost::mutex::scoped_lock lock(next_rollout_mutex_);
+      i = next_rollout_++;
+    }
+    if (i >= rollouts_to_evaluate_.size())
+      break;
+
+    int r = rollouts_to_evaluate_[i];
+    evaluation_manager->setTrajectory(rollouts_[r].parameters_, rollouts_[r].contact_parameters_);
+    evaluation_manager->evaluate(tmp_rollout_costs_[worker]);
+    rollout_costs_.row(r) = tmp_rollout_costs_[worker].transpose();
+  }
+}
+
 bool ImprovementManagerChomp::generateRollouts(const std::vector<double>& noise_stddev,
     const std::vector<double>& contact_noise_stddev)
 {
@@ -417,13 +485,14 @@ bool ImprovementManagerChomp::generateRollouts(const std::vector<double>& noise_
     }
     rollouts_reused_ = true;
   }
+  num_rollouts_noiseless_ = keep_one ? 1 : 0;
 
   // generate new rollouts
   for (int d = 0; d < num_dimensions_; ++d)
   {
     for (int r = 0; r < num_rollouts_gen_; ++r)
     {
-      noise_generators_[d].sample(tmp_noise_[d]);
+      sampleNoise(d, tmp_noise_[d]);
       if (r == 0 && keep_one)
     	  rollouts_[r].noise_[d].setZero(rollouts_[r].noise_[d].rows(), rollouts_[r].noise_[d].cols());
       else
@@ -432,6 +501,8 @@ bool ImprovementManagerChomp::generateRollouts(const std::vector<double>& noise_
       rollouts_[r].parameters_[d] = parameters_[d] + rollouts_[r].noise_[d];
     }
   }
+  for (int r = 0; r < num_rollouts_gen_; ++r)
+    rollouts_[r].state_costs_valid_ = false;
 
 
   return true;
@@ -458,31 +529,26 @@ void ImprovementManagerChomp::copyGroupTrajectory()
 
 void ImprovementManagerChomp::computeRolloutControlCost(Rollout& rollout)
 {
-  // this measures the accelerations and squares them
+  // this measures the derivatives and squares them, for all dimensions at once
   for (int d = 0; d < num_dimensions_; ++d)
   {
-    VectorXd params_all = parameters_all_[d];
-    VectorXd costs_all = VectorXd::Zero(num_vars_all_);
-
-    params_all.segment(free_vars_start_index_, num_vars_free_) = rollout.parameters_[d] + rollout.noise_projected_[d];
-    VectorXd acc_all = VectorXd::Zero(num_vars_all_);
-    for (int i = 0; i < NUM_DIFF_RULES; ++i)
-    {
-      acc_all = differentiation_matrices_[i] * params_all;
-      costs_all += control_cost_weight_ * PlanningParameters::getInstance()->getSmoothnessCosts()[i]
-          * (acc_all.cwiseProduct(acc_all));
-    }
+    tmp_control_parameters_.col(d) = parameters_all_[d];
+    tmp_control_parameters_.col(d).segment(free_vars_start_index_, num_vars_free_) = rollout.parameters_[d]
+        + rollout.noise_projected_[d];
+  }
 
-    rollout.control_costs_[d] = costs_all.segment(free_vars_start_index_, num_vars_free_);
-    /*
-    for (int i = 0; i < free_vars_start_index_; ++i)
-    {
-      rollout.control_costs_[d](0) += costs_all(i);
-      rollout.control_costs_[d](num_vars_free_ - 1) += costs_all(num_vars_all_ - (i + 1));
-    }
-    */
+  tmp_control_costs_.setZero();
+  for (int i = 0; i < NUM_DIFF_RULES; ++i)
+  {
+    if (diff_rule_weights_[i] == 0.0)
+      continue;
+    applyDiffRule(DIFF_RULES[i], tmp_control_parameters_, tmp_control_derivatives_);
+    tmp_control_costs_ += (control_cost_weight_ * diff_rule_weights_[i])
+        * tmp_control_derivatives_.cwiseProduct(tmp_control_derivatives_);
   }
 
+  for (int d = 0; d < num_dimensions_; ++d)
+    rollout.control_costs_[d] = tmp_control_costs_.col(d).segment(free_vars_start_index_, num_vars_free_);
 }
 
 bool ImprovementManagerChomp::setRolloutCosts()
@@ -492,9 +558,11 @@ bool ImprovementManagerChomp::setRolloutCosts()
     computeRolloutControlCost(rollouts_[r]);
   }
 
-  for (int r = 0; r < num_rollouts_gen_; ++r)
+  for (unsigned int i = 0; i < rollouts_to_evaluate_.size(); ++i)
   {
+    int r = rollouts_to_evaluate_[i];
     rollouts_[r].state_costs_ = rollout_costs_.row(r).transpose();
+    rollouts_[r].state_costs_valid_ = true;
   }
 
   return true;
@@ -505,6 +573,21 @@ void ImprovementManagerChomp::computeUpdates()
   computeRolloutCumulativeCosts();
   computeRolloutProbabilities();
   computeParameterUpdates();
+  adaptNoise();
+}
+
+double ImprovementManagerChomp::getNoiseStddev(int dimension, int iteration) const
+{
+  return noise_stddev_[dimension] * pow(noise_decay_, iteration);
+}
+
+void ImprovementManagerChomp::sampleNoise(int dimension, Eigen::VectorXd& noise)
+{
+  noise_generators_[dimension].sample(noise);
+}
+
+void ImprovementManagerChomp::adaptNoise()
+{
 }
 
 bool ImprovementManagerChomp::computeRolloutCumulativeCosts()
@@ -590,11 +673,11 @@ bool ImprovementManagerChomp::computeParameterUpdates()
 {
   for (int d = 0; d < num_dimensions_; ++d)
   {
-    parameter_updates_[d] = MatrixXd::Zero(num_time_steps_, num_time_steps_);
+    parameter_updates_[d].setZero();
 
     for (int r = 0; r < num_rollouts_; ++r)
     {
-      parameter_updates_[d].row(0).transpose() += rollouts_[r].noise_[d].cwiseProduct(rollouts_[r].probabilities_[d]);
+      parameter_updates_[d] += rollouts_[r].noise_[d].cwiseProduct(rollouts_[r].probabilities_[d]);
     }
 
     // reweighting the updates per time-step
@@ -604,13 +687,13 @@ bool ImprovementManagerChomp::computeParameterUpdates()
     {
       weight = time_step_weights_[d][t];
       weight_sum += weight;
-      parameter_updates_[d](0, t) *= weight;
+      parameter_updates_[d](t) *= weight;
     }
     if (weight_sum < 1e-6)
       weight_sum = 1e-6;
-    parameter_updates_[d].row(0) *= num_time_steps_ / weight_sum;
+    parameter_updates_[d] *= num_time_steps_ / weight_sum;
 
-    parameter_updates_[d].row(0).transpose() = projection_matrix_[d] * parameter_updates_[d].row(0).transpose();
+    projectInPlace(parameter_updates_[d]);
   }
 
   for (int d = 0; d < num_contact_dimensions_; ++d)
@@ -630,8 +713,7 @@ bool ImprovementManagerChomp::updateParameters()
   double divisor = 1.0;
   for (int d = 0; d < num_dimensions_; ++d)
   {
-    parameters_all_[d].segment(free_vars_start_index_, num_vars_free_).transpose() += divisor
-        * parameter_updates_[d].row(0);
+    parameters_all_[d].segment(free_vars_start_index_, num_vars_free_) += divisor * parameter_updates_[d];
   }
   for (int d = 0; d < num_contact_dimensions_; ++d)
   {
@@ -663,6 +745,7 @@ void ImprovementManagerChomp::addExtraRollout(std::vector<Eigen::VectorXd>& para
     extra_rollouts_[r].parameters_ = parameters;
     extra_rollouts_[r].contact_parameters_ = contact_parameters;
     extra_rollouts_[r].state_costs_ = costs;
+    extra_rollouts_[r].state_costs_valid_ = true;
     computeNoise(extra_rollouts_[r]);
     computeProjectedNoise(extra_rollouts_[r]);
     computeRolloutControlCost(extra_rollouts_[r]);
@@ -688,11 +771,20 @@ bool ImprovementManagerChomp::computeProjectedNoise(Rollout& rollout)
 {
   for (int d = 0; d < num_dimensions_; ++d)
   {
-    rollout.noise_projected_[d] = projection_matrix_[d] * rollout.noise_[d];
+    rollout.noise_projected_[d] = rollout.noise_[d];
+    projectInPlace(rollout.noise_projected_[d]);
     //rollout.parameters_noise_projected_[d] = rollout.parameters_[d] + rollout.noise_projected_[d];
   }
 
   return true;
 }
 
+void ImprovementManagerChomp::projectInPlace(Eigen::VectorXd& vector) const
+{
+  if (!use_smooth_noises_)
+    return;
+  vector = vector.cwiseProduct(projection_scales_);
+  control_cost_cholesky_.solveInPlace(vector);
+}
+
 }
@@ -0,0 +1,170 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/optimization/improvement_manager_cma.h>
+#include <itomp_ca_planner/util/planning_parameters.h>
+#include <cmath>
+
+using namespace Eigen;
+
+namespace itomp_ca_planner
+{
+
+// bounds of the variances of the whitened noise, relative to the prior
+static const double MIN_VARIANCE = 1e-4;
+static const double MAX_VARIANCE = 1e4;
+
+ImprovementManagerCMA::ImprovementManagerCMA()
+{
+
+}
+
+ImprovementManagerCMA::~ImprovementManagerCMA()
+{
+
+}
+
+bool ImprovementManagerCMA::updatePlanningParameters()
+{
+  if (!ImprovementManagerChomp::updatePlanningParameters())
+    return false;
+
+  // the initial distribution is the one of the first iteration of the sampler
+  sigmas_ = noise_stddev_;
+  variances_.assign(num_dimensions_, VectorXd::Ones(num_time_steps_));
+  variance_sqrts_.assign(num_dimensions_, VectorXd::Ones(num_time_steps_));
+  sigma_paths_.assign(num_dimensions_, VectorXd::Zero(num_time_steps_));
+  covariance_paths_.assign(num_dimensions_, VectorXd::Zero(num_time_steps_));
+
+  tmp_rollout_weights_ = VectorXd::Zero(num_rollouts_);
+  tmp_whitened_noise_ = VectorXd::Zero(num_time_steps_);
+  tmp_mean_step_ = VectorXd::Zero(num_time_steps_);
+  tmp_rank_mu_ = VectorXd::Zero(num_time_steps_);
+
+  return true;
+}
+
+double ImprovementManagerCMA::getNoiseStddev(int dimension, int iteration) const
+{
+  return sigmas_[dimension];
+}
+
+void ImprovementManagerCMA::sampleNoise(int dimension, Eigen::VectorXd& noise)
+{
+  noise_generators_[dimension].sample(noise, variance_sqrts_[dimension]);
+}
+
+void ImprovementManagerCMA::adaptNoise()
+{
+  // only the rollouts sampled in this iteration are samples of the current distribution
+  if (num_rollouts_gen_ - num_rollouts_noiseless_ <= 0)
+    return;
+
+  for (int d = 0; d < num_dimensions_; ++d)
+  {
+    // fixed joints have no noise
+    if (sigmas_[d] > 0.0)
+      adaptNoise(d);
+  }
+}
+
+void ImprovementManagerCMA::adaptNoise(int d)
+{
+  const double n = num_time_steps_;
+
+  // the reused rollouts and the noiseless one were not drawn from the current
+  // distribution, so the weights are renormalized over the sampled rollouts
+  const int begin = num_rollouts_noiseless_;
+  const int end = num_rollouts_gen_;
+  double weight_sum = 0.0;
+  for (int r = begin; r < end; ++r)
+  {
+    tmp_rollout_weights_(r) = rollouts_[r].probabilities_[d].mean();
+    weight_sum += tmp_rollout_weights_(r);
+  }
+  if (weight_sum <= 0.0)
+    return;
+  double squared_weight_sum = 0.0;
+  for (int r = begin; r < end; ++r)
+  {
+    tmp_rollout_weights_(r) /= weight_sum;
+    squared_weight_sum += tmp_rollout_weights_(r) * tmp_rollout_weights_(r);
+  }
+  double mu_eff = 1.0 / squared_weight_sum;
+
+  // learning rates of separable CMA-ES
+  double c_sigma = (mu_eff + 2.0) / (n + mu_eff + 5.0);
+  double d_sigma = 1.0 + 2.0 * std::max(0.0, std::sqrt((mu_eff - 1.0) / (n + 1.0)) - 1.0) + c_sigma;
+  double c_c = 4.0 / (n + 4.0);
+  double c_1 = 2.0 / ((n + 1.3) * (n + 1.3) + mu_eff) * (n + 2.0) / 3.0;
+  double c_mu = std::min(1.0 - c_1,
+      2.0 * (mu_eff - 2.0 + 1.0 / mu_eff) / ((n + 2.0) * (n + 2.0) + mu_eff) * (n + 2.0) / 3.0);
+  c_mu = std::max(0.0, c_mu);
+  double expected_norm = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+  // weighted statistics of the noise in the prior-whitened space, u = L^T noise / sigma
+  tmp_mean_step_.setZero();
+  tmp_rank_mu_.setZero();
+  for (int r = begin; r < end; ++r)
+  {
+    double weight = tmp_rollout_weights_(r);
+    tmp_whitened_noise_ = rollouts_[r].noise_[d];
+    control_cost_cholesky_.multiplyUpperInPlace(tmp_whitened_noise_);
+    tmp_whitened_noise_ /= sigmas_[d];
+    tmp_mean_step_ += weight * tmp_whitened_noise_;
+    tmp_rank_mu_ += weight * tmp_whitened_noise_.cwiseProduct(tmp_whitened_noise_);
+  }
+
+  // cumulative step-size adaptation
+  VectorXd& sigma_path = sigma_paths_[d];
+  sigma_path = (1.0 - c_sigma) * sigma_path
+      + std::sqrt(c_sigma * (2.0 - c_sigma) * mu_eff) * tmp_mean_step_.cwiseQuotient(variance_sqrts_[d]);
+  sigmas_[d] *= std::exp((c_sigma / d_sigma) * (sigma_path.norm() / expected_norm - 1.0));
+
+  // rank-one and rank-mu updates of the diagonal covariance
+  VectorXd& covariance_path = covariance_paths_[d];
+  covariance_path = (1.0 - c_c) * covariance_path + std::sqrt(c_c * (2.0 - c_c) * mu_eff) * tmp_mean_step_;
+  VectorXd& variances = variances_[d];
+  variances = (1.0 - c_1 - c_mu) * variances + c_1 * covariance_path.cwiseProduct(covariance_path)
+      + c_mu * tmp_rank_mu_;
+  for (int t = 0; t < num_time_steps_; ++t)
+    variances(t) = std::min(MAX_VARIANCE, std::max(MIN_VARIANCE, variances(t)));
+  variance_sqrts_[d] = variances.cwiseSqrt();
+}
+
+}
@@ -0,0 +1,249 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/optimization/improvement_manager_gradient.h>
+#include <itomp_ca_planner/util/planning_parameters.h>
+#include <itomp_ca_planner/util/differentiation_rules.h>
+
+using namespace Eigen;
+
+namespace itomp_ca_planner
+{
+
+// perturbation of the finite differences
+static const double FD_EPSILON = 1e-4;
+
+ImprovementManagerGradient::ImprovementManagerGradient() :
+    cost_(0.0), is_evaluated_(false), use_finite_differences_(false), step_size_(0.0), max_step_size_(0.0)
+{
+
+}
+
+ImprovementManagerGradient::~ImprovementManagerGradient()
+{
+
+}
+
+bool ImprovementManagerGradient::updatePlanningParameters()
+{
+  if (!ImprovementManager::updatePlanningParameters())
+    return false;
+
+  const ItompCIOTrajectory* group_trajectory = evaluation_manager_->getGroupTrajectoryConst();
+  const PlanningParameters* parameters = PlanningParameters::getInstance();
+
+  num_time_steps_ = parameters->getNumTimeSteps();
+  num_dimensions_ = group_trajectory->getNumJoints();
+  num_contact_dimensions_ = group_trajectory->getNumContacts();
+  free_vars_start_index_ = DIFF_RULE_LENGTH - 1;
+
+  parameters_.resize(num_dimensions_, VectorXd::Zero(num_time_steps_));
+  candidate_parameters_.resize(num_dimensions_, VectorXd::Zero(num_time_steps_));
+  directions_.resize(num_dimensions_, VectorXd::Zero(num_time_steps_));
+  contact_parameters_.resize(num_contact_dimensions_, VectorXd::Zero(group_trajectory->getNumContactPhases() - 1));
+  state_costs_ = VectorXd::Zero(num_time_steps_);
+  tmp_state_costs_ = VectorXd::Zero(num_time_steps_);
+  gradient_ = MatrixXd::Zero(num_time_steps_, num_dimensions_);
+
+  copyGroupTrajectory();
+  initializeMetric();
+
+  // the costs which are only differentiated numerically
+  use_finite_differences_ = (parameters->getStateValidityCostWeight() != 0.0
+      || parameters->getContactInvariantCostWeight() != 0.0 || parameters->getPhysicsViolationCostWeight() != 0.0
+      || parameters->getCartesianTrajectoryCostWeight() != 0.0 || parameters->getSingularityCostWeight() != 0.0
+      || parameters->getFTRCostWeight() != 0.0 || parameters->getCoMCostWeight() != 0.0
+      || parameters->getGoalPoseCostWeight() != 0.0 || parameters->getTorqueCostWeight() != 0.0
+      || (parameters->getObstacleCostWeight() != 0.0 && !evaluation_manager_->hasCollisionCostGradient()));
+
+  max_step_size_ = parameters->getGradientStepSize();
+  step_size_ = max_step_size_;
+  is_evaluated_ = false;
+
+  return true;
+}
+
+void ImprovementManagerGradient::initializeMetric()
+{
+  // the control cost matrix of ImprovementManagerChomp:
+  // ridge * I + sum_i w_i * D_i^T * D_i restricted to the free block
+  int num_vars_all = num_time_steps_ + 2 * (DIFF_RULE_LENGTH - 1);
+  double multiplier = 1.0;
+  MatrixXd metric_band = MatrixXd::Zero(DIFF_RULE_LENGTH, num_time_steps_);
+  metric_band.row(0).setConstant(PlanningParameters::getInstance()->getRidgeFactor());
+  for (int i = 0; i < NUM_DIFF_RULES; ++i)
+  {
+    multiplier /= PlanningParameters::getInstance()->getTrajectoryDiscretization();
+    double weight = PlanningParameters::getInstance()->getSmoothnessCosts()[i] * multiplier * multiplier;
+    addDiffRuleGramBand(DIFF_RULES[i], weight, num_vars_all, free_vars_start_index_, metric_band);
+  }
+  if (!metric_cholesky_.compute(metric_band))
+    ROS_ERROR("Smoothness metric is not positive definite");
+}
+
+void ImprovementManagerGradient::copyGroupTrajectory()
+{
+  const ItompCIOTrajectory* group_trajectory = evaluation_manager_->getGroupTrajectoryConst();
+  for (int d = 0; d < num_dimensions_; ++d)
+    parameters_[d] = group_trajectory->getFreeJointTrajectoryBlock(d);
+  for (int d = 0; d < num_contact_dimensions_; ++d)
+    contact_parameters_[d] = group_trajectory->getFreeContactTrajectoryBlock(d);
+}
+
+void ImprovementManagerGradient::runSingleIteration(int iteration)
+{
+  if (!is_evaluated_)
+  {
+    cost_ = evaluate(parameters_, state_costs_);
+    is_evaluated_ = true;
+  }
+
+  computeGradient();
+  computeDirections();
+
+  for (int d = 0; d < num_dimensions_; ++d)
+    candidate_parameters_[d] = parameters_[d] + step_size_ * directions_[d];
+
+  // the last evaluation of the iteration is the one the optimizer reads
+  evaluation_manager_->print_debug_texts_ = true;
+  double cost = evaluate(candidate_parameters_, tmp_state_costs_);
+  evaluation_manager_->print_debug_texts_ = false;
+
+  if (cost < cost_)
+  {
+    parameters_.swap(candidate_parameters_);
+    state_costs_.swap(tmp_state_costs_);
+    cost_ = cost;
+    is_evaluated_ = true;
+    step_size_ = std::min(2.0 * step_size_, max_step_size_);
+  }
+  else
+  {
+    is_evaluated_ = false;
+    step_size_ *= 0.5;
+  }
+}
+
+double ImprovementManagerGradient::evaluate(const std::vector<Eigen::VectorXd>& parameters,
+    Eigen::VectorXd& state_costs)
+{
+  evaluation_manager_->setTrajectory(parameters, contact_parameters_);
+  return evaluation_manager_->evaluate(state_costs);
+}
+
+void ImprovementManagerGradient::computeGradient()
+{
+  // the evaluation manager holds the evaluation of parameters_
+  const PlanningParameters* parameters = PlanningParameters::getInstance();
+  const ItompCIOTrajectory* group_trajectory = evaluation_manager_->getGroupTrajectoryConst();
+  gradient_.setZero();
+
+  double smoothness_weight = parameters->getSmoothnessCostWeight();
+  if (smoothness_weight != 0.0)
+  {
+    const std::vector<SmoothnessCost>& joint_costs = evaluation_manager_->getDefaultData().joint_costs_;
+    for (int d = 0; d < num_dimensions_; ++d)
+    {
+      tmp_joint_trajectory_ = group_trajectory->getJointTrajectory(d);
+      joint_costs[d].computeGradient(tmp_joint_trajectory_, tmp_joint_gradient_);
+      gradient_.col(d) += smoothness_weight * tmp_joint_gradient_.segment(free_vars_start_index_, num_time_steps_);
+    }
+  }
+
+  if (use_finite_differences_)
+  {
+    // covers the collision costs as well
+    computeFiniteDifferenceGradient();
+    return;
+  }
+
+  double obstacle_weight = parameters->getObstacleCostWeight();
+  if (obstacle_weight != 0.0)
+  {
+    evaluation_manager_->computeCollisionCostGradient(collision_gradient_);
+    gradient_ += obstacle_weight * collision_gradient_.middleRows(free_vars_start_index_, num_time_steps_);
+  }
+}
+
+void ImprovementManagerGradient::computeFiniteDifferenceGradient()
+{
+  // waypoints 2r + 1 apart do not share a waypoint cost, so one evaluation gives
+  // the derivatives of all of them
+  const int radius = EvaluationManager::getCostDependencyRadius();
+  const int stride = 2 * radius + 1;
+  for (int d = 0; d < num_dimensions_; ++d)
+  {
+    for (int offset = 0; offset < stride && offset < num_time_steps_; ++offset)
+    {
+      for (int e = 0; e < num_dimensions_; ++e)
+        candidate_parameters_[e] = parameters_[e];
+      for (int t = offset; t < num_time_steps_; t += stride)
+        candidate_parameters_[d](t) += FD_EPSILON;
+
+      evaluate(candidate_parameters_, tmp_state_costs_);
+
+      for (int t = offset; t < num_time_steps_; t += stride)
+      {
+        int begin = std::max(0, t - radius);
+        int end = std::min(num_time_steps_ - 1, t + radius);
+        double difference = 0.0;
+        for (int k = begin; k <= end; ++k)
+          difference += tmp_state_costs_(k) - state_costs_(k);
+        gradient_(t, d) += difference / FD_EPSILON;
+      }
+    }
+  }
+}
+
+void ImprovementManagerGradient::computeDirections()
+{
+  // directions = -inv(metric) * gradient, scaled to a max. joint displacement of 1
+  double max_displacement = 0.0;
+  for (int d = 0; d < num_dimensions_; ++d)
+  {
+    directions_[d] = -gradient_.col(d);
+    metric_cholesky_.solveInPlace(directions_[d]);
+    max_displacement = std::max(max_displacement, directions_[d].cwiseAbs().maxCoeff());
+  }
+  if (max_displacement == 0.0)
+    return;
+  for (int d = 0; d < num_dimensions_; ++d)
+    directions_[d] /= max_displacement;
+}
+
+}
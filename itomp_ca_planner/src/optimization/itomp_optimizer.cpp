@@ -41,6 +41,8 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/visualization/visualization_manager.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
 #include <itomp_ca_planner/optimization/improvement_manager_chomp.h>
+#include <itomp_ca_planner/optimization/improvement_manager_gradient.h>
+#include <itomp_ca_planner/optimization/improvement_manager_cma.h>
 
 using namespace std;
 
@@ -53,7 +55,8 @@ ItompOptimizer::ItompOptimizer(int trajectory_index,
 		double trajectory_start_time,
 		const moveit_msgs::Constraints& path_constraints,
 		BestCostManager* best_cost_manager,
-		const planning_scene::PlanningSceneConstPtr& planning_scene) :
+		const planning_scene::PlanningSceneConstPtr& planning_scene,
+		WorkerPool* worker_pool) :
 		is_feasible(false), terminated_(false), trajectory_index_(
 				trajectory_index), planning_start_time_(planning_start_time), iteration_(
 				-1), feasible_iteration_(0), last_improvement_iteration_(-1), full_trajectory_(
@@ -65,21 +68,27 @@ ItompOptimizer::ItompOptimizer(int trajectory_index,
 				best_cost_manager)
 {
 	initialize(robot_model, planning_group, trajectory_start_time,
-			path_constraints, planning_scene);
+			path_constraints, planning_scene, worker_pool);
 }
 
 void ItompOptimizer::initialize(ItompRobotModel *robot_model,
 		const ItompPlanningGroup *planning_group, double trajectory_start_time,
 		const moveit_msgs::Constraints& path_constraints,
-		const planning_scene::PlanningSceneConstPtr& planning_scene)
+		const planning_scene::PlanningSceneConstPtr& planning_scene,
+		WorkerPool* worker_pool)
 {
 	evaluation_manager_.initialize(full_trajectory_, &group_trajectory_,
 			robot_model, planning_group, planning_start_time_,
 			trajectory_start_time, path_constraints, planning_scene);
 
 	//improvement_manager_.reset(new ImprovementManagerNLP());
-	improvement_manager_.reset(new ImprovementManagerChomp());
-	improvement_manager_->initialize(&evaluation_manager_);
+	if (PlanningParameters::getInstance()->getImprovementManager() == "gradient")
+		improvement_manager_.reset(new ImprovementManagerGradient());
+	else if (PlanningParameters::getInstance()->getImprovementManager() == "cma")
+		improvement_manager_.reset(new ImprovementManagerCMA());
+	else
+		improvement_manager_.reset(new ImprovementManagerChomp());
+	improvement_manager_->initialize(&evaluation_manager_, worker_pool);
 
 	//VisualizationManager::getInstance()->clearAnimations();
 }
@@ -172,6 +181,21 @@ bool ItompOptimizer::optimize()
 			"Terminated after %d iterations, using path from iteration %d", iteration_, last_improvement_iteration_);
 	ROS_INFO(
 			"Optimization core finished in %f sec", (ros::WallTime::now() - start_time).toSec());
+	const CollisionPrefilter* collision_prefilter =
+			evaluation_manager_.getCollisionPrefilter();
+	if (collision_prefilter != NULL)
+		ROS_INFO(
+				"Collision prefilter skipped %lu of %lu narrow phase queries", collision_prefilter->getNumSkippedQueries(), collision_prefilter->getNumQueries());
+	const CollisionCache& collision_cache =
+			evaluation_manager_.getDefaultData().collision_cache_;
+	if (collision_cache.getNumQueries() > 0)
+		ROS_INFO(
+				"Collision cache hits : %lu of %lu waypoints", collision_cache.getNumHits(), collision_cache.getNumQueries());
+	unsigned long num_skipped_rollout_evaluations =
+			improvement_manager_->getNumSkippedRolloutEvaluations();
+	if (num_skipped_rollout_evaluations > 0)
+		ROS_INFO(
+				"Rollout evaluations skipped for reused rollouts : %lu of %lu", num_skipped_rollout_evaluations, num_skipped_rollout_evaluations + improvement_manager_->getNumRolloutEvaluations());
 
 	//evaluation_manager_.getTrajectoryCost(true);
 
@@ -39,6 +39,11 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 
 namespace itomp_ca_planner
 {
+Rollout::Rollout() :
+		state_costs_valid_(false)
+{
+}
+
 double Rollout::getCost()
 {
 	double cost = state_costs_.sum();
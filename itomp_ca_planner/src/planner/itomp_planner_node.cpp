@@ -38,6 +38,7 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <itomp_ca_planner/planner/itomp_planner_node.h>
 #include <itomp_ca_planner/model/itomp_planning_group.h>
 #include <itomp_ca_planner/util/planning_parameters.h>
+#include <itomp_ca_planner/util/thread_budget.h>
 #include <itomp_ca_planner/visualization/visualization_manager.h>
 #include <itomp_ca_planner/precomputation/precomputation.h>
 #include <kdl/jntarray.hpp>
@@ -45,6 +46,8 @@ Any questions or comments should be sent to the author chpark@cs.unc.edu
 #include <visualization_msgs/MarkerArray.h>
 #include <boost/random/uniform_real.hpp>
 #include <boost/random/variate_generator.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
@@ -66,6 +69,10 @@ bool ItompPlannerNode::init()
 	//Eigen::initParallel();
 
 	PlanningParameters::getInstance()->initFromNodeHandle();
+	ThreadBudget::getInstance()->update();
+
+	worker_pool_.reset(
+			new WorkerPool(ThreadBudget::getInstance()->getNumThreads()));
 
 	robot_model_loader::RobotModelLoader robot_model_loader(
 			"robot_description");
@@ -114,6 +121,11 @@ bool ItompPlannerNode::planKinematicPath(
 {
 	// reload parameters
 	PlanningParameters::getInstance()->initFromNodeHandle();
+	ThreadBudget::getInstance()->update();
+	if (worker_pool_->getNumThreads()
+			!= ThreadBudget::getInstance()->getNumThreads())
+		worker_pool_.reset(
+				new WorkerPool(ThreadBudget::getInstance()->getNumThreads()));
 
 	ros::WallTime start_time = ros::WallTime::now();
 
@@ -308,10 +320,28 @@ void ItompPlannerNode::getPlanningGroups(
 	}
 }
 
-void optimization_thread_function(ItompOptimizerPtr& optimizer)
+struct OptimizerQueue
+{
+	const std::vector<ItompOptimizerPtr>* optimizers;
+	int next;
+	boost::mutex mutex;
+};
+
+// each task keeps pulling optimizers off the shared queue, so the number of
+// submitted tasks bounds the number of concurrently running optimizers
+void optimization_task_function(OptimizerQueue* queue)
 {
-	omp_set_num_threads(getNumParallelThreads());
-	optimizer->optimize();
+	while (true)
+	{
+		int index;
+		{
+			boost::mutex::scoped_lock lock(queue->mutex);
+			index = queue->next++;
+		}
+		if (index >= (int) queue->optimizers->size())
+			return;
+		(*queue->optimizers)[index]->optimize();
+	}
 }
 
 void ItompPlannerNode::trajectoryOptimization(const string& groupName,
@@ -336,17 +366,23 @@ void ItompPlannerNode::trajectoryOptimization(const string& groupName,
 		optimizers_[i].reset(
 				new ItompOptimizer(i, trajectories_[i].get(), &robot_model_,
 						group, planning_start_time_, trajectory_start_time_,
-						path_constraints, &best_cost_manager_, planning_scene));
-
-	std::vector<boost::shared_ptr<boost::thread> > optimization_threads(
-			num_trajectories);
-	for (int i = 0; i < num_trajectories; ++i)
-		optimization_threads[i].reset(
-				new boost::thread(optimization_thread_function,
-						optimizers_[i]));
-
-	for (int i = 0; i < num_trajectories; ++i)
-		optimization_threads[i]->join();
+						path_constraints, &best_cost_manager_, planning_scene,
+						worker_pool_.get()));
+
+	// at most num_trajectory_threads optimizers run at once; the remaining
+	// pool threads are left to the rollout and waypoint work they submit
+	int num_trajectory_threads = std::max(1,
+			std::min(ThreadBudget::getInstance()->getNumTrajectoryThreads(),
+					num_trajectories));
+	OptimizerQueue optimizer_queue;
+	optimizer_queue.optimizers = &optimizers_;
+	optimizer_queue.next = 0;
+	TaskGroup optimization_tasks;
+	for (int i = 0; i < num_trajectory_threads; ++i)
+		worker_pool_->submit(
+				boost::bind(optimization_task_function, &optimizer_queue),
+				&optimization_tasks);
+	optimization_tasks.wait(worker_pool_.get());
 
 	last_planning_time_ = (ros::WallTime::now() - create_time).toSec();
 	ROS_INFO(
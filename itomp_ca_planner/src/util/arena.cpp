@@ -0,0 +1,109 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/arena.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace itomp_ca_planner
+{
+
+Arena::Arena() :
+		buffer_(NULL), size_(0), capacity_(0)
+{
+}
+
+Arena::Arena(const Arena& arena) :
+		buffer_(NULL), size_(0), capacity_(0)
+{
+	*this = arena;
+}
+
+Arena::~Arena()
+{
+	free(buffer_);
+}
+
+Arena& Arena::operator=(const Arena& arena)
+{
+	if (this == &arena)
+		return *this;
+
+	if (capacity_ < arena.size_)
+		resizeBuffer(arena.size_);
+	size_ = arena.size_;
+	if (size_ != 0)
+		memcpy(buffer_, arena.buffer_, size_);
+	return *this;
+}
+
+void Arena::clear()
+{
+	size_ = 0;
+}
+
+void Arena::allocate()
+{
+	if (capacity_ < size_)
+		resizeBuffer(size_);
+	if (size_ != 0)
+		memset(buffer_, 0, size_);
+}
+
+void Arena::swap(Arena& arena)
+{
+	std::swap(buffer_, arena.buffer_);
+	std::swap(size_, arena.size_);
+	std::swap(capacity_, arena.capacity_);
+}
+
+void Arena::resizeBuffer(size_t capacity)
+{
+	free(buffer_);
+	buffer_ = NULL;
+	capacity_ = 0;
+
+	void* buffer;
+	if (posix_memalign(&buffer, ALIGNMENT, capacity) != 0)
+		throw std::bad_alloc();
+	buffer_ = static_cast<char*>(buffer);
+	capacity_ = capacity;
+}
+
+}
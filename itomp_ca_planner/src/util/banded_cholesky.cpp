@@ -0,0 +1,128 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/banded_cholesky.h>
+#include <algorithm>
+#include <cmath>
+
+namespace itomp_ca_planner
+{
+
+BandedCholesky::BandedCholesky() :
+		size_(0), bandwidth_(0)
+{
+}
+
+BandedCholesky::~BandedCholesky()
+{
+}
+
+bool BandedCholesky::compute(const Eigen::MatrixXd& band)
+{
+	bandwidth_ = band.rows() - 1;
+	size_ = band.cols();
+	factor_ = band;
+
+	// L(i, j) is factor_(i - j, j)
+	for (int j = 0; j < size_; ++j)
+	{
+		int k_begin = std::max(0, j - bandwidth_);
+
+		double diagonal = factor_(0, j);
+		for (int k = k_begin; k < j; ++k)
+			diagonal -= factor_(j - k, k) * factor_(j - k, k);
+		if (diagonal <= 0.0)
+			return false;
+		diagonal = std::sqrt(diagonal);
+		factor_(0, j) = diagonal;
+
+		int i_end = std::min(size_ - 1, j + bandwidth_);
+		for (int i = j + 1; i <= i_end; ++i)
+		{
+			double value = factor_(i - j, j);
+			for (int k = std::max(0, i - bandwidth_); k < j; ++k)
+				value -= factor_(i - k, k) * factor_(j - k, k);
+			factor_(i - j, j) = value / diagonal;
+		}
+	}
+	return true;
+}
+
+void BandedCholesky::solveInPlace(Eigen::VectorXd& x) const
+{
+	solveLowerInPlace(x);
+	solveUpperInPlace(x);
+}
+
+void BandedCholesky::solveLowerInPlace(Eigen::VectorXd& x) const
+{
+	for (int i = 0; i < size_; ++i)
+	{
+		double value = x(i);
+		for (int k = std::max(0, i - bandwidth_); k < i; ++k)
+			value -= factor_(i - k, k) * x(k);
+		x(i) = value / factor_(0, i);
+	}
+}
+
+void BandedCholesky::solveUpperInPlace(Eigen::VectorXd& x) const
+{
+	for (int i = size_ - 1; i >= 0; --i)
+	{
+		double value = x(i);
+		int k_end = std::min(size_ - 1, i + bandwidth_);
+		for (int k = i + 1; k <= k_end; ++k)
+			value -= factor_(k - i, i) * x(k);
+		x(i) = value / factor_(0, i);
+	}
+}
+
+void BandedCholesky::multiplyUpperInPlace(Eigen::VectorXd& x) const
+{
+	// row i only reads x(k) for k >= i, which are not overwritten yet
+	for (int i = 0; i < size_; ++i)
+	{
+		double value = 0.0;
+		int k_end = std::min(size_ - 1, i + bandwidth_);
+		for (int k = i; k <= k_end; ++k)
+			value += factor_(k - i, i) * x(k);
+		x(i) = value;
+	}
+}
+
+}
@@ -84,6 +84,8 @@ void PlanningParameters::initFromNodeHandle()
 	node_handle.param("cartesian_trajectory_cost_weight",
 			cartesian_trajectory_cost_weight_, 1.0);
 	node_handle.param("singularity_cost_weight", singularity_cost_weight_, 1.0);
+	// smallest singular value of the planning group Jacobian below which the singularity cost is nonzero
+	node_handle.param("singularity_threshold", singularity_threshold_, 0.05);
 
 	node_handle.param("smoothness_cost_velocity", smoothness_cost_velocity_,
 			0.0);
@@ -180,12 +182,46 @@ void PlanningParameters::initFromNodeHandle()
 		}
 	}
 
+	// "chomp" : rollout sampling, "cma" : rollout sampling with CMA-ES noise adaptation,
+	// "gradient" : covariant functional gradient descent
+	node_handle.param<std::string>("improvement_manager", improvement_manager_, "chomp");
+	// max. joint displacement of a gradient step
+	node_handle.param("gradient_step_size", gradient_step_size_, 0.05);
+
 	node_handle.param("num_rollouts", num_rollouts_, 10);
 	node_handle.param("num_reused_rollouts", num_reused_rollouts_, 5);
+
+	// thread budget, 0 lets ThreadBudget choose the value
+	node_handle.param("num_threads", num_threads_, 0);
+	node_handle.param("num_trajectory_threads", num_trajectory_threads_, 0);
+	node_handle.param("num_rollout_threads", num_rollout_threads_, 0);
+	node_handle.param("num_waypoint_threads", num_waypoint_threads_, 0);
+
 	node_handle.param("noise_stddev", noise_stddev_, 2.0);
 	node_handle.param("noise_decay", noise_decay_, 0.999);
 	node_handle.param("use_cumulative_costs", use_cumulative_costs_, true);
 	node_handle.param("use_smooth_noises", use_smooth_noises_, true);
+	node_handle.param("use_incremental_evaluation", use_incremental_evaluation_, true);
+	node_handle.param("use_partial_fk", use_partial_fk_, true);
+	node_handle.param("use_batch_fk", use_batch_fk_, true);
+
+	// "fcl" : planning scene collision checks, "sdf" : signed distance field of the static world
+	node_handle.param<std::string>("collision_backend", collision_backend_, "fcl");
+	node_handle.param("use_collision_prefilter", use_collision_prefilter_, true);
+	node_handle.param("use_collision_cost_query", use_collision_cost_query_, true);
+	node_handle.param("use_collision_cache", use_collision_cache_, true);
+	// distances above this are not computed for the collision cache
+	node_handle.param("collision_cache_max_clearance", collision_cache_max_clearance_, 0.2);
+	node_handle.param("sdf_resolution", sdf_resolution_, 0.02);
+	node_handle.param("sdf_padding", sdf_padding_, 0.5);
+	node_handle.param("collision_clearance", collision_clearance_, 0.05);
+
+	// "linear" : regularized least squares, "levmar" : friction cone and center of pressure constrained LM
+	node_handle.param<std::string>("contact_force_solver", contact_force_solver_, "linear");
+	node_handle.param("contact_force_solver_iterations", contact_force_solver_iterations_, 10);
+
+	node_handle.param("use_ground_heightmap", use_ground_heightmap_, false);
+	node_handle.param("ground_heightmap_resolution", ground_heightmap_resolution_, 0.02);
 
 	node_handle.param("num_contacts", num_contacts_, 0);
 
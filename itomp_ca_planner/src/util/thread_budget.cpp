@@ -0,0 +1,95 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/thread_budget.h>
+#include <itomp_ca_planner/util/planning_parameters.h>
+#include <ros/ros.h>
+#include <algorithm>
+
+namespace itomp_ca_planner
+{
+
+ThreadBudget::ThreadBudget() :
+		num_threads_(1), num_trajectory_threads_(1), num_rollout_threads_(1), num_waypoint_threads_(
+				1)
+{
+}
+
+ThreadBudget::~ThreadBudget()
+{
+}
+
+void ThreadBudget::update()
+{
+	const PlanningParameters* parameters = PlanningParameters::getInstance();
+
+	// 0 means "use every core of the host"
+	num_threads_ = parameters->getNumThreads();
+	if (num_threads_ <= 0)
+		num_threads_ = omp_get_num_procs();
+
+	// the outer levels get as many threads as they have work items,
+	// the remaining cores are passed down to the inner levels
+	num_trajectory_threads_ = parameters->getNumTrajectoryThreads();
+	if (num_trajectory_threads_ <= 0)
+		num_trajectory_threads_ = std::min(num_threads_,
+				parameters->getNumTrajectories());
+	num_trajectory_threads_ = std::max(1, num_trajectory_threads_);
+	int threads_per_trajectory = std::max(1,
+			num_threads_ / num_trajectory_threads_);
+
+	num_rollout_threads_ = parameters->getNumRolloutThreads();
+	if (num_rollout_threads_ <= 0)
+		num_rollout_threads_ = std::min(threads_per_trajectory,
+				parameters->getNumRollouts());
+	num_rollout_threads_ = std::max(1, num_rollout_threads_);
+
+	num_waypoint_threads_ = parameters->getNumWaypointThreads();
+	if (num_waypoint_threads_ <= 0)
+		num_waypoint_threads_ = threads_per_trajectory / num_rollout_threads_;
+	num_waypoint_threads_ = std::max(1, num_waypoint_threads_);
+
+	// waypoint loops run inside rollout workers, so they need a second active level
+	omp_set_max_active_levels(
+			(num_rollout_threads_ > 1 && num_waypoint_threads_ > 1) ? 2 : 1);
+
+	ROS_INFO(
+			"Thread budget : %d threads (%d trajectories x %d rollouts x %d waypoints)", num_threads_, num_trajectory_threads_, num_rollout_threads_, num_waypoint_threads_);
+}
+
+}
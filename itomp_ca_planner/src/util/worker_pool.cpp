@@ -0,0 +1,219 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/worker_pool.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+namespace itomp_ca_planner
+{
+
+TaskGroup::TaskGroup() :
+		num_pending_tasks_(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+}
+
+void TaskGroup::add()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	++num_pending_tasks_;
+}
+
+void TaskGroup::done()
+{
+	boost::mutex::scoped_lock lock(mutex_);
+	if (--num_pending_tasks_ == 0)
+		condition_.notify_all();
+}
+
+void TaskGroup::wait(WorkerPool* pool)
+{
+	while (pool->runPendingTask(this))
+		;
+
+	// the remaining tasks are being executed by other threads
+	boost::mutex::scoped_lock lock(mutex_);
+	while (num_pending_tasks_ > 0)
+		condition_.wait(lock);
+}
+
+WorkerPool::WorkerPool(int num_threads) :
+		num_threads_(std::max(1, num_threads)), num_queued_tasks_(0), next_queue_(
+				0), terminated_(false)
+{
+	for (int i = 0; i < num_threads_; ++i)
+		queues_.push_back(boost::shared_ptr<TaskQueue>(new TaskQueue()));
+	for (int i = 0; i < num_threads_; ++i)
+		threads_.create_thread(
+				boost::bind(&WorkerPool::workerFunction, this, i));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		terminated_ = true;
+		condition_.notify_all();
+	}
+	threads_.join_all();
+}
+
+void WorkerPool::submit(const boost::function<void()>& task, TaskGroup* group)
+{
+	Task new_task;
+	new_task.function_ = task;
+	new_task.group_ = group;
+	if (group != NULL)
+		group->add();
+
+	int index = getWorkerIndex();
+	if (index < 0)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		index = next_queue_;
+		next_queue_ = (next_queue_ + 1) % num_threads_;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(queues_[index]->mutex_);
+		queues_[index]->tasks_.push_back(new_task);
+	}
+
+	boost::mutex::scoped_lock lock(mutex_);
+	++num_queued_tasks_;
+	condition_.notify_one();
+}
+
+bool WorkerPool::runPendingTask(TaskGroup* group)
+{
+	Task task;
+	if (!popTask(group, task))
+		return false;
+	runTask(task);
+	return true;
+}
+
+void WorkerPool::workerFunction(int index)
+{
+	worker_index_.reset(new int(index));
+
+	while (true)
+	{
+		Task task;
+		if (popTask(NULL, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		boost::mutex::scoped_lock lock(mutex_);
+		while (num_queued_tasks_ <= 0 && !terminated_)
+			condition_.wait(lock);
+		if (terminated_ && num_queued_tasks_ <= 0)
+			break;
+	}
+}
+
+bool WorkerPool::popTask(TaskGroup* group, Task& task)
+{
+	bool found = false;
+
+	// newest task of the own deque first, then the oldest tasks of the others
+	int own_index = getWorkerIndex();
+	int first_index = (own_index < 0) ? 0 : own_index;
+	for (int i = 0; i < num_threads_ && !found; ++i)
+	{
+		int index = (first_index + i) % num_threads_;
+		TaskQueue& queue = *queues_[index];
+		boost::mutex::scoped_lock lock(queue.mutex_);
+		if (index == own_index)
+		{
+			for (std::deque<Task>::reverse_iterator it = queue.tasks_.rbegin();
+					it != queue.tasks_.rend(); ++it)
+			{
+				if (group == NULL || it->group_ == group)
+				{
+					task = *it;
+					queue.tasks_.erase(--(it.base()));
+					found = true;
+					break;
+				}
+			}
+		}
+		else
+		{
+			for (std::deque<Task>::iterator it = queue.tasks_.begin();
+					it != queue.tasks_.end(); ++it)
+			{
+				if (group == NULL || it->group_ == group)
+				{
+					task = *it;
+					queue.tasks_.erase(it);
+					found = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (found)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		--num_queued_tasks_;
+	}
+	return found;
+}
+
+void WorkerPool::runTask(Task& task)
+{
+	task.function_();
+	if (task.group_ != NULL)
+		task.group_->done();
+}
+
+int WorkerPool::getWorkerIndex() const
+{
+	const int* index = worker_index_.get();
+	return (index == NULL) ? -1 : *index;
+}
+
+}
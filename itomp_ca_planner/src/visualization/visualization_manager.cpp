@@ -629,7 +629,7 @@ void VisualizationManager::setPlanningGroup(
 
 void VisualizationManager::animateEndeffector(int trajectory_index,
 		int point_start, int point_end,
-		const vector<vector<KDL::Frame> >& segmentFrames, bool best)
+		const ArenaArray2D<KDL::Frame>& segmentFrames, bool best)
 {
 	const double trajectory_color_diff = 0.33;
 	const double scale = 0.005;
@@ -695,7 +695,7 @@ void VisualizationManager::animateEndeffector(int trajectory_index,
 }
 
 void VisualizationManager::animateRoot(int numFreeVars, int freeVarStartIndex,
-		const std::vector<std::vector<KDL::Frame> >& segmentFrames, bool best)
+		const ArenaArray2D<KDL::Frame>& segmentFrames, bool best)
 {
 	const double scale = 0.05;
 
@@ -752,7 +752,7 @@ void VisualizationManager::animateRoot(int numFreeVars, int freeVarStartIndex,
 }
 
 void VisualizationManager::animateCoM(int numFreeVars, int freeVarStartIndex,
-		const std::vector<KDL::Vector>& CoM, bool best)
+		const ArenaArray<KDL::Vector>& CoM, bool best)
 {
 	const double scale = 0.05;
 
@@ -0,0 +1,174 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/banded_cholesky.h>
+#include <Eigen/Cholesky>
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+using namespace itomp_ca_planner;
+
+namespace
+{
+const double EPSILON = 1e-9;
+
+double randomValue()
+{
+  return 2.0 * std::rand() / RAND_MAX - 1.0;
+}
+
+// a random symmetric positive definite matrix with the given half bandwidth
+Eigen::MatrixXd createBandMatrix(int size, int bandwidth)
+{
+  Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(size, size);
+  for (int j = 0; j < size; ++j)
+  {
+    for (int i = j + 1; i < size && i <= j + bandwidth; ++i)
+      matrix(i, j) = matrix(j, i) = randomValue();
+  }
+  // diagonally dominant
+  for (int i = 0; i < size; ++i)
+    matrix(i, i) = 2.0 * bandwidth + 1.0 + randomValue();
+  return matrix;
+}
+
+// lower band storage: band(k, j) = matrix(j + k, j)
+Eigen::MatrixXd toBand(const Eigen::MatrixXd& matrix, int bandwidth)
+{
+  const int size = matrix.cols();
+  Eigen::MatrixXd band = Eigen::MatrixXd::Zero(bandwidth + 1, size);
+  for (int j = 0; j < size; ++j)
+    for (int k = 0; k <= bandwidth && j + k < size; ++k)
+      band(k, j) = matrix(j + k, j);
+  return band;
+}
+
+Eigen::VectorXd createVector(int size)
+{
+  Eigen::VectorXd x(size);
+  for (int i = 0; i < size; ++i)
+    x(i) = randomValue();
+  return x;
+}
+
+class BandedCholeskyTest : public testing::TestWithParam<std::pair<int, int> >
+{
+protected:
+  virtual void SetUp()
+  {
+    size_ = GetParam().first;
+    bandwidth_ = GetParam().second;
+    matrix_ = createBandMatrix(size_, bandwidth_);
+    ASSERT_TRUE(cholesky_.compute(toBand(matrix_, bandwidth_)));
+    llt_.compute(matrix_);
+    ASSERT_EQ(Eigen::Success, llt_.info());
+  }
+
+  int size_;
+  int bandwidth_;
+  Eigen::MatrixXd matrix_;
+  BandedCholesky cholesky_;
+  Eigen::LLT<Eigen::MatrixXd> llt_;
+};
+}
+
+TEST_P(BandedCholeskyTest, ComputeMatchesDenseFactor)
+{
+  EXPECT_EQ(size_, cholesky_.getSize());
+  EXPECT_EQ(bandwidth_, cholesky_.getBandwidth());
+
+  // the columns of L^T are L^T applied to the unit vectors
+  Eigen::MatrixXd upper = llt_.matrixU();
+  for (int j = 0; j < size_; ++j)
+  {
+    Eigen::VectorXd x = Eigen::VectorXd::Unit(size_, j);
+    cholesky_.multiplyUpperInPlace(x);
+    EXPECT_TRUE(x.isApprox(upper.col(j), EPSILON)) << "column " << j;
+  }
+}
+
+TEST_P(BandedCholeskyTest, SolveMatchesDenseSolve)
+{
+  Eigen::VectorXd b = createVector(size_);
+
+  Eigen::VectorXd x = b;
+  cholesky_.solveInPlace(x);
+  EXPECT_TRUE(x.isApprox(llt_.solve(b), EPSILON));
+  EXPECT_TRUE((matrix_ * x).isApprox(b, EPSILON));
+
+  x = b;
+  cholesky_.solveLowerInPlace(x);
+  EXPECT_TRUE(x.isApprox(llt_.matrixL().solve(b), EPSILON));
+
+  x = b;
+  cholesky_.solveUpperInPlace(x);
+  EXPECT_TRUE(x.isApprox(llt_.matrixU().solve(b), EPSILON));
+}
+
+TEST_P(BandedCholeskyTest, MultiplyUpperMatchesDenseProduct)
+{
+  Eigen::VectorXd b = createVector(size_);
+
+  Eigen::VectorXd x = b;
+  cholesky_.multiplyUpperInPlace(x);
+  Eigen::MatrixXd upper = llt_.matrixU();
+  EXPECT_TRUE(x.isApprox(upper * b, EPSILON));
+
+  // L^-T undoes L^T
+  cholesky_.solveUpperInPlace(x);
+  EXPECT_TRUE(x.isApprox(b, EPSILON));
+}
+
+// sizes and half bandwidths, including a band as wide as the matrix and a diagonal one
+INSTANTIATE_TEST_CASE_P(BandedCholesky, BandedCholeskyTest,
+    testing::Values(std::make_pair(1, 0), std::make_pair(8, 0), std::make_pair(20, 1), std::make_pair(40, 6),
+        std::make_pair(5, 4), std::make_pair(5, 6)));
+
+TEST(BandedCholesky, RejectsIndefiniteMatrix)
+{
+  Eigen::MatrixXd matrix = createBandMatrix(10, 2);
+  matrix(6, 6) = -1.0;
+  BandedCholesky cholesky;
+  EXPECT_FALSE(cholesky.compute(toBand(matrix, 2)));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,183 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/model/treefksolverjointposaxis_batch.hpp>
+#include <itomp_ca_planner/model/treefksolverjointposaxis_partial.hpp>
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+using namespace KDL;
+
+namespace
+{
+const int NUM_ROWS = 6;
+const double EPSILON = 1e-9;
+
+// a branched tree with offsets, a fixed segment, both joint kinds and a general axis
+Tree createTree()
+{
+  Tree tree("base");
+  tree.addSegment(Segment("link1", Joint("joint1", Joint::RotZ), Frame(Rotation::RPY(0.1, 0.2, 0.3), Vector(0.0, 0.0, 0.3))),
+      "base");
+  tree.addSegment(Segment("link2", Joint("fixed2", Joint::None), Frame(Rotation::RPY(0.0, 0.5, 0.0), Vector(0.2, 0.0, 0.0))),
+      "link1");
+  tree.addSegment(Segment("link3", Joint("joint3", Joint::TransX), Frame(Vector(0.0, 0.1, 0.0))), "link2");
+  tree.addSegment(
+      Segment("link4", Joint("joint4", Vector(0.05, 0.0, 0.1), Vector(0.0, 0.6, 0.8), Joint::RotAxis),
+          Frame(Rotation::RPY(-0.3, 0.0, 0.2), Vector(0.1, 0.1, 0.2))), "link3");
+  tree.addSegment(Segment("link5", Joint("joint5", Joint::RotY), Frame(Vector(0.0, -0.2, 0.1))), "link1");
+  tree.addSegment(Segment("link6", Joint("joint6", Joint::RotX), Frame(Vector(0.4, 0.0, 0.0))), "base");
+  return tree;
+}
+
+Eigen::MatrixXd createJointValues(int num_joints)
+{
+  Eigen::MatrixXd q(NUM_ROWS, num_joints);
+  for (int i = 0; i < NUM_ROWS; ++i)
+    for (int j = 0; j < num_joints; ++j)
+      q(i, j) = 2.0 * std::rand() / RAND_MAX - 1.0;
+  return q;
+}
+
+// compares the batch outputs of rows against TreeFkSolverJointPosAxisPartial::JntToCartFull
+void expectFullFK(const TreeFkSolverJointPosAxisPartial& fk_solver, const Eigen::MatrixXd& q,
+    const std::vector<int>& rows, const std::vector<Vector>& joint_pos, const std::vector<Vector>& joint_axis,
+    const std::vector<Frame>& segment_frames)
+{
+  const int num_joints = q.cols();
+  const int num_segments = fk_solver.getNumSegments();
+  JntArray q_row(num_joints);
+  std::vector<Vector> full_joint_pos, full_joint_axis;
+  std::vector<Frame> full_segment_frames;
+  for (int n = 0; n < rows.size(); ++n)
+  {
+    for (int j = 0; j < num_joints; ++j)
+      q_row(j) = q(rows[n], j);
+    fk_solver.JntToCartFull(q_row, full_joint_pos, full_joint_axis, full_segment_frames);
+
+    for (int s = 0; s < num_segments; ++s)
+      EXPECT_TRUE(Equal(full_segment_frames[s], segment_frames[n * num_segments + s], EPSILON))
+          << "row " << rows[n] << " segment " << s;
+    for (int j = 0; j < num_joints; ++j)
+    {
+      EXPECT_TRUE(Equal(full_joint_pos[j], joint_pos[n * num_joints + j], EPSILON))
+          << "row " << rows[n] << " joint " << j;
+      EXPECT_TRUE(Equal(full_joint_axis[j], joint_axis[n * num_joints + j], EPSILON))
+          << "row " << rows[n] << " joint " << j;
+    }
+  }
+}
+}
+
+TEST(BatchFK, BatchMatchesFull)
+{
+  Tree tree = createTree();
+  const int num_joints = tree.getNrOfJoints();
+  TreeFkSolverJointPosAxisPartial fk_solver(tree, "base", std::vector<bool>(num_joints, false));
+  TreeFkSolverJointPosAxisBatch batch_fk_solver(tree, "base");
+  ASSERT_EQ(fk_solver.getNumSegments(), batch_fk_solver.getNumSegments());
+
+  Eigen::MatrixXd q = createJointValues(num_joints);
+  std::vector<int> rows;
+  rows.push_back(4);
+  rows.push_back(0);
+  rows.push_back(1);
+  rows.push_back(5);
+
+  std::vector<Vector> joint_pos(rows.size() * num_joints), joint_axis(rows.size() * num_joints);
+  std::vector<Frame> segment_frames(rows.size() * batch_fk_solver.getNumSegments());
+  batch_fk_solver.JntToCartBatch(q, rows, &joint_pos[0], &joint_axis[0], &segment_frames[0]);
+  expectFullFK(fk_solver, q, rows, joint_pos, joint_axis, segment_frames);
+}
+
+TEST(BatchFK, BatchInMovingReferenceFrameMatchesFull)
+{
+  Tree tree = createTree();
+  const int num_joints = tree.getNrOfJoints();
+  TreeFkSolverJointPosAxisPartial fk_solver(tree, "link2", std::vector<bool>(num_joints, false));
+  TreeFkSolverJointPosAxisBatch batch_fk_solver(tree, "link2");
+
+  Eigen::MatrixXd q = createJointValues(num_joints);
+  std::vector<int> rows;
+  for (int i = 0; i < NUM_ROWS; ++i)
+    rows.push_back(i);
+
+  std::vector<Vector> joint_pos(rows.size() * num_joints), joint_axis(rows.size() * num_joints);
+  std::vector<Frame> segment_frames(rows.size() * batch_fk_solver.getNumSegments());
+  batch_fk_solver.JntToCartBatch(q, rows, &joint_pos[0], &joint_axis[0], &segment_frames[0]);
+  expectFullFK(fk_solver, q, rows, joint_pos, joint_axis, segment_frames);
+}
+
+TEST(BatchFK, PartialBatchMatchesFull)
+{
+  Tree tree = createTree();
+  const int num_joints = tree.getNrOfJoints();
+
+  // the joints below link2 and the one of link5 change, the others keep their values
+  std::vector<bool> active_joints(num_joints, false);
+  active_joints[tree.getSegment("link3")->second.q_nr] = true;
+  active_joints[tree.getSegment("link4")->second.q_nr] = true;
+  active_joints[tree.getSegment("link5")->second.q_nr] = true;
+  TreeFkSolverJointPosAxisPartial fk_solver(tree, "base", active_joints);
+  ASSERT_TRUE(fk_solver.isPartialFKAvailable());
+  TreeFkSolverJointPosAxisBatch batch_fk_solver(tree, "base");
+  batch_fk_solver.setPartialEvaluationOrder(fk_solver.getSegmentEvaluationOrder());
+
+  Eigen::MatrixXd q = createJointValues(num_joints);
+  std::vector<int> rows;
+  rows.push_back(2);
+  rows.push_back(3);
+  rows.push_back(0);
+
+  std::vector<Vector> joint_pos(rows.size() * num_joints), joint_axis(rows.size() * num_joints);
+  std::vector<Frame> segment_frames(rows.size() * batch_fk_solver.getNumSegments());
+  batch_fk_solver.JntToCartBatch(q, rows, &joint_pos[0], &joint_axis[0], &segment_frames[0]);
+
+  Eigen::MatrixXd new_q = createJointValues(num_joints);
+  for (int j = 0; j < num_joints; ++j)
+    if (!active_joints[j])
+      new_q.col(j) = q.col(j);
+  batch_fk_solver.JntToCartBatchPartial(new_q, rows, &joint_pos[0], &joint_axis[0], &segment_frames[0]);
+  expectFullFK(fk_solver, new_q, rows, joint_pos, joint_axis, segment_frames);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,184 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/util/differentiation_rules.h>
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+using namespace itomp_ca_planner;
+
+namespace
+{
+const double EPSILON = 1e-9;
+const int NUM_POINTS = 25;
+const int NUM_COLUMNS = 3;
+
+// the rules of DIFF_RULES, then rules which use every tap
+const int NUM_TEST_RULES = NUM_DIFF_RULES + 2;
+const double FULL_RULES[2][DIFF_RULE_LENGTH] =
+{
+  { 0, 1 / 12.0, -17 / 12.0, 46 / 12.0, -46 / 12.0, 17 / 12.0, -1 / 12.0 },
+  { 0.3, -1.2, 0.7, 2.0, -0.4, 0.9, -1.1 }
+};
+
+const double* getRule(int index)
+{
+  return (index < NUM_DIFF_RULES) ? DIFF_RULES[index] : FULL_RULES[index - NUM_DIFF_RULES];
+}
+
+double randomValue()
+{
+  return 2.0 * std::rand() / RAND_MAX - 1.0;
+}
+
+Eigen::MatrixXd createMatrix(int rows, int cols)
+{
+  Eigen::MatrixXd matrix(rows, cols);
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j)
+      matrix(i, j) = randomValue();
+  return matrix;
+}
+
+// the differentiation matrix the kernels apply: the rule centered at every point
+// where it fits, zero rows for the outer DIFF_RULE_LENGTH / 2 points
+Eigen::MatrixXd createDiffMatrix(const double* diff_rule, int size)
+{
+  const int half_length = DIFF_RULE_LENGTH / 2;
+  Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(size, size);
+  for (int i = half_length; i < size - half_length; ++i)
+    for (int j = 0; j < DIFF_RULE_LENGTH; ++j)
+      matrix(i, i - half_length + j) = diff_rule[j];
+  return matrix;
+}
+}
+
+TEST(DifferentiationRules, ApplyMatchesDenseProduct)
+{
+  for (int r = 0; r < NUM_TEST_RULES; ++r)
+  {
+    Eigen::MatrixXd diff_matrix = createDiffMatrix(getRule(r), NUM_POINTS);
+    Eigen::MatrixXd input = createMatrix(NUM_POINTS, NUM_COLUMNS);
+    Eigen::MatrixXd output = createMatrix(NUM_POINTS, NUM_COLUMNS);
+    applyDiffRule(getRule(r), input, output);
+    EXPECT_LT((output - diff_matrix * input).norm(), EPSILON) << "rule " << r;
+  }
+}
+
+TEST(DifferentiationRules, ApplyTransposeMatchesDenseProduct)
+{
+  for (int r = 0; r < NUM_TEST_RULES; ++r)
+  {
+    Eigen::MatrixXd diff_matrix = createDiffMatrix(getRule(r), NUM_POINTS);
+    Eigen::MatrixXd input = createMatrix(NUM_POINTS, NUM_COLUMNS);
+    Eigen::MatrixXd output = createMatrix(NUM_POINTS, NUM_COLUMNS);
+    applyDiffRuleTranspose(getRule(r), input, output);
+    EXPECT_LT((output - diff_matrix.transpose() * input).norm(), EPSILON) << "rule " << r;
+  }
+}
+
+TEST(DifferentiationRules, ApplyShorterThanRule)
+{
+  Eigen::MatrixXd input = createMatrix(DIFF_RULE_LENGTH - 1, NUM_COLUMNS);
+  Eigen::MatrixXd output = createMatrix(DIFF_RULE_LENGTH - 1, NUM_COLUMNS);
+  applyDiffRule(getRule(NUM_DIFF_RULES), input, output);
+  EXPECT_TRUE(output.isZero());
+  output = createMatrix(DIFF_RULE_LENGTH - 1, NUM_COLUMNS);
+  applyDiffRuleTranspose(getRule(NUM_DIFF_RULES), input, output);
+  EXPECT_TRUE(output.isZero());
+}
+
+TEST(DifferentiationRules, SquaredNormMatchesDenseNorm)
+{
+  for (int r = 0; r < NUM_TEST_RULES; ++r)
+  {
+    Eigen::MatrixXd diff_matrix = createDiffMatrix(getRule(r), NUM_POINTS);
+    Eigen::VectorXd input = createMatrix(NUM_POINTS, 1);
+    EXPECT_NEAR((diff_matrix * input).squaredNorm(), computeDiffRuleSquaredNorm(getRule(r), input), EPSILON)
+        << "rule " << r;
+  }
+}
+
+TEST(DifferentiationRules, GramBandMatchesDenseGram)
+{
+  const double weight = 0.7;
+  for (int r = 0; r < NUM_TEST_RULES; ++r)
+  {
+    Eigen::MatrixXd diff_matrix = createDiffMatrix(getRule(r), NUM_POINTS);
+    Eigen::MatrixXd gram = weight * diff_matrix.transpose() * diff_matrix;
+
+    // the free block of ImprovementManagerGradient::initializeMetric, the whole
+    // trajectory, and a band narrower than D^T D
+    const int blocks[3][3] =
+    {
+      // begin, number of variables, bandwidth
+      { DIFF_RULE_LENGTH - 1, NUM_POINTS - 2 * (DIFF_RULE_LENGTH - 1), DIFF_RULE_LENGTH - 1 },
+      { 0, NUM_POINTS, DIFF_RULE_LENGTH - 1 },
+      { 2, NUM_POINTS - 5, 2 },
+    };
+    for (int b = 0; b < 3; ++b)
+    {
+      const int begin = blocks[b][0];
+      const int num_vars = blocks[b][1];
+      const int bandwidth = blocks[b][2];
+
+      // the kernel adds to the band
+      Eigen::MatrixXd initial_band = createMatrix(bandwidth + 1, num_vars);
+      Eigen::MatrixXd band = initial_band;
+      addDiffRuleGramBand(getRule(r), weight, NUM_POINTS, begin, band);
+
+      for (int j = 0; j < num_vars; ++j)
+      {
+        for (int k = 0; k <= bandwidth; ++k)
+        {
+          double expected = initial_band(k, j);
+          if (j + k < num_vars)
+            expected += gram(begin + j + k, begin + j);
+          EXPECT_NEAR(expected, band(k, j), EPSILON) << "rule " << r << " block " << b << " entry (" << k << ", "
+              << j << ")";
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,152 @@
+/*
+
+License
+
+ITOMP Optimization-based Planner
+Copyright © and trademark ™ 2014 University of North Carolina at Chapel Hill.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software and its documentation
+for educational, research, and non-profit purposes, without fee, and without a
+written agreement is hereby granted, provided that the above copyright notice,
+this paragraph, and the following four paragraphs appear in all copies.
+
+This software program and documentation are copyrighted by the University of North
+Carolina at Chapel Hill. The software program and documentation are supplied "as is,"
+without any accompanying services from the University of North Carolina at Chapel
+Hill or the authors. The University of North Carolina at Chapel Hill and the
+authors do not warrant that the operation of the program will be uninterrupted
+or error-free. The end-user understands that the program was developed for research
+purposes and is advised not to rely exclusively on the program for any reason.
+
+IN NO EVENT SHALL THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE AUTHORS
+BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL
+DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS
+DOCUMENTATION, EVEN IF THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL OR THE
+AUTHORS HAVE BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS SPECIFICALLY
+DISCLAIM ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE AND ANY STATUTORY WARRANTY
+OF NON-INFRINGEMENT. THE SOFTWARE PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND
+THE UNIVERSITY OF NORTH CAROLINA AT CHAPEL HILL AND THE AUTHORS HAVE NO OBLIGATIONS
+TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Any questions or comments should be sent to the author chpark@cs.unc.edu
+
+*/
+
+#include <itomp_ca_planner/optimization/evaluation_data.h>
+#include <gtest/gtest.h>
+
+using namespace itomp_ca_planner;
+
+namespace
+{
+const int NUM_POINTS = 20;
+const int NUM_MASS_SEGMENTS = 2;
+// first and last free waypoint of EvaluationManager for DIFF_RULE_LENGTH = 7
+const int FULL_VARS_START = 5;
+const int FULL_VARS_END = NUM_POINTS - 5;
+
+void allocate(EvaluationBuffers& buffers)
+{
+  buffers.allocateBuffers(NUM_POINTS, 2, 3, NUM_MASS_SEGMENTS, 2, 1, 1);
+}
+
+// writes the CoM stage of EvaluationManager::computeWrenchSum(begin, end): the window,
+// and the boundary copies to the fixed waypoints if the window touches the free ones
+void writeWrenchSum(EvaluationBuffers& buffers, int begin, int end, double value)
+{
+  int write_begin = (begin == FULL_VARS_START) ? 0 : begin;
+  int write_end = (end == FULL_VARS_END) ? NUM_POINTS : end;
+  for (int i = write_begin; i < write_end; ++i)
+  {
+    buffers.CoMPositions_[i] = KDL::Vector(value, i, 0.0);
+    for (int j = 0; j < NUM_MASS_SEGMENTS; ++j)
+      buffers.linkPositions_[j][i] = KDL::Vector(value, i, j);
+    buffers.stateContactInvariantCost_[i] = value + i;
+  }
+}
+
+// what EvaluationManager::evaluate() marks for the window [begin, end)
+void markEvaluated(EvaluationBuffers& buffers, int begin, int end)
+{
+  buffers.markWindowStale(begin, end, FULL_VARS_START, FULL_VARS_END);
+}
+
+void expectEqual(const EvaluationBuffers& expected, const EvaluationBuffers& actual)
+{
+  for (int i = 0; i < NUM_POINTS; ++i)
+  {
+    EXPECT_TRUE(KDL::Equal(expected.CoMPositions_[i], actual.CoMPositions_[i])) << "point " << i;
+    for (int j = 0; j < NUM_MASS_SEGMENTS; ++j)
+      EXPECT_TRUE(KDL::Equal(expected.linkPositions_[j][i], actual.linkPositions_[j][i])) << "point " << i;
+    EXPECT_EQ(expected.stateContactInvariantCost_[i], actual.stateContactInvariantCost_[i]) << "point " << i;
+  }
+}
+}
+
+// A windowed evaluation touching the first free waypoint, followed by a derivative
+// transaction which is rolled back, has to leave the buffers of a fresh evaluation
+TEST(EvaluationBuffers, RollbackKeepsBoundaryRowsOfWindowedEvaluation)
+{
+  EvaluationBuffers buffers;
+  allocate(buffers);
+
+  // full evaluation, then a transaction so the shadow arena is valid
+  writeWrenchSum(buffers, FULL_VARS_START, FULL_VARS_END, 1.0);
+  markEvaluated(buffers, FULL_VARS_START, FULL_VARS_END);
+  buffers.beginTransaction(8, 12);
+  writeWrenchSum(buffers, 8, 12, -1.0);
+  buffers.rollbackTransaction();
+
+  // windowed evaluation at the start of the trajectory
+  const int window_end = 11;
+  writeWrenchSum(buffers, FULL_VARS_START, window_end, 2.0);
+  markEvaluated(buffers, FULL_VARS_START, window_end);
+
+  buffers.beginTransaction(9, 14);
+  writeWrenchSum(buffers, 9, 14, -2.0);
+  buffers.rollbackTransaction();
+
+  EvaluationBuffers fresh;
+  allocate(fresh);
+  writeWrenchSum(fresh, FULL_VARS_START, FULL_VARS_END, 1.0);
+  writeWrenchSum(fresh, FULL_VARS_START, window_end, 2.0);
+  expectEqual(fresh, buffers);
+}
+
+// same at the end of the trajectory, with the transaction committed
+TEST(EvaluationBuffers, CommitThenRollbackKeepsBoundaryRows)
+{
+  EvaluationBuffers buffers;
+  allocate(buffers);
+
+  writeWrenchSum(buffers, FULL_VARS_START, FULL_VARS_END, 1.0);
+  markEvaluated(buffers, FULL_VARS_START, FULL_VARS_END);
+  buffers.beginTransaction(6, 9);
+  writeWrenchSum(buffers, 6, 9, 3.0);
+  buffers.commitTransaction();
+
+  const int window_begin = 10;
+  writeWrenchSum(buffers, window_begin, FULL_VARS_END, 2.0);
+  markEvaluated(buffers, window_begin, FULL_VARS_END);
+
+  buffers.beginTransaction(6, 12);
+  writeWrenchSum(buffers, 6, 12, -2.0);
+  buffers.rollbackTransaction();
+
+  EvaluationBuffers fresh;
+  allocate(fresh);
+  writeWrenchSum(fresh, FULL_VARS_START, FULL_VARS_END, 1.0);
+  writeWrenchSum(fresh, 6, 9, 3.0);
+  writeWrenchSum(fresh, window_begin, FULL_VARS_END, 2.0);
+  expectEqual(fresh, buffers);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}